@@ -0,0 +1,232 @@
+#include<stdbool.h>
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+
+#include"chip_8.h"
+#include"bench.h"
+#include"display.h"
+#include"metrics.h"
+
+/* Microbenchmarks of the hot functions: fetch(),the interpreter per opcode class,draw() per sprite
+ * height at byte aligned and unaligned x,clear_screen(),render_screen() and every engine running a
+ * small game like loop. Every benchmark calls the function a fixed number of times per sample,runs
+ * a few samples to warm up and then reports the median and the median absolute deviation of the 
+ * time per call over SAMPLES samples,one tab separated line per benchmark so two runs can be 
+ * compared with a script:
+ *
+ *	name	calls	median_ns	mad_ns	min_ns
+ *
+ * The state is synthetic (a fixed machine,not a ROM) so the numbers only change when the code 
+ * does.*/
+
+#define WARMUP 5
+#define SAMPLES 31
+
+int bench_run(FILE *out,const struct Quirks *q,const char *filter);
+
+struct BenchContext{
+	const struct Quirks *q;
+	struct Chip8 c8;
+	unsigned short opcodes[2]; // executed in turn,the second one 0 if there's only one
+	int x,height;
+	struct Game *game;
+	const struct Engine *engine;
+};
+
+// Keeps the results alive so the calls can't be optimised away
+static volatile unsigned sink;
+
+static void bench_fetch(struct BenchContext *b,unsigned calls){
+	unsigned sum = 0;
+	for(unsigned i = 0;i < calls;i++)
+		sum += fetch(&b->c8);
+	sink = sum;
+}
+
+static void bench_execute(struct BenchContext *b,unsigned calls){
+	unsigned sum = 0;
+	for(unsigned i = 0;i < calls;i++){
+		sum += b->q->execute(b->opcodes[0],&b->c8);
+		if(b->opcodes[1])
+			sum += b->q->execute(b->opcodes[1],&b->c8);
+	}
+	sink = sum;
+}
+
+static void bench_draw(struct BenchContext *b,unsigned calls){
+	unsigned sum = 0;
+	for(unsigned i = 0;i < calls;i++)
+		sum += draw(&b->c8,b->x,4,b->height,0x300);
+	sink = sum;
+}
+
+static void bench_clear(struct BenchContext *b,unsigned calls){
+	for(unsigned i = 0;i < calls;i++)
+		clear_screen(&b->c8);
+	sink = b->c8.display[0][0];
+}
+
+// `calls` instructions,in as many runs as the frames the loop draws take
+static void bench_engine(struct BenchContext *b,unsigned calls){
+	for(unsigned n = 0;n < calls;)
+		n += b->engine->run(&b->c8,b->q,calls - n);
+	sink = b->c8.registers.V[3];
+}
+
+static void bench_render(struct BenchContext *b,unsigned calls){
+	for(unsigned i = 0;i < calls;i++)
+		render_screen(b->game,&b->c8);
+}
+
+static int compare_u64(const void *a,const void *b){
+	uint64_t x = *(const uint64_t *) a,y = *(const uint64_t *) b;
+	return (x > y) - (x < y);
+}
+
+// A machine with something on the screen,sprites at 0x300 and all the registers set
+static void bench_machine(struct Chip8 *c8){
+	chip8_init(c8,1);
+	for(int i = 0x200;i < 0x1000;i++)
+		c8->memory[i] = chip8_mix(i);
+	chip8_wrote(c8,0x200,0x1000 - 0x200);
+	for(int i = 0;i < 16;i++)
+		c8->registers.V[i] = chip8_mix(i + 0x1000);
+	c8->registers.V[0] = 255; // three digits for FX33
+	c8->registers.I = 0x400;
+	c8->registers.PC = 0x200;
+	for(int y = 0;y < DISPLAY_HEIGHT;y++)
+		for(int x = 0;x < DISPLAY_WIDTH;x++)
+			c8->display[y][x] = (x ^ y) & 1;
+}
+
+static bool wanted(const char *filter,const char *name){
+	return filter == NULL || strstr(name,filter) != NULL;
+}
+
+static void measure(FILE *out,const char *filter,const char *name,unsigned calls,
+		    void (*fn)(struct BenchContext *b,unsigned calls),struct BenchContext *b){
+	uint64_t samples[SAMPLES],deviations[SAMPLES];
+
+	if(!wanted(filter,name))
+		return;
+
+	const struct Chip8 start = b->c8;
+	for(int i = 0;i < WARMUP + SAMPLES;i++){
+		b->c8 = start; // every sample starts from the same machine
+		uint64_t begin = metrics_now();
+		fn(b,calls);
+		uint64_t elapsed = metrics_now() - begin;
+		if(i >= WARMUP)
+			samples[i - WARMUP] = elapsed;
+	}
+	b->c8 = start;
+
+	qsort(samples,SAMPLES,sizeof(*samples),compare_u64);
+	uint64_t median = samples[SAMPLES / 2];
+	for(int i = 0;i < SAMPLES;i++)
+		deviations[i] = samples[i] > median ? samples[i] - median : median - samples[i];
+	qsort(deviations,SAMPLES,sizeof(*deviations),compare_u64);
+
+	fprintf(out,"%s\t%u\t%.2f\t%.2f\t%.2f\n",name,calls,(double) median / calls,
+		(double) deviations[SAMPLES / 2] / calls,(double) samples[0] / calls);
+	fflush(out);
+}
+
+int bench_run(FILE *out,const struct Quirks *q,const char *filter){
+	static const struct{
+		const char *name;
+		unsigned short opcodes[2];
+	}classes[] = {
+		{"00E0",{0x00E0}},
+		{"1NNN",{0x1200}},
+		{"2NNN+00EE",{0x2200,0x00EE}},
+		{"3XNN",{0x3142}},
+		{"4XNN",{0x4142}},
+		{"5XY0",{0x5120}},
+		{"6XNN",{0x6142}},
+		{"7XNN",{0x7142}},
+		{"8XY0",{0x8120}},
+		{"8XY1",{0x8121}},
+		{"8XY4",{0x8124}},
+		{"8XY5",{0x8125}},
+		{"8XY6",{0x8126}},
+		{"8XYE",{0x812E}},
+		{"9XY0",{0x9120}},
+		{"ANNN",{0xA300}},
+		{"BNNN",{0xB200}},
+		{"CXNN",{0xC1FF}},
+		{"DXY5",{0xD125}},
+		{"EX9E",{0xE19E}},
+		{"EXA1",{0xE1A1}},
+		{"FX07",{0xF107}},
+		{"FX15",{0xF115}},
+		{"FX18",{0xF118}},
+		{"FX1E",{0xF11E}},
+		{"FX29",{0xF129}},
+		{"FX33",{0xF033}}, // V0 is 255,the BCD loop's worst case
+		{"FX55",{0xFF55}},
+		{"FX65",{0xFF65}}
+	};
+	struct BenchContext b = {.q = q};
+	char name[64];
+
+	bench_machine(&b.c8);
+	fprintf(out,"# %s profile,%d samples after %d to warm up\n",q->name,SAMPLES,WARMUP);
+	fprintf(out,"name\tcalls\tmedian_ns\tmad_ns\tmin_ns\n");
+
+	measure(out,filter,"fetch",100000,bench_fetch,&b);
+
+	for(size_t i = 0;i < sizeof(classes) / sizeof(*classes);i++){
+		b.opcodes[0] = classes[i].opcodes[0];
+		b.opcodes[1] = classes[i].opcodes[1];
+		snprintf(name,sizeof(name),"execute/%s",classes[i].name);
+		measure(out,filter,name,100000,bench_execute,&b);
+	}
+
+	for(int aligned = 1;aligned >= 0;aligned--){
+		for(int height = 1;height <= 15;height++){
+			b.x = aligned ? 8 : 11;
+			b.height = height;
+			snprintf(name,sizeof(name),"draw/%s/%d",aligned ? "aligned" : "unaligned",height);
+			measure(out,filter,name,10000,bench_draw,&b);
+		}
+	}
+
+	measure(out,filter,"clear_screen",100000,bench_clear,&b);
+
+	/* What a game does in a frame: some arithmetic with flags nobody reads,a sprite and its score
+	 * written with FX33 to another page than the code,and a jump back*/
+	static const uint16_t loop[] = {
+		0xA400,0xF333,0x6105,0x6203,0x8124,0x8125,0x7301,0x8436,0x8F30,0xA300,0xD125,0x8414,
+		0x4300,0x1200,0x1200
+	};
+	const struct Chip8 random = b.c8;
+	for(size_t i = 0;i < sizeof(loop) / sizeof(*loop);i++){
+		b.c8.memory[0x200 + i * 2] = loop[i] >> 8;
+		b.c8.memory[0x201 + i * 2] = loop[i] & 0xFF;
+	}
+	chip8_wrote(&b.c8,0x200,sizeof(loop));
+	for(const struct Engine *e = engines;e->name != NULL;e++){
+		b.engine = e;
+		snprintf(name,sizeof(name),"run/%s",e->name);
+		measure(out,filter,name,100000,bench_engine,&b);
+	}
+	b.c8 = random;
+
+	// render_screen() without a window to look at,SDL_VIDEO_DRIVER in the environment still wins
+	if(wanted(filter,"render_screen/rects") || wanted(filter,"render_screen/phosphor")){
+		SDL_SetHint(SDL_HINT_VIDEO_DRIVER,"offscreen");
+		if(!game_new(&b.game)){
+			fprintf(stderr,"No renderer for the render_screen benchmarks: %s\n",SDL_GetError());
+			game_free(&b.game);
+			return 0;
+		}
+		measure(out,filter,"render_screen/rects",100,bench_render,&b);
+		b.game->phosphor = true;
+		measure(out,filter,"render_screen/phosphor",1000,bench_render,&b);
+		game_free(&b.game);
+	}
+
+	return 0;
+}
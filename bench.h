@@ -0,0 +1,10 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include<stdio.h>
+
+#include"chip_8.h"
+
+int bench_run(FILE *out,const struct Quirks *q,const char *filter);
+
+#endif
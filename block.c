@@ -0,0 +1,481 @@
+#include<stdbool.h>
+#include<stdint.h>
+#include<string.h>
+
+#include"chip_8.h"
+#include"block.h"
+
+/* The block engine: predecoded basic blocks with dead VF elimination.
+ *
+ * Straight line code is decoded once into a block (up to a jump,call,return,skip,FX0A,a write to
+ * memory,which might be to code,a DXYN that ends the frame or the end of the 256 byte page) and 
+ * kept in a small per thread cache keyed by the address. A block remembers the generation of its 
+ * page (see struct Chip8) and is only used while the page still has it,so self-modifying code and
+ * other machines on the same thread just decode again and entering a block is one comparison.
+ *
+ * Most of the instructions that set VF as a flag (8XY1-3 with the VF reset quirk,8XY4-8XYE and the
+ * collision of DXYN) have it overwritten again by the game before anything reads it. A backward 
+ * pass over each block finds,for every instruction,the next one in the block that overwrites VF 
+ * without reading it first. If that one is going to run too,the flag is dead and isn't computed:
+ * the arithmetic drops the carry/borrow/shifted out bit and DXYN only XORs the sprite in without
+ * looking for collisions. VF is taken to be live at the end of a block and at the end of a run,so 
+ * everything outside of a block sees exactly the same machine as with the reference engine.
+ *
+ * Semantics otherwise follow reference.c.*/
+
+enum{
+	OP_NOP,
+	OP_CLS,
+	OP_RET,
+	OP_JP,
+	OP_CALL,
+	OP_SE_NN,
+	OP_SNE_NN,
+	OP_SE_XY,
+	OP_LD_NN,
+	OP_ADD_NN,
+	OP_LD_XY,
+	OP_OR,
+	OP_AND,
+	OP_XOR,
+	OP_ADD,
+	OP_SUB,
+	OP_SHR,
+	OP_SUBN,
+	OP_SHL,
+	OP_SNE_XY,
+	OP_LD_I,
+	OP_JP_V,
+	OP_RND,
+	OP_DRW,
+	OP_SKP,
+	OP_SKNP,
+	OP_GET_DT,
+	OP_WAIT_KEY,
+	OP_SET_DT,
+	OP_SET_ST,
+	OP_ADD_I,
+	OP_FONT,
+	OP_BCD,
+	OP_STORE,
+	OP_LOAD
+};
+
+#define LIVE 0xFF // no instruction in the block overwrites VF before it's read (or the block ends)
+
+struct Insn{
+	uint16_t op;
+	uint8_t kind;
+	uint8_t killer; // the next instruction that overwrites VF without reading it,or LIVE
+};
+
+struct Block{
+	const struct Quirks *q;
+	uint64_t generation; // of the page it was decoded from
+	uint16_t pc;
+	uint8_t len;
+	bool valid;
+	struct Insn insns[BLOCK_MAX];
+};
+
+static _Thread_local struct Block cache[BLOCK_CACHE];
+static _Thread_local struct Block straddling; // an instruction split over two pages,never cached
+
+bool block_step(struct Chip8 *c8,const struct Quirks *q);
+unsigned block_run(struct Chip8 *c8,const struct Quirks *q,unsigned budget);
+
+static uint8_t decode(uint16_t op){
+	switch(op >> 12){
+		case 0x0: return op == 0x00E0 ? OP_CLS : op == 0x00EE ? OP_RET : OP_NOP;
+		case 0x1: return OP_JP;
+		case 0x2: return OP_CALL;
+		case 0x3: return OP_SE_NN;
+		case 0x4: return OP_SNE_NN;
+		case 0x5: return OP_SE_XY;
+		case 0x6: return OP_LD_NN;
+		case 0x7: return OP_ADD_NN;
+		case 0x8:
+			switch(op & 0xF){
+				case 0x0: return OP_LD_XY;
+				case 0x1: return OP_OR;
+				case 0x2: return OP_AND;
+				case 0x3: return OP_XOR;
+				case 0x4: return OP_ADD;
+				case 0x5: return OP_SUB;
+				case 0x6: return OP_SHR;
+				case 0x7: return OP_SUBN;
+				case 0xE: return OP_SHL;
+			}
+			return OP_NOP;
+		case 0x9: return OP_SNE_XY;
+		case 0xA: return OP_LD_I;
+		case 0xB: return OP_JP_V;
+		case 0xC: return OP_RND;
+		case 0xD: return OP_DRW;
+		case 0xE: return (op & 0xFF) == 0x9E ? OP_SKP : (op & 0xFF) == 0xA1 ? OP_SKNP : OP_NOP;
+		case 0xF:
+			switch(op & 0xFF){
+				case 0x07: return OP_GET_DT;
+				case 0x0A: return OP_WAIT_KEY;
+				case 0x15: return OP_SET_DT;
+				case 0x18: return OP_SET_ST;
+				case 0x1E: return OP_ADD_I;
+				case 0x29: return OP_FONT;
+				case 0x33: return OP_BCD;
+				case 0x55: return OP_STORE;
+				case 0x65: return OP_LOAD;
+			}
+			return OP_NOP;
+	}
+	return OP_NOP;
+}
+
+// Whether the instruction is the last one of its block
+static bool ends_block(const struct Insn *in,const struct Quirks *q){
+	switch(in->kind){
+		case OP_RET: case OP_JP: case OP_CALL: case OP_JP_V:
+		case OP_SE_NN: case OP_SNE_NN: case OP_SE_XY: case OP_SNE_XY: case OP_SKP: case OP_SKNP:
+		case OP_WAIT_KEY: case OP_BCD: case OP_STORE:
+			return true;
+		case OP_DRW:
+			return q->display_wait;
+	}
+	return false;
+}
+
+// How the instruction uses VF: reads it (before writing it) and/or leaves a new value in it
+static void vf_use(const struct Insn *in,const struct Quirks *q,bool *reads,bool *writes){
+	int x = in->op >> 8 & 0xF,y = in->op >> 4 & 0xF;
+	bool xf = x == 0xF,yf = y == 0xF;
+
+	*reads = false;
+	*writes = false;
+	switch(in->kind){
+		case OP_SE_NN: case OP_SNE_NN: case OP_SKP: case OP_SKNP:
+		case OP_SET_DT: case OP_SET_ST: case OP_ADD_I: case OP_FONT: case OP_BCD:
+			*reads = xf;
+			break;
+		case OP_SE_XY: case OP_SNE_XY:
+			*reads = xf || yf;
+			break;
+		case OP_JP_V:
+			*reads = q->jump && xf;
+			break;
+		case OP_LD_NN: case OP_RND: case OP_GET_DT: case OP_LOAD:
+			*writes = xf;
+			break;
+		case OP_ADD_NN:
+		case OP_WAIT_KEY: // only writes Vx once a key is down,and then uses it to release the key
+			*reads = *writes = xf;
+			break;
+		case OP_LD_XY:
+			*reads = yf;
+			*writes = xf;
+			break;
+		case OP_OR: case OP_AND: case OP_XOR:
+			*reads = xf || yf;
+			*writes = xf || q->vf_reset;
+			break;
+		case OP_ADD: case OP_SUB: case OP_SUBN: case OP_DRW:
+			*reads = xf || yf;
+			*writes = true;
+			break;
+		case OP_SHR: case OP_SHL:
+			*reads = q->shift ? xf : yf;
+			*writes = true;
+			break;
+		case OP_STORE:
+			*reads = xf;
+			break;
+	}
+}
+
+static const struct Block *block_get(const struct Chip8 *c8,const struct Quirks *q){
+	uint16_t pc = c8->registers.PC;
+	uint64_t generation = c8->generation[pc >> 8];
+	struct Block *b = &cache[(pc ^ pc >> 8) % BLOCK_CACHE];
+
+	if(b->valid && b->pc == pc && b->q == q && b->generation == generation)
+		return b;
+
+	if((pc & 0xFF) == 0xFF)
+		b = &straddling;
+	b->q = q;
+	b->generation = generation;
+	b->pc = pc;
+	b->len = 0;
+	for(uint16_t addr = pc;b->len < BLOCK_MAX;addr = (addr + 2) & 0xFFF){
+		struct Insn *in = &b->insns[b->len++];
+		in->op = c8->memory[addr] << 8 | c8->memory[(addr + 1) & 0xFFF];
+		in->kind = decode(in->op);
+		if(ends_block(in,q) || (addr + 3) >> 8 != pc >> 8) // the next one isn't all in the page
+			break;
+	}
+
+	// Backwards: the next instruction that overwrites VF before it's read
+	uint8_t killer = LIVE;
+	for(int i = b->len - 1;i >= 0;i--){
+		bool reads,writes;
+		b->insns[i].killer = killer;
+		vf_use(&b->insns[i],q,&reads,&writes);
+		if(reads)
+			killer = LIVE;
+		else if(writes)
+			killer = i;
+	}
+
+	b->valid = b != &straddling;
+	return b;
+}
+
+// reference_draw() without the collisions when `collide` is false
+static inline bool draw(struct Chip8 *c8,const struct Quirks *q,int x,int y,int n,const bool collide){
+	bool collision = false;
+
+	x %= DISPLAY_WIDTH;
+	y %= DISPLAY_HEIGHT;
+
+	for(int row = 0;row < n;row++){
+		int py = y + row;
+		if(py >= DISPLAY_HEIGHT && !q->wrap)
+			break;
+		py %= DISPLAY_HEIGHT;
+
+		uint8_t sprite = c8->memory[(c8->registers.I + row) & 0xFFF];
+		bool *line = c8->display[py];
+
+		for(int col = 0;col < 8;col++){
+			int px = x + col;
+			if(px >= DISPLAY_WIDTH && !q->wrap)
+				break;
+			px %= DISPLAY_WIDTH;
+
+			if(sprite & (0x80 >> col)){
+				if(collide && line[px])
+					collision = true;
+				line[px] ^= 1;
+			}
+		}
+	}
+
+	return collision;
+}
+
+/* Runs one instruction,`flag` is false if its VF flag is dead. Returns true if it ended the 
+ * frame.*/
+static bool exec(struct Chip8 *c8,const struct Quirks *q,const struct Insn *in,bool flag){
+	_registers *r = &c8->registers;
+	uint8_t *V = r->V;
+	uint16_t op = in->op,pc = r->PC;
+	int x = op >> 8 & 0xF,y = op >> 4 & 0xF,n = op & 0xF,nn = op & 0xFF,nnn = op & 0xFFF;
+	int carry;
+
+	r->PC = (pc + 2) & 0xFFF;
+
+	switch(in->kind){
+		case OP_NOP:
+			break;
+		case OP_CLS:
+			memset(c8->display,0,sizeof(c8->display));
+			break;
+		case OP_RET:
+			if(c8->sp > 0)
+				r->PC = c8->stack[--c8->sp];
+			break;
+		case OP_JP:
+			r->PC = nnn;
+			break;
+		case OP_CALL:
+			if(c8->sp < 16)
+				c8->stack[c8->sp++] = r->PC;
+			r->PC = nnn;
+			break;
+		case OP_SE_NN:
+			if(V[x] == nn)
+				r->PC = (r->PC + 2) & 0xFFF;
+			break;
+		case OP_SNE_NN:
+			if(V[x] != nn)
+				r->PC = (r->PC + 2) & 0xFFF;
+			break;
+		case OP_SE_XY:
+			if(V[x] == V[y])
+				r->PC = (r->PC + 2) & 0xFFF;
+			break;
+		case OP_LD_NN:
+			V[x] = nn;
+			break;
+		case OP_ADD_NN:
+			V[x] += nn;
+			break;
+		case OP_LD_XY:
+			V[x] = V[y];
+			break;
+		case OP_OR:
+			V[x] |= V[y];
+			if(q->vf_reset && flag)
+				V[0xF] = 0;
+			break;
+		case OP_AND:
+			V[x] &= V[y];
+			if(q->vf_reset && flag)
+				V[0xF] = 0;
+			break;
+		case OP_XOR:
+			V[x] ^= V[y];
+			if(q->vf_reset && flag)
+				V[0xF] = 0;
+			break;
+		case OP_ADD:
+			if(!flag){
+				V[x] += V[y];
+				break;
+			}
+			carry = V[x] + V[y] > 0xFF;
+			V[x] += V[y];
+			V[0xF] = carry;
+			break;
+		case OP_SUB:
+			if(!flag){
+				V[x] -= V[y];
+				break;
+			}
+			carry = V[x] >= V[y];
+			V[x] -= V[y];
+			V[0xF] = carry;
+			break;
+		case OP_SHR:
+			if(!q->shift)
+				V[x] = V[y];
+			if(!flag){
+				V[x] >>= 1;
+				break;
+			}
+			carry = V[x] & 1;
+			V[x] >>= 1;
+			V[0xF] = carry;
+			break;
+		case OP_SUBN:
+			if(!flag){
+				V[x] = V[y] - V[x];
+				break;
+			}
+			carry = V[y] >= V[x];
+			V[x] = V[y] - V[x];
+			V[0xF] = carry;
+			break;
+		case OP_SHL:
+			if(!q->shift)
+				V[x] = V[y];
+			if(!flag){
+				V[x] <<= 1;
+				break;
+			}
+			carry = V[x] >> 7;
+			V[x] <<= 1;
+			V[0xF] = carry;
+			break;
+		case OP_SNE_XY:
+			if(V[x] != V[y])
+				r->PC = (r->PC + 2) & 0xFFF;
+			break;
+		case OP_LD_I:
+			r->I = nnn;
+			break;
+		case OP_JP_V:
+			r->PC = (nnn + V[q->jump ? x : 0]) & 0xFFF;
+			break;
+		case OP_RND:
+			V[x] = chip8_rand(c8) & nn;
+			break;
+		case OP_DRW:
+			if(flag)
+				V[0xF] = draw(c8,q,V[x],V[y],n,true);
+			else
+				draw(c8,q,V[x],V[y],n,false);
+			return q->display_wait;
+		case OP_SKP:
+			if(c8->keypad[V[x] & 0xF])
+				r->PC = (r->PC + 2) & 0xFFF;
+			c8->keypad[V[x] & 0xF] = false;
+			break;
+		case OP_SKNP:
+			if(!c8->keypad[V[x] & 0xF])
+				r->PC = (r->PC + 2) & 0xFFF;
+			break;
+		case OP_GET_DT:
+			V[x] = c8->delay_timer;
+			break;
+		case OP_WAIT_KEY:
+			carry = -1;
+			for(int k = 0;k < 16;k++)
+				if(c8->keypad[k]){
+					carry = k;
+					break;
+				}
+			if(carry < 0)
+				r->PC = pc;
+			else
+				V[x] = carry;
+			c8->keypad[V[x] & 0xF] = false;
+			break;
+		case OP_SET_DT:
+			c8->delay_timer = V[x];
+			break;
+		case OP_SET_ST:
+			c8->sound_timer = V[x];
+			break;
+		case OP_ADD_I:
+			r->I = (r->I + V[x]) & 0xFFF;
+			break;
+		case OP_FONT:
+			r->I = (0x50 + V[x] * 5) & 0xFFF;
+			break;
+		case OP_BCD:
+			c8->memory[r->I] = V[x] / 100;
+			c8->memory[(r->I + 1) & 0xFFF] = V[x] / 10 % 10;
+			c8->memory[(r->I + 2) & 0xFFF] = V[x] % 10;
+			chip8_wrote(c8,r->I,3);
+			break;
+		case OP_STORE:
+			for(int k = 0;k <= x;k++)
+				c8->memory[(r->I + k) & 0xFFF] = V[k];
+			chip8_wrote(c8,r->I,x + 1);
+			if(q->memory)
+				r->I = (r->I + x + 1) & 0xFFF;
+			break;
+		case OP_LOAD:
+			for(int k = 0;k <= x;k++)
+				V[k] = c8->memory[(r->I + k) & 0xFFF];
+			if(q->memory)
+				r->I = (r->I + x + 1) & 0xFFF;
+			break;
+	}
+
+	return false;
+}
+
+// One instruction with every flag computed,for stepping through (e.g. difftest's bisection)
+bool block_step(struct Chip8 *c8,const struct Quirks *q){
+	return exec(c8,q,&block_get(c8,q)->insns[0],true);
+}
+
+/* Runs whole blocks while they fit in the budget. The last one may be cut short,a flag is only 
+ * dropped if the instruction that overwrites it runs before the cut.*/
+unsigned block_run(struct Chip8 *c8,const struct Quirks *q,unsigned budget){
+	unsigned n = 0;
+
+	while(n < budget){
+		const struct Block *b = block_get(c8,q);
+		unsigned len = b->len < budget - n ? b->len : budget - n;
+
+		for(unsigned i = 0;i < len;i++){
+			const struct Insn *in = &b->insns[i];
+			n++;
+			if(exec(c8,q,in,in->killer >= len))
+				return n;
+		}
+	}
+
+	return n;
+}
@@ -0,0 +1,12 @@
+#ifndef BLOCK_H
+#define BLOCK_H
+
+#include"chip_8.h"
+
+#define BLOCK_MAX 32 // instructions
+#define BLOCK_CACHE 256 // blocks per thread,direct mapped by address
+
+bool block_step(struct Chip8 *c8,const struct Quirks *q);
+unsigned block_run(struct Chip8 *c8,const struct Quirks *q,unsigned budget);
+
+#endif
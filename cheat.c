@@ -0,0 +1,207 @@
+#include<stdbool.h>
+#include<stdint.h>
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+
+#include"chip_8.h"
+#include"cheat.h"
+#include"paged.h"
+
+/* Memory search ("cheat search"),to find where a game keeps its score or lives: start with every
+ * byte of memory and V0-VF as a candidate,then narrow them down with filters like "equal to 3" or
+ * "went down since the last search". Each filter is a pass over a snapshot of every machine,16 bytes
+ * at a time through GCC's vector extensions,against the previous snapshot or the value. Searching
+ * a batch of machines (see vecenv.h,the _paged() functions for --paged batches) keeps only what 
+ * holds on all of them,which narrows it down a lot faster than a single one.
+ *
+ * What's found can be frozen: written back after every frame.*/
+
+typedef uint8_t u8x16 __attribute__((vector_size(16)));
+
+struct Frozen{
+	uint16_t addr;
+	uint8_t value;
+};
+
+unsigned cheat_frozen;
+static struct Frozen frozen[CHEAT_FROZEN_MAX];
+
+struct CheatSearch *cheat_new(unsigned n);
+void cheat_free(struct CheatSearch *s);
+void cheat_reset(struct CheatSearch *s,const struct Chip8 *machines);
+unsigned cheat_filter(struct CheatSearch *s,const struct Chip8 *machines,int op,uint8_t value);
+void cheat_reset_paged(struct CheatSearch *s,const struct PagedChip8 *machines);
+unsigned cheat_filter_paged(struct CheatSearch *s,const struct PagedChip8 *machines,int op,uint8_t value);
+int cheat_next(const struct CheatSearch *s,int from);
+uint8_t cheat_read(const struct Chip8 *c8,unsigned addr);
+uint8_t cheat_read_paged(const struct PagedChip8 *m,unsigned addr);
+bool cheat_freeze(unsigned addr,uint8_t value);
+void cheat_unfreeze_all(void);
+void cheat_apply(struct Chip8 *c8);
+void cheat_print_frozen(void);
+
+struct CheatSearch *cheat_new(unsigned n){
+	struct CheatSearch *s = calloc(1,sizeof(*s));
+	if(s == NULL || (s->last = calloc(n,sizeof(*s->last))) == NULL){
+		if(debug_flag)
+			fprintf(stderr,"Error while allocating memory\n");
+		free(s);
+		return NULL;
+	}
+	s->n = n;
+	return s;
+}
+
+void cheat_free(struct CheatSearch *s){
+	if(s){
+		free(s->last);
+		free(s);
+	}
+}
+
+static inline void snapshot(uint8_t out[CHEAT_BYTES],const struct Chip8 *c8){
+	memcpy(out,c8->memory,CHEAT_V);
+	memcpy(out + CHEAT_V,c8->registers.V,16);
+	memset(out + CHEAT_SIZE,0,CHEAT_BYTES - CHEAT_SIZE);
+}
+
+// The same bytes from a paged machine,a page at a time whether it's shared or its own
+static inline void snapshot_paged(uint8_t out[CHEAT_BYTES],const struct PagedChip8 *m){
+	for(unsigned p = 0;p < PAGES;p++)
+		memcpy(out + p * PAGE_SIZE,m->pages[p],PAGE_SIZE);
+	memcpy(out + CHEAT_V,m->registers.V,16);
+	memset(out + CHEAT_SIZE,0,CHEAT_BYTES - CHEAT_SIZE);
+}
+
+static void reset(struct CheatSearch *s){
+	memset(s->candidates,0xFF,CHEAT_SIZE);
+	memset(s->candidates + CHEAT_SIZE,0,CHEAT_BYTES - CHEAT_SIZE);
+	s->count = CHEAT_SIZE;
+}
+
+// Everything is a candidate again
+void cheat_reset(struct CheatSearch *s,const struct Chip8 *machines){
+	reset(s);
+	for(unsigned m = 0;m < s->n;m++)
+		snapshot(s->last[m],&machines[m]);
+}
+
+void cheat_reset_paged(struct CheatSearch *s,const struct PagedChip8 *machines){
+	reset(s);
+	for(unsigned m = 0;m < s->n;m++)
+		snapshot_paged(s->last[m],&machines[m]);
+}
+
+// Keeps the candidates for which `op` holds on machine `m`,whose snapshot is `now`
+static void narrow(struct CheatSearch *s,unsigned m,const uint8_t *now,int op,uint8_t value){
+	const u8x16 v = (u8x16){0} + value;
+
+	for(unsigned i = 0;i < CHEAT_BYTES;i += 16){
+		u8x16 cur,last,keep,*cand = (u8x16 *) (s->candidates + i);
+		memcpy(&cur,now + i,16);
+		memcpy(&last,s->last[m] + i,16);
+
+		switch(op){
+			case CHEAT_EQ: keep = (u8x16) (cur == v); break;
+			case CHEAT_NE: keep = (u8x16) (cur != v); break;
+			case CHEAT_LT: keep = (u8x16) (cur < v); break;
+			case CHEAT_GT: keep = (u8x16) (cur > v); break;
+			case CHEAT_CHANGED: keep = (u8x16) (cur != last); break;
+			case CHEAT_UNCHANGED: keep = (u8x16) (cur == last); break;
+			case CHEAT_INCREASED: keep = (u8x16) (cur > last); break;
+			case CHEAT_DECREASED: keep = (u8x16) (cur < last); break;
+			default: keep = (u8x16){0}; break;
+		}
+		*cand &= keep;
+	}
+
+	memcpy(s->last[m],now,CHEAT_BYTES);
+}
+
+// The candidates are 0xFF or 0,count them 8 at a time
+static unsigned count(struct CheatSearch *s){
+	unsigned count = 0;
+	for(unsigned i = 0;i < CHEAT_BYTES;i += 8){
+		uint64_t w;
+		memcpy(&w,s->candidates + i,8);
+		count += __builtin_popcountll(w);
+	}
+	return s->count = count / 8;
+}
+
+/* Keeps the candidates for which `op` holds on every machine and takes a new snapshot. Returns the
+ * candidates left.*/
+unsigned cheat_filter(struct CheatSearch *s,const struct Chip8 *machines,int op,uint8_t value){
+	uint8_t now[CHEAT_BYTES] __attribute__((aligned(16)));
+
+	for(unsigned m = 0;m < s->n;m++){
+		snapshot(now,&machines[m]);
+		narrow(s,m,now,op,value);
+	}
+	return count(s);
+}
+
+unsigned cheat_filter_paged(struct CheatSearch *s,const struct PagedChip8 *machines,int op,uint8_t value){
+	uint8_t now[CHEAT_BYTES] __attribute__((aligned(16)));
+
+	for(unsigned m = 0;m < s->n;m++){
+		snapshot_paged(now,&machines[m]);
+		narrow(s,m,now,op,value);
+	}
+	return count(s);
+}
+
+// The first candidate at or after `from`,or -1
+int cheat_next(const struct CheatSearch *s,int from){
+	for(int i = from < 0 ? 0 : from;i < CHEAT_SIZE;i++)
+		if(s->candidates[i])
+			return i;
+	return -1;
+}
+
+uint8_t cheat_read(const struct Chip8 *c8,unsigned addr){
+	return addr >= CHEAT_V ? c8->registers.V[(addr - CHEAT_V) & 0xF] : c8->memory[addr & 0xFFF];
+}
+
+uint8_t cheat_read_paged(const struct PagedChip8 *m,unsigned addr){
+	return addr >= CHEAT_V ? m->registers.V[(addr - CHEAT_V) & 0xF] : paged_load(m,addr);
+}
+
+// Freezes `addr` (CHEAT_V + x for Vx) at `value`,or changes the value it's frozen at
+bool cheat_freeze(unsigned addr,uint8_t value){
+	unsigned i = 0;
+	while(i < cheat_frozen && frozen[i].addr != addr)
+		i++;
+	if(i == CHEAT_FROZEN_MAX)
+		return false;
+	frozen[i] = (struct Frozen){addr,value};
+	if(i == cheat_frozen)
+		cheat_frozen++;
+	return true;
+}
+
+void cheat_unfreeze_all(void){
+	cheat_frozen = 0;
+}
+
+// After every frame,while anything is frozen
+void cheat_apply(struct Chip8 *c8){
+	for(unsigned i = 0;i < cheat_frozen;i++){
+		if(frozen[i].addr >= CHEAT_V)
+			c8->registers.V[(frozen[i].addr - CHEAT_V) & 0xF] = frozen[i].value;
+		else if(c8->memory[frozen[i].addr] != frozen[i].value){
+			c8->memory[frozen[i].addr] = frozen[i].value;
+			chip8_wrote(c8,frozen[i].addr,1);
+		}
+	}
+}
+
+void cheat_print_frozen(void){
+	for(unsigned i = 0;i < cheat_frozen;i++){
+		if(frozen[i].addr >= CHEAT_V)
+			printf("freeze V%X = %02X\n",frozen[i].addr - CHEAT_V,frozen[i].value);
+		else
+			printf("freeze %03X = %02X\n",frozen[i].addr,frozen[i].value);
+	}
+}
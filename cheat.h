@@ -0,0 +1,53 @@
+#ifndef CHEAT_H
+#define CHEAT_H
+
+#include<stdbool.h>
+#include<stdint.h>
+
+#include"chip_8.h"
+#include"paged.h"
+
+// What's searched: memory,then V0-VF at CHEAT_V,padded to whole vectors
+#define CHEAT_V 0x1000
+#define CHEAT_SIZE (CHEAT_V + 16)
+#define CHEAT_BYTES (CHEAT_V + 32)
+#define CHEAT_FROZEN_MAX 16
+
+enum{
+	CHEAT_EQ, // == value
+	CHEAT_NE,
+	CHEAT_LT,
+	CHEAT_GT,
+	CHEAT_CHANGED, // since the last snapshot
+	CHEAT_UNCHANGED,
+	CHEAT_INCREASED,
+	CHEAT_DECREASED
+};
+
+/* A search over `n` machines: an address stays a candidate while the filters hold on all of them.
+ * The machines are a struct Chip8 array (a vecenv's `machines`) or,through the _paged() functions,
+ * a struct PagedChip8 array (its `paged` ones).*/
+struct CheatSearch{
+	unsigned n;
+	unsigned count; // candidates left
+	uint8_t candidates[CHEAT_BYTES] __attribute__((aligned(16))); // 0xFF for a candidate
+	uint8_t (*last)[CHEAT_BYTES]; // per machine,the snapshot the filters compare against
+};
+
+extern unsigned cheat_frozen;
+
+struct CheatSearch *cheat_new(unsigned n);
+void cheat_free(struct CheatSearch *s);
+void cheat_reset(struct CheatSearch *s,const struct Chip8 *machines);
+unsigned cheat_filter(struct CheatSearch *s,const struct Chip8 *machines,int op,uint8_t value);
+void cheat_reset_paged(struct CheatSearch *s,const struct PagedChip8 *machines);
+unsigned cheat_filter_paged(struct CheatSearch *s,const struct PagedChip8 *machines,int op,uint8_t value);
+int cheat_next(const struct CheatSearch *s,int from);
+uint8_t cheat_read(const struct Chip8 *c8,unsigned addr);
+uint8_t cheat_read_paged(const struct PagedChip8 *m,unsigned addr);
+bool cheat_freeze(unsigned addr,uint8_t value);
+void cheat_unfreeze_all(void);
+void cheat_apply(struct Chip8 *c8);
+void cheat_print_frozen(void);
+
+#endif
@@ -1,46 +1,80 @@
 #include<string.h>
+#include<stdatomic.h>
 #include<stdio.h>
 #include<stdbool.h>
 #include<stdlib.h>
 #include<time.h>
+#include<getopt.h>
+#include<unistd.h>
 
+#include"chip_8.h"
+#include"bench.h"
+#include"block.h"
+#include"cheat.h"
 #include"debug.h"
+#include"debugger.h"
 #include"display.h"
-
-extern bool debug_flag;
-bool do_vx_shift = false; 
-bool do_i_increment = true; 
-
-// CHIP-8 has 16 8-bit registers (V0 - VF)  
+#include"latency.h"
+#include"metrics.h"
+#include"netplay.h"
+#include"paged.h"
+#include"difftest.h"
+#include"reference.h"
+#include"reload.h"
+#include"replay.h"
+#include"record.h"
+#include"rom.h"
+#include"romdb.h"
+#include"shm.h"
+#include"terminal.h"
+#include"vecenv.h"
+#include"vip.h"
+#include"wall.h"
+#include"explore.h"
+#include"launcher.h"
+
+bool debug_flag;
+
+// CHIP-8 has 16 8-bit registers (V0 - VF) , see `_registers` in chip_8.h 
 // Registers are just "registers" , there are no "signed" or "unsigned" registers. The signed/unsigned
 // is a software level consturct. All registers are "technically" unsigned because they just hold the 
 // data and don't dictate what's the orientation of the data(i.e. if it's 2's compliment or not).
-typedef struct _registers{ 
-	uint8_t V[0xF + 1]; // A total of 16 registers (15 +1)
-	unsigned _BitInt(12) I; // Address register 
-	unsigned _BitInt(12) PC; // Program counter register 
-}_registers;
 
-// 16 2-bytes worth of stack
-unsigned short stack[16]; 
-/* 4096 bytes worth of memory . first 512(0x200) bytes are reserved i.e. the opcodes need to be loaded
-from 0x200.*/
-extern uint8_t memory[0x1000]; 
+// The machine itself (memory,stack,timers,display...) is a `struct Chip8` , see chip_8.h
+
+// Instructions run per 60Hz frame,set from the ROM database or -s
+unsigned instructions_per_frame = 11;
 
-// Both the timers need to be decremented by 1 , 60 times per sec (i.e. 60 Hz)
-uint8_t delay_timer;
-uint8_t sound_timer; // It makes the computer "beep" as long as it's above 0
+// Emulated frames per host frame while fast forwarding,0 for as many as fit
+unsigned turbo_speed = 0;
 
-int key;
+// Frames to run ahead of the real machine for display,see game_run()
+unsigned run_ahead = 0;
 
 struct Game *g = NULL;
 
-void _fontset();
-const unsigned short fetch(_registers *registers);
-void execute(const unsigned short opcode,_registers *registers);
-void game_run(struct Game *g,_registers *registers,float speed);
-void display_ROM(FILE* rom);
-bool load_ROM(const char *name);
+void _fontset(struct Chip8 *c8);
+const unsigned short fetch(struct Chip8 *c8);
+void execute(const unsigned short opcode,struct Chip8 *c8);
+const struct Quirks *quirks_find(const char *name);
+const struct Engine *engine_find(const char *name);
+void chip8_init(struct Chip8 *c8,uint32_t seed);
+void chip8_tick_timers(struct Chip8 *c8);
+void chip8_wrote(struct Chip8 *c8,unsigned addr,unsigned len);
+unsigned engine_frame(struct Chip8 *c8,unsigned budget);
+void engine_frame_start(struct Chip8 *c8);
+bool engine_frame_left(const struct Chip8 *c8,unsigned n,unsigned budget);
+bool engine_frame_step(struct Chip8 *c8);
+unsigned engine_frame_finish(struct Chip8 *c8,unsigned n,unsigned budget);
+void engine_frame_end(struct Chip8 *c8);
+uint64_t chip8_display_hash(const struct Chip8 *c8);
+uint32_t chip8_mix(uint32_t h);
+void chip8_scripted_input(uint32_t seed,unsigned frame,bool keypad[16]);
+void game_run(struct Game *g,struct Chip8 *c8,float speed);
+void headless_run(struct Chip8 *c8,float speed,unsigned frames,uint32_t input_seed);
+void terminal_run(struct Chip8 *c8,float speed);
+void display_ROM(const uint8_t *rom,size_t len);
+bool load_ROM(struct Chip8 *c8,const char *name);
 
 /* Font:
 It ranged from 0-F and it was stored in the reserved memory (anywhere in it is fine but conventionally it
@@ -70,8 +104,9 @@ Hex:
 0xF0
 */
 
-void _fontset(){
+void _fontset(struct Chip8 *c8){
 	logmsg("_fontset",true,debug_flag);
+	uint8_t *memory = c8->memory;
 
 	unsigned char fonts[16][5] = { 
 		{0xF0, 0x90, 0x90, 0x90, 0xF0}, // 0
@@ -107,13 +142,14 @@ void _fontset(){
 	logmsg("_fontset",false,debug_flag);
 }
 
-const unsigned short fetch(_registers *registers){
+const unsigned short fetch(struct Chip8 *c8){
 	logmsg("fetch",true,debug_flag);
+	_registers *registers = &c8->registers;
 
 	unsigned short opcode = 0x0;
-	unsigned short MSB = memory[registers->PC];
+	unsigned short MSB = c8->memory[registers->PC];
 	MSB <<= 8; // shifting the number into MSB side 
-	unsigned short LSB = memory[registers->PC + 1];
+	unsigned short LSB = c8->memory[(registers->PC + 1) & 0xFFF]; // 0xFFF wraps around to 0x000
 	opcode = opcode | MSB | LSB; 
 
 	registers->PC += 2; // Increment PC by 2 cuz 2 consequitive bytes of memory has been accessed	
@@ -128,836 +164,938 @@ const unsigned short fetch(_registers *registers){
 	return opcode;
 }
 
-/* The opcode's nibbles(4 bits) have different meaning. The first nibble tells what category of 
- * instruction is it.
- *
- * The 2'nd Nibble is `X` which tells which register needs to be used (where `X` is the number. i.e.
- * Vx)
- * The 3'rd Nibble is `Y` which tells which is the 2nd register to be used(where `Y` is the number. i.e.
- * Vy)
- * Note that both `X` and `Y` can range from 0-F.
- * The 4'th Nibble is `N` and it's a const number 
- * 
- * `NN` The 2nd byte (i.e. 3rd and 4th nibble) is a const number
- * `NNN` The 2nd,3rd and 4th nibbles are an address (i.e. a 12 bit memory address)
- */
-void execute(const unsigned short opcode,_registers *registers){
-	logmsg("execute",true,debug_flag);
-	unsigned short first_nibble = 0xF000;
-	unsigned short second_nibble = 0x0F00;
-	unsigned short third_nibble = 0x00F0;
-	unsigned short fourth_nibble = 0x000F;
-	unsigned short N;
-	unsigned short NN = 0x00FF;
-	unsigned short NNN = 0x0FFF;
-	unsigned short X; 
-	unsigned short Y;
-	static int s =0;
-
-	if(debug_flag){
-		printf("First nibble before: %016b(%X)\n",first_nibble,first_nibble);
-		printf("Second nibble before: %016b(%X)\n",second_nibble,second_nibble);
-		printf("Third nibble before: %016b(%X)\n",third_nibble,third_nibble);
-		printf("Fourth nibble before: %016b(%X)\n",fourth_nibble,fourth_nibble);
-	}
-
-	/* Basically this gets the first nibble because the starting 4 bits are 1s and it will turn 
-	 * itself into the first 4 bits of the opcode by ANDing it together and the rest are 0s so 
-	 * whatever be the case they will always remain 0.
-	 */
-	first_nibble &= opcode; 
-	first_nibble >>= 12;
-	second_nibble &= opcode; 
-	second_nibble >>= 8;
-	third_nibble &= opcode; 
-	third_nibble >>= 4;
-	fourth_nibble &= opcode; 
-	N = fourth_nibble;
-	NN &= opcode;
-	NNN &= opcode;
-	X = second_nibble;
-	Y = third_nibble;
-
-	if(debug_flag){
-		printf("First nibble after: %016b(%X)\n",first_nibble,first_nibble);
-		printf("Second nibble after: %016b(%X)\n",second_nibble,second_nibble);
-		printf("Third nibble after: %016b(%X)\n",third_nibble,third_nibble);
-		printf("Fourth nibble after: %016b(%X)\n",fourth_nibble,fourth_nibble);
-		printf("The addr of g is %p and is_runing %d\n",g,g->is_running);
-	}
-
+// The interpreters over struct Chip8,one per quirk profile
+#define INTERP_MACHINE struct Chip8
+#define INTERP_PREFIX
+#define INTERP_PARAMS
+#define INTERP_ARGS
+#define INTERP_FETCH(c8) fetch(c8)
+#define INTERP_LOAD(c8,addr) (c8)->memory[(addr) & 0xFFF]
+#define INTERP_STORE(c8,addr,v) ((c8)->memory[(addr) & 0xFFF] = (v))
+#define INTERP_WROTE(c8,addr,len) chip8_wrote(c8,addr,len)
+#define INTERP_DUMP(c8,from,to) _memoryframe((c8)->memory,from,to)
+#define INTERP_CLEAR(c8) clear_screen(c8)
+#define INTERP_DRAW(c8,x,y,n) draw(c8,x,y,n,(c8)->registers.I)
+#define INTERP_DRAW_WRAP(c8,x,y,n) draw_wrap(c8,x,y,n,(c8)->registers.I)
+#define INTERP_RAND(c8) chip8_rand(c8)
+#include"profiles.h"
+
+const struct Quirks quirk_profiles[] = {
+	[QUIRKS_CHIP8] = {"chip8","COSMAC VIP CHIP-8",true,true,false,false,true,false,run_chip8,execute_chip8},
+	[QUIRKS_SCHIP] = {"schip","SUPER-CHIP 1.1",false,false,true,false,false,true,run_schip,execute_schip},
+	[QUIRKS_XOCHIP] = {"xochip","XO-CHIP",false,true,false,true,false,false,run_xochip,execute_xochip},
+	{NULL}
+};
+
+// The profile picked at load time, defaults to the original CHIP-8 
+const struct Quirks *quirks = &quirk_profiles[0];
+
+const struct Quirks *quirks_find(const char *name){
+	for(const struct Quirks *q = quirk_profiles;q->name != NULL;q++)
+		if(strcmp(q->name,name) == 0)
+			return q;
 
-	switch(first_nibble){
-		case 0x0:
-			/* Valid instructions:
-			 * 00E0 => Clears the screen
-			 * 00EE => Returns from the subroutine*/
-			
-			if(debug_flag)
-				printf("Welcome to case 0\n");
-
-			switch(fourth_nibble){
-				case 0x0:
-					if(debug_flag)
-						printf("Welcome to case 00E0\n");
-					clear_screen(g);
-			
-					break;
-
-				case 0xE:
-					if(debug_flag){
-						printf("Welcome to case 00EE\n");
-						printf("PC's value before is 0x%X\n",(int)registers->PC);
-					}
-
-					if(s != 0)
-						registers->PC = stack[--s];	
-
-					if(debug_flag)
-						printf("PC's value after is 0x%X\n",(int)registers->PC);
-					
-					break;
-			}
-			
-			break;
-
-		case 0x1:
-			/* Valid instructions:
-			 * 1NNN => Jumps to address NNN */
-
-			if(debug_flag){
-				printf("Welcome to case 1\n");
-				printf("PC's value is 0x%X\n",(int)registers->PC);
-			}
-			registers->PC = NNN;
+	if(debug_flag)
+		fprintf(stderr,"Unknown quirk profile %s\n",name);
 
-			break;
-		case 0x2:
-			/* Valid instructions:
-			 * 2NNN => Calls to address NNN. The difference between calling and jumping
-			 *         is that in call the address of the current PC will be pushed in 
-			 *         the stack and when the function ends (i.e. returned) the value
-			 *         will be popped of the stack*/
+	return NULL;
+}
 
-			if(debug_flag){
-				printf("Welcome to case 2NNN\n");
-				printf("PC's value is 0x%X\n",(int)registers->PC);
-			}
+// Executes a single instruction with the current quirk profile
+void execute(const unsigned short opcode,struct Chip8 *c8){
+	quirks->execute(opcode,c8);
+}
 
-			stack[s++] = registers->PC;
-			registers->PC = NNN;
+static unsigned interp_run(struct Chip8 *c8,const struct Quirks *q,unsigned budget){
+	return q->run(c8,budget);
+}
 
-			break;
+static bool interp_step(struct Chip8 *c8,const struct Quirks *q){
+	return q->execute(fetch(c8),c8);
+}
 
-		case 0x3:
-			/* Valid instructions:
-			 * 3XNN => Compares Vx and NN (Vx == NN), if true then it 
-			 * skips next instruction */
+const struct Engine engines[] = {
+	{"interp","switch interpreter generated per quirk profile (interpreter.h)",interp_run,interp_step},
+	{"ref","plain reference interpreter (reference.c)",reference_run,reference_step},
+	{"paged","the generated interpreter over shared copy on write pages (paged.c)",
+	 paged_engine_run,paged_engine_step},
+	{"block","predecoded basic blocks with dead VF flags left out (block.c)",block_run,block_step},
+	{NULL}
+};
 
-			if(debug_flag){
-				printf("Welcome to case 3\n");
-				printf("PC's value before is 0x%X\n",(int)registers->PC);
-			}
-			if(registers->V[X] == NN)
-				registers->PC += 2;
+const struct Engine *engine_find(const char *name){
+	for(const struct Engine *e = engines;e->name != NULL;e++)
+		if(strcmp(e->name,name) == 0)
+			return e;
 
-			if(debug_flag)
-				printf("PC's value after is 0x%X\n",(int)registers->PC);
+	if(debug_flag)
+		fprintf(stderr,"Unknown engine %s\n",name);
 
-			break;
-		case 0x4:
-			/* Valid instructions:
-			 * 4XNN => Compares Vx and NN (Vx != NN), if true then 
-			 * it skips next instruction */
+	return NULL;
+}
 
-			if(debug_flag){
-				printf("Welcome to case 4\n");
-				printf("PC's value before is 0x%X\n",(int)registers->PC);
-			}
-			if(registers->V[X] != NN)
-				registers->PC += 2;
+// Resets the machine to its power on state (font loaded,PC at 0x200)
+void chip8_init(struct Chip8 *c8,uint32_t seed){
+	memset(c8,0,sizeof(*c8));
+	c8->registers.PC = 0x200; // starting from the unreserved section
+	c8->rng = seed ? seed : 1; // xorshift gets stuck at 0
+	_fontset(c8);
+	chip8_wrote(c8,0,sizeof(c8->memory));
+}
 
-			if(debug_flag)
-				printf("PC's value after is 0x%X\n",(int)registers->PC);
+void chip8_tick_timers(struct Chip8 *c8){
+	if(c8->delay_timer > 0)
+		c8->delay_timer--;
 
-			break;
-		case 0x5:
-			/* Valid instructions:
-			 * 5XY0 => Compares Vx and Vy (Vx == Vy), if true then 
-			 * it skips next instruction */
+	if(c8->sound_timer > 0)
+		c8->sound_timer--;
+}
 
-			if(debug_flag){
-				printf("Welcome to case 5\n");
-				printf("PC's value before is 0x%X\n",(int)registers->PC);
-			}
-			if(registers->V[X] == registers->V[Y])
-				registers->PC += 2;
+/* Generations are handed out to a thread 2^32 at a time,so they're never the same twice without an
+ * atomic for every write*/
+static atomic_uint_fast64_t generations = 1;
+static _Thread_local uint64_t generation_next,generation_end;
 
-			if(debug_flag)
-				printf("PC's value after is 0x%X\n",(int)registers->PC);
+// Memory from `addr` to `addr + len - 1` (wrapping at 4K) was just written,`len` is at least 1
+void chip8_wrote(struct Chip8 *c8,unsigned addr,unsigned len){
+	if(generation_next == generation_end){
+		generation_next = atomic_fetch_add_explicit(&generations,1ULL << 32,memory_order_relaxed);
+		generation_end = generation_next + (1ULL << 32);
+	}
 
+	uint64_t generation = generation_next++;
+	unsigned last = ((addr + len - 1) & 0xFFF) >> 8;
+	for(unsigned p = (addr & 0xFFF) >> 8;;p = (p + 1) & 0xF){
+		c8->generation[p] = generation;
+		if(p == last)
 			break;
-		case 0x6:
-			/* Valid instructions:
-			 * 6XNN : Sets Vx to NN */
-
-			if(debug_flag){
-				printf("Welcome to case 6\n");
-				printf("Register %d's value before is 0x%X\n",X,registers->V[X]);
-			}
-
-			registers->V[X] = NN;
+	}
+}
 
-			if(debug_flag)
-				printf("Register %d's value after is 0x%X\n",X,registers->V[X]);
+uint32_t chip8_mix(uint32_t h){
+	h ^= h >> 16;
+	h *= 0x7feb352d;
+	h ^= h >> 15;
+	h *= 0x846ca68b;
+	h ^= h >> 16;
+	return h;
+}
 
-			break;
-		case 0x7:
-			/* Valid instructions:
-			 * 7XNN : Adds Vx to NN */
+/* Keypad for a frame of scripted input (for headless runs and tests): a few random keys held,
+ * changing every 8 frames. A seed of 0 leaves the keypad alone.*/
+void chip8_scripted_input(uint32_t seed,unsigned frame,bool keypad[16]){
+	if(seed == 0)
+		return;
 
-			if(debug_flag){
-				printf("Welcome to case 7\n");
-				printf("Register %d's value before is 0x%X\n",X,registers->V[X]);
-			}
+	uint32_t h = chip8_mix(seed ^ chip8_mix(frame / 8));
+	uint16_t held = h & (h >> 16) & (h >> 8); // ~1 in 8 keys
 
-			registers->V[X] += NN;
+	for(int i = 0;i < 16;i++)
+		keypad[i] = (held >> i) & 1;
+}
 
-			if(debug_flag)
-				printf("Register %d's value after is 0x%X\n",X,registers->V[X]);
+// FNV-1a over the display, cheap enough to be done every frame
+uint64_t chip8_display_hash(const struct Chip8 *c8){
+	const uint8_t *p = (const uint8_t *) c8->display;
+	uint64_t h = 0xcbf29ce484222325ULL;
 
+	for(size_t i = 0;i < sizeof(c8->display);i++){
+		h ^= p[i];
+		h *= 0x100000001b3ULL;
+	}
 
-			break;
-		case 0x8:
-			/* Valid instructions:
-			 * 8XY0 => Set's Vx equal to Vy (Vx = Vy)
-			 * 8XY1 => Set's Vx equal to Vx OR Vy (Vx |= Vy)
-			 * 8XY2 => Set's Vx equal to Vx AND Vy (Vx &= Vy)
-			 * 8XY3 => Set's Vx equal to Vx XOR Vy (Vx ^= Vy)
-			 * 8XY4 => Adds Vy  to Vx,if overflow then VF = 1 else VF = 0 (Vx += Vy)
-			 * 8XY5 => Subtracts Vx from Vy,if underflow then VF = 0 else VF = 1 (Vx -= Vy)
-			 * 8XY6 => Shifts Vx to the right by 1 (Vx >>= 1) , stores LSB before shifting
-			 * 	   into Vf
-			 * 8XY7 => Subtracts Vy from Vx,if underflow then VF = 0 else VF = 1
-			 *	   (Vx= Vy - Vx) 
-			 * 8XYE => Shifts Vx to the left by 1 (Vx <<= 1) , sets VF = 1 if MSB of Vx
-			 * 	   prior to shifting was present , else VF = 0*/
-
-			
-			if(debug_flag)
-				printf("Welcome to case 8\n");
-
-			switch(fourth_nibble){
-				case 0x0:
-					if(debug_flag){
-						printf("Welcome to case 8XY0\n");
-						printf("Register %d's value before is 0x%X\n",X,registers->V[X]);
-					}
-
-					registers->V[X] = registers->V[Y];
-					
-					if(debug_flag)
-						printf("Register %d's value after is 0x%X\n",X,registers->V[X]);
-
-					break;
-
-				case 0x1:
-					if(debug_flag){
-						printf("Welcome to case 8XY1\n");
-						printf("Register %d's value before is 0x%X\n",X,registers->V[X]);
-					}
-
-					registers->V[X] |= registers->V[Y];
-					registers->V[0xF] = 0; // All the bitwise operations reset 
-							       // the flag register to 0
-
-					if(debug_flag)
-						printf("Register %d's value after is 0x%X\n",X,registers->V[X]);
-
-					break;
-				case 0x2:
-					if(debug_flag){
-						printf("Welcome to case 8XY2\n");
-						printf("Register %d's value before is 0x%X\n",X,registers->V[X]);
-					}
-
-					registers->V[X] &= registers->V[Y];
-					registers->V[0xF] = 0;
-
-					if(debug_flag)
-						printf("Register %d's value after is 0x%X\n",X,registers->V[X]);
-
-					break;
-
-				case 0x3:
-					if(debug_flag){
-						printf("Welcome to case 8XY3\n");
-						printf("Register %d's value before is 0x%X\n",X,registers->V[X]);
-					}
-
-					registers->V[X] ^= registers->V[Y];
-					registers->V[0xF] = 0;
-
-					if(debug_flag)
-						printf("Register %d's value after is 0x%X\n",X,registers->V[X]);
-
-					break;
-
-				case 0x4:
-					if(debug_flag){
-						printf("Welcome to case 8XY4\n");
-						printf("Register %d's value before is 0x%X\n",X,registers->V[X]);
-					}
-						
-					// An extra variable for storing the sum is used for an extreme
-					// case like "80F4",if the VF is set before then the sum would
-					// be wrong so hence the result is stored in a different 
-					// variable all together.
-					int sum = registers->V[X] + registers->V[Y];
-
-					registers->V[X] += registers->V[Y];
-
-					if(sum >= 255)
-							registers->V[0xF] = 1;
-					else
-							registers->V[0xF] = 0;
-
-					if(debug_flag){
-						printf("Register %d's value after is 0x%X\n",X,registers->V[X]);
-						printf("Register F's value after is 0x%X\n",registers->V[0xF]);
-					}
-
-					break;
-
-				case 0x5:
-					if(debug_flag){
-						printf("Welcome to case 8XY5\n");
-						printf("Register %d's value before is 0x%X\n",X,registers->V[X]);
-						printf("Register %d's value before is 0x%X\n",Y,registers->V[Y]);
-					}
-					
-					bool _diff = registers->V[X] >= registers->V[Y];
-					
-					registers->V[X] = registers->V[X] - registers->V[Y];
-
-					if(_diff)
-							registers->V[0xF] = 1;
-					else
-							registers->V[0xF] = 0; // underflow
-
-					if(debug_flag){
-						printf("Register %d's value after is 0x%X(%d)\n",X,registers->V[X],registers->V[X]);
-						printf("Register %d's value after is 0x%X\n",Y,registers->V[Y]);
-						printf("Register F's value after is 0x%X\n",registers->V[0xF]);
-					}
-
-					break;
-
-				case 0x6:
-					if(debug_flag){
-						printf("Welcome to case 8XY6\n");
-						printf("Register %d's value before is 0x%X\n",X,registers->V[X]);
-					}
-					
-					unsigned short last_bit = 0x1;
-					
-					if(do_vx_shift){
-						last_bit &= registers->V[X];
-						registers->V[X] = registers->V[X] >>1;
-					}else{
-						last_bit &= registers->V[Y];
-						registers->V[X] = registers->V[Y] >>1;
-					}
-
-
-					if(last_bit == 1)
-						registers->V[0xF] =1;
-					else
-						registers->V[0xF] =0;
-
-					if(debug_flag){
-						printf("Register %d's value after is 0x%X\n",X,registers->V[X]);
-						printf("Register F's value after is 0x%X\n",registers->V[0xF]);
-					}
-
-					break;
-
-
-				case 0x7:
-					if(debug_flag){
-						printf("Welcome to case 8XY7\n");
-						printf("Register %d's value before is 0x%X\n",X,registers->V[X]);
-					}
-					
-					int diff =registers->V[Y] >= registers->V[X]; 
-
-					registers->V[X] = registers->V[Y] - registers->V[X];
-
-					if(diff)
-							registers->V[0xF] = 1;
-					else
-							registers->V[0xF] = 0;
-
-					if(debug_flag){
-						printf("Register %d's value after is 0x%X\n",X,registers->V[X]);
-						printf("Register F's value after is 0x%X\n",registers->V[0xF]);
-					}
-
-					break;
-
-				case 0xE:
-					if(debug_flag){
-						printf("Welcome to case 8XYE\n");
-						printf("Register %d's value before is 0x%X\n",X,registers->V[X]);
-					}
-					
-					unsigned short first_bit = 0x80;
-
-					if(debug_flag)
-						printf("The first bit is:%b from the num:0b%08b\n",first_bit,registers->V[X]);
-
-					if(do_vx_shift){
-						first_bit &= registers->V[X];
-						registers->V[X] = registers->V[X] << 1;
-					}else{
-						first_bit &= registers->V[Y];
-						registers->V[X] = registers->V[Y] << 1;
-					}
-
-					first_bit >>= 7;
-
-					if(first_bit == 1)
-						registers->V[0xF] =1;
-					else
-						registers->V[0xF] =0;
-
-					if(debug_flag){
-						printf("Register %d's value after is 0x%X\n",X,registers->V[X]);
-						printf("Register F's value after is 0x%X\n",registers->V[0xF]);
-					}
-
-					break;
-
-				default:
-					printf("Bad instruction\n");
-					break;
-			}
+	return h;
+}
 
-			break;
+// The machine's instructions for a frame: `speed` of them (or fewer,see game_run()) or --vip timing
+unsigned engine_frame(struct Chip8 *c8,unsigned budget){
+	return vip_timing ? vip_run(c8,quirks) : quirks->run(c8,budget);
+}
 
-		case 0x9:
-			/* Valid instructions:
-			 * 9XY0 => Compares Vx and Vy (Vx != NN), if true then it 
-			 * skips next instruction */
+/* engine_frame() an instruction at a time,for the tools that look at every one of them: 
+ * engine_frame_start(),then engine_frame_step() while engine_frame_left() with `n` instructions run
+ * so far. engine_frame_finish() runs the rest of the frame at full speed.*/
+void engine_frame_start(struct Chip8 *c8){
+	if(vip_timing)
+		vip_frame_start(c8);
+}
 
-			if(debug_flag){
-				printf("Welcome to case 9\n");
-				printf("PC's value before is 0x%X\n",(int)registers->PC);
-			}
-			if(registers->V[X] != registers->V[Y])
-				registers->PC += 2;
+bool engine_frame_left(const struct Chip8 *c8,unsigned n,unsigned budget){
+	return vip_timing ? c8->cycles > 0 : n < budget;
+}
 
-			if(debug_flag)
-				printf("PC's value after is 0x%X\n",(int)registers->PC);
+bool engine_frame_step(struct Chip8 *c8){
+	return vip_timing ? vip_step(c8,quirks) : quirks->execute(fetch(c8),c8);
+}
 
-			break;
+unsigned engine_frame_finish(struct Chip8 *c8,unsigned n,unsigned budget){
+	return vip_timing ? vip_finish(c8,quirks) : quirks->run(c8,budget - n);
+}
 
-		case 0xA:
-			/* Valid instructions:
-			 * ANNN : Sets I to the address NNN.*/
+// What happens to the machine after every frame's instructions
+void engine_frame_end(struct Chip8 *c8){
+	if(cheat_frozen)
+		cheat_apply(c8);
+	chip8_tick_timers(c8);
+}
 
-			if(debug_flag){
-				printf("Welcome to case A\n");
-				printf("Register value before is 0x%X\n",(int)registers->I);
-				printf("mem at the location is:%X\n",memory[registers->I]);
-			}
+// One emulated frame: the instructions then the timers tick once,recorded/exported if asked to
+static unsigned run_frame(struct Chip8 *c8,unsigned budget){
+	unsigned n;
+
+	if(reload_active)
+		reload_poll(c8);
+	if(replay_recording)
+		replay_frame(c8);
+	if(debugger_armed)
+		n = debugger_run(c8,budget);
+	else if(latency_probing)
+		n = latency_run(c8,budget);
+	else
+		n = engine_frame(c8,budget);
+	engine_frame_end(c8);
+	record_frame(c8);
+	shm_export(c8);
 
-			registers->I = NNN;
+	return n;
+}
 
-			if(debug_flag){
-				printf("Register value after is 0x%X\n",(int)registers->I);
-				printf("mem at the location is:%X\n",memory[registers->I]);
+/* The emulation is driven in 60Hz frames: every frame runs `speed` instructions (fewer if the 
+ * profile has the display wait quirk and a DXYN ends the frame early), ticks both the timers once
+ * and renders the display.
+ *
+ * Fast forward (Tab or --turbo) runs `turbo_speed` emulated frames per host frame,or as many as fit
+ * in it if that's 0,and only renders the last one. The timers still tick once per emulated frame
+ * so the game just runs faster.
+ *
+ * Run ahead: after the real frame the machine is copied and the copy runs `run_ahead` more frames
+ * with the same keypad,it's the copy that's shown and then thrown away. Games that only react to a 
+ * key a frame or two later (delay timer loops) show the reaction right away. */
+void game_run(struct Game *g , struct Chip8 *c8,float speed){
+	const Uint64 frame_ns = SDL_NS_PER_SECOND / 60; // i.e. 60Hz
+	Uint64 next = SDL_GetTicksNS();
+	unsigned budget = speed > 0 ? (unsigned) speed : 1;
+	const uint64_t sdl_to_metrics = metrics_now() - SDL_GetTicksNS(); // SDL's clock starts at SDL_Init
+	uint64_t frame = 0;
+	bool local_keys[16] = {0}; // netplay: only this side's keys,the machine gets both sides'
+	char title[128];
+
+	while(g->is_running && !debugger_quit){
+		uint64_t start = metrics_now();
+		game_events(g,netplay_active ? local_keys : c8->keypad);
+		uint64_t polled = metrics_now();
+
+		for(int i = 0;i < 16;i++)
+			if(g->key_pressed_at[i]){
+				latency_key(i,g->key_pressed_at[i] + sdl_to_metrics,frame);
+				g->key_pressed_at[i] = 0;
 			}
+		
+	//	clear_screen(g);
+		unsigned n = netplay_active ? netplay_frame(c8,budget,local_keys) : run_frame(c8,budget);
+		frame++;
+		if(g->turbo && !netplay_active){
+			if(turbo_speed)
+				for(unsigned k = 1;k < turbo_speed && !debugger_quit;k++,frame++)
+					n += run_frame(c8,budget);
+			else // leave a quarter of the frame for rendering
+				for(;SDL_GetTicksNS() < next + frame_ns * 3 / 4 && !debugger_quit;frame++)
+					n += run_frame(c8,budget);
+		}
+		uint64_t emulated = metrics_now(),ran_ahead = emulated;
 
-			break;
-		case 0xB:
-			/* Valid instructions:
-			 * BNNN : Jumps to the address NNN + V0*/
-
-			if(debug_flag){
-				printf("Welcome to case B\n");
-				printf("Register value before is 0x%X\n",(int)registers->PC);
-				printf("Register value 0 before is 0x%X\n",(int)registers->V[0]);
+		if(run_ahead){
+			struct Chip8 ahead = *c8;
+			for(unsigned k = 0;k < run_ahead;k++){
+				engine_frame(&ahead,budget);
+				engine_frame_end(&ahead);
 			}
+			ran_ahead = metrics_now();
+			histogram_add(&metrics.run_ahead_time,ran_ahead - emulated);
+			render_screen(g,&ahead);
+		}else{
+			render_screen(g,c8);
+		}
+		uint64_t presented = metrics_now();
+		metrics_frame(n,start,polled - start,emulated - polled,presented - ran_ahead);
+		latency_present(presented,frame);
+
+		if(metrics.enabled && metrics_summary(title,sizeof(title)))
+			SDL_SetWindowTitle(g->window,title);
+
+		next += frame_ns;
+		Uint64 now = SDL_GetTicksNS();
+		if(now < next){
+			SDL_DelayNS(next - now);
+		}else{
+			next = now; // running behind, don't try to catch up
+			metrics.late_frames++;
+		}
+	}
+}
 
-			registers->PC = NNN + registers->V[0];
-
-			if(debug_flag){
-				printf("Register value after is 0x%X\n",(int)registers->PC);
-			}
+/* Same frames as game_run but without a window and as fast as possible,the keypad follows the 
+ * scripted input for `input_seed` (none if 0). For recording and measuring.*/
+void headless_run(struct Chip8 *c8,float speed,unsigned frames,uint32_t input_seed){
+	unsigned budget = speed > 0 ? (unsigned) speed : 1;
+
+	for(unsigned frame = 0;frame < frames && !debugger_quit;frame++){
+		uint64_t start = metrics.enabled ? metrics_now() : 0;
+		if(latency_enabled){
+			int key = latency_scripted_input(frame,c8->keypad);
+			if(key >= 0)
+				latency_key(key,metrics_now(),frame);
+		}else{
+			chip8_scripted_input(input_seed,frame,c8->keypad);
+		}
+		unsigned n = run_frame(c8,budget);
+		if(metrics.enabled) // frames here are so short that even reading the clock shows
+			metrics_frame(n,start,0,metrics_now() - start,0);
+		if(latency_probing)
+			latency_present(metrics_now(),frame);
+	}
+}
 
+/* game_run for the terminal frontend: 60Hz frames with the keys from stdin,drawn with
+ * terminal_render(). Tab toggles fast forward. */
+void terminal_run(struct Chip8 *c8,float speed){
+	const uint64_t frame_ns = 1000000000 / 60;
+	unsigned budget = speed > 0 ? (unsigned) speed : 1;
+	uint64_t next = metrics_now();
+	char title[128];
+
+	while(!debugger_quit){
+		uint64_t start = metrics_now();
+		if(!terminal_events(c8->keypad))
 			break;
-		case 0xC:
-			/* Valid instructions:
-			 * CXNN : Sets VX to the result of a bitwise and operation on a random number 
-			 * 	 (Typically: 0 to 255) and NN*/
-
-			if(debug_flag){
-				printf("Welcome to case C\n");
-				printf("Register value %d before is 0x%X\n",X,registers->V[X]);
-			}
-
-			registers->V[X] = (rand()%256) & NN; 
+		uint64_t polled = metrics_now();
+
+		unsigned n = run_frame(c8,budget);
+		if(terminal_turbo)
+			for(unsigned k = 1;k < (turbo_speed ? turbo_speed : 4);k++)
+				n += run_frame(c8,budget);
+		uint64_t emulated = metrics_now();
+
+		bool summary = metrics.enabled && metrics_summary(title,sizeof(title));
+		terminal_render(c8,summary ? title : NULL);
+		uint64_t presented = metrics_now();
+		metrics_frame(n,start,polled - start,emulated - polled,presented - emulated);
+
+		next += frame_ns;
+		if(presented < next){
+			struct timespec ts = {next / 1000000000,next % 1000000000};
+			clock_nanosleep(CLOCK_MONOTONIC,TIMER_ABSTIME,&ts,NULL);
+		}else{
+			next = presented;
+			metrics.late_frames++;
+		}
+	}
+}
 
-			if(debug_flag){
-				printf("Register value %d after is 0x%X\n",X,registers->V[X]);
-			}
+/* Steps `n` environments with random actions for `steps` steps and reports the throughput,the 
+ * reward is memory[reward_addr] going up (none if 0).*/
+static int vecenv_bench(const struct Chip8 *start,unsigned n,unsigned steps,uint16_t reward_addr,
+			bool paged){
+	struct VecEnvConfig config = {
+		.quirks = quirks,
+		.speed = instructions_per_frame,
+		.frame_skip = 4,
+		.reward_addr = reward_addr,
+		.reward_bytes = reward_addr ? 1 : 0,
+		.max_frames = 3600,
+		.paged = paged
+	};
+	struct VecEnv *env = vecenv_new(n,start,&config);
+	uint8_t *actions = malloc(n);
+	uint32_t rng = 1;
+	unsigned episodes = 0;
+	double reward = 0;
+
+	if(env == NULL || actions == NULL){
+		fprintf(stderr,"Out of memory for %u environments\n",n);
+		return -1;
+	}
 
-			break;
-		case 0xD:
-			/* Valid instructions:
-			 * DXYN : Draw at coordinate (Vx,Vy) .*/
+	vecenv_reset(env,NULL);
+	uint64_t begin = metrics_now();
+	for(unsigned s = 0;s < steps;s++){
+		for(unsigned i = 0;i < n;i++){
+			rng = chip8_mix(rng + i);
+			actions[i] = rng % 17;
+		}
+		vecenv_step(env,actions);
+		for(unsigned i = 0;i < n;i++){
+			reward += env->rewards[i];
+			episodes += env->dones[i];
+		}
+	}
+	double seconds = (metrics_now() - begin) / 1e9;
+
+	printf("%u environments,%u steps: %.0f steps/s,%.0f frames/s,%u episodes,reward %.0f\n",n,steps,
+	       n * steps / seconds,n * steps * config.frame_skip / seconds,episodes,reward);
+	if(paged)
+		printf("%zu bytes per machine (%zu + %.1f pages of its own),%zu unpaged\n",
+		       sizeof(*env->paged) + env->pool.in_use * PAGE_SIZE / n,sizeof(*env->paged),
+		       (double) env->pool.in_use / n,sizeof(struct Chip8));
+
+	free(actions);
+	vecenv_free(env);
+	return 0;
+}
 
-			if(debug_flag){
-				printf("Welcome to case D\n");
-				printf("memory[I] has : %X\n",memory[(int)registers->I]);
-				printf("Height is %d\n",N);
-				for(int i = 0; i < N;i++)
-					printf("=>%08b\n",memory[(registers->I) +i]);
-			}
-			
-			int x_coor = registers->V[X];
-			int y_coor = registers->V[Y];
-			if(debug_flag)
-				printf("Y and X coordinates are %dx%d\n",y_coor,x_coor);
-			registers->V[0xF] = draw(g,x_coor,y_coor,N,(registers->I));
+void display_ROM(const uint8_t *rom,size_t len){
+	printf("The Instructions of the .ch8 file are:\n");
+	
+	for(size_t i = 0;i < len;i++){
+		printf("%02X",rom[i]);
+		if(i % 2 == 1)
+			printf("\n");
+	}
+	printf("\n");
+}
 
-			break;
-		case 0xE:
-			/* Valid instructions:
-			 * EX9E : Skips the next instruction if the key stored in VX(only consider 
-			 *        the lowest nibble) is pressed (usually the next instruction is a jump 
-			 *        to skip a code block). (if(key == Vx))
-			 * EXA1 : Skips the next instruction if the key stored in VX(only consider 
-			 *        the lowest nibble) is not pressed (usually the next instruction is a 
-			 *        jump to skip a code block). (if(key != Vx))        */
-
-
-			if(debug_flag)
-				printf("Welcome to case E\n");
-			switch(third_nibble){
-				case 0x9:
-					if(debug_flag){
-						printf("Welcome to case EX9E\n");
-						printf("PC's value after is 0x%X\n",(int)registers->PC);
-					}
-
-					if(g->keypad[registers->V[X]])
-						registers->PC += 2;
-
-					g->keypad[registers->V[X]] = false;
-
-					if(debug_flag)
-						printf("PC's value after is 0x%X\n",(int)registers->PC);
-
-					break;
-					
-				case 0xA:
-					if(debug_flag){
-						printf("Welcome to case EXA1\n");
-						printf("PC's value after is 0x%X\n",(int)registers->PC);
-					}
-
-					if(!(g->keypad[registers->V[X]]))
-						registers->PC += 2;
-
-					if(debug_flag)
-						printf("PC's value after is 0x%X\n",(int)registers->PC);
-
-					break;
-			}
+/* Loads the ROM at 0x200 and configures the machine (quirk profile,speed and keymap) for it if it's
+ * in the ROM database. `name` is a file or "archive.zip:ENTRY".*/
+bool load_ROM(struct Chip8 *c8,const char *name){
+	size_t len;
 
-			break;
-		case 0xF:
-			/* Valid instructions:
-			 * FX0A: Waits for a key press and then stored in Vx
-			 * FX15: Sets the delay timer to VX.
-			 * FX18: Sets the sound timer to VX.
-			 * FX1E: Adds Vx to I.( I += Vx) 
-			 * FX29: Sets I to the font address for the character stored in Vx
-			 * FX33: Stores BCD of Vx into I. 100's at I,10's at I+1,1's at I +2.
-			 * FX55: Stores vals from V0 to Vx in memory starting at address I. Offset of 
-			 *       I is increased by 1 after a val is written into it but I itself isn't
-			 *       changed.
-			 * FX65: Fills vals from V0 to Vx from memory starting at address I. Offset of 
-			 *       I is increased by 1 after a val is written into it but I itself isn't
-			 *       changed.
-			 */
+	if(!rom_read(name,&c8->memory[0x200],sizeof(c8->memory) - 0x200,&len))
+		return false;
+	if(len > 0)
+		chip8_wrote(c8,0x200,len);
+	
+	if(debug_flag)
+		display_ROM(&c8->memory[0x200],len);
 
-			if(debug_flag){
-				printf("Welcome to case F\n");
-				printf("Register I's value before is 0x%X\n",(int)registers->I);
-				printf("mem at the location is:%X\n",memory[registers->I]);
-			}
+	const struct RomInfo *info = romdb_lookup(&c8->memory[0x200],len);
+	if(info){
+		quirks = &quirk_profiles[info->quirks];
+		keymap = info->keymap;
+		instructions_per_frame = info->speed;
+	}
 
-			switch(third_nibble){
-				case 0x0:
-					switch(fourth_nibble){
-						case 0x7:
-							if(debug_flag){
-								printf("Welcome to case FX07\n");
-								printf("Register %d before has:0x%X\n",X,registers->V[X]);
-								printf("Delay timer val is:%d\n",delay_timer);
-							}
-
-							registers->V[X] = delay_timer; 
-							
-
-							if(debug_flag)
-								printf("Register %d after has:0x%X\n",X,registers->V[X]);
-						
-							break;
-							
-						case 0xA:
-							if(debug_flag){
-								printf("Welcome to case FX0A\n");
-								printf("Register %d before has:0x%X\n",X,registers->V[X]);
-							}
-
-							bool keyPressed = false;
-							for (int i = 0; i < 16; i++) 
-    								if(g->keypad[i]){
-        								registers->V[X] = i;
-        								keyPressed = true;
-        								break;
-								}
-
-					//repeat until a key is pressed
-							if(!keyPressed){
-								if(debug_flag)
-									printf("Repeating FX0A cyle\n");
-    								registers->PC -= 2;
-							}
-							
-							g->keypad[registers->V[X]] = false;
-
-							if(debug_flag)
-								printf("Register %d after has:0x%X\n",X,registers->V[X]);
-							break;
-				
-				}
+	return true;
+}
 
-				case 0x1:
-					switch(fourth_nibble){
-						case 0x5:
-							if(debug_flag)
-								printf("Welcome to case FX15\n");
-
-							delay_timer = registers->V[X];
-
-							break;
-						case 0x8:
-							if(debug_flag)
-								printf("Welcome to case FX18\n");
-
-							sound_timer = registers->V[X];
-
-							break;
-						case 0xE:
-							if(debug_flag)
-								printf("Welcome to case FX1E\n");
-
-							registers->I += registers->V[X];
-
-							break;
-					}
-					
-					break;
-				case 0x2:
-					if(debug_flag){
-						printf("Welcome to case FX29\n");
-						printf("Register I before: %d\n",(int)registers->I);
-					}
-					registers->I = 0x50 + registers->V[X] * 5;
-					
-					if(debug_flag)
-						printf("Register I after: %d\n",(int)registers->I);
-					break;
-
-				case 0x3:
-					if(debug_flag){
-						printf("Welcome to case FX33\n");
-						_memoryframe(registers->I,registers->I + 2);
-						printf("val at V%d is 0x%X\n",X,registers->V[X]);
-					}
-					
-					for(int i = 0;i < 3;i++)
-						memory[registers->I + i] = 0;
-
-					int num = registers->V[X];
-					int _i = 2;
-
-					while(num != 0){
-						if(debug_flag)
-							printf("Num now is:%d with digit: %d being stored at 0x%X\n",num,num%10,registers-> I + _i);
-						memory[registers->I + _i--] = num%10;
-        					num = num / 10;
-    					}
-
-					if(debug_flag)
-						_memoryframe(registers->I,registers->I + 2);
-					break;
-
-				case 0x5:
-					if(debug_flag){
-						printf("Welcome to case FX55\n");
-						_memoryframe(registers->I,registers->I + X);
-						for(int i = 0;i <= X;i++)
-							printf("val at V%d is %X\n",i,registers->V[i]);
-					}
-
-					for(int i = 0;i <= X;i++)
-						memory[(registers->I) + i] = registers->V[i];
-					
-					if(do_i_increment)
-						registers->I = registers->I + X + 1;
-					
-					if(debug_flag)
-						_memoryframe(registers->I,registers->I + X);
-					break;
-
-				case 0x6:
-					if(debug_flag){
-						printf("Welcome to case FX65\n");
-						_memoryframe(registers->I,registers->I + X);
-						for(int i = 0;i <= X;i++)
-							printf("val at V%d is %X\n",i,registers->V[i]);
-					}
-
-					for(int i = 0;i <= X;i++)
-						registers->V[i] = memory[(registers->I) + i]; 
-
-					if(do_i_increment)
-						registers->I = registers->I + X + 1;
-					
-					if(debug_flag)
-						_memoryframe(registers->I,registers->I + X);
-					break;
-			}
+static void usage(const char *name){
+	fprintf(stderr,"Usage: %s [-d] [-q quirks] [-s speed] [ROM|archive.zip:ROM|1000]\n",name);
+	fprintf(stderr,"       %s --diff[=A,B] [options] <ROM>\n",name);
+	fprintf(stderr,"       %s --fuzz[=A,B] [options]\n",name);
+	fprintf(stderr,"  -d            print debugging information\n");
+	fprintf(stderr,"  -q quirks     quirk profile: chip8,schip or xochip\n");
+	fprintf(stderr,"  -s speed      instructions per frame\n");
+	fprintf(stderr,"  --diff[=A,B]  run engines A and B (default interp,ref) in lockstep on the ROM\n");
+	fprintf(stderr,"  --fuzz[=A,B]  run engines A and B in lockstep on random ROMs\n");
+	fprintf(stderr,"  --interval N  compare the engines every N instructions (default 1000)\n");
+	fprintf(stderr,"  --frames N    frames to run each ROM for\n");
+	fprintf(stderr,"  --seed N      seed of CXNN's random numbers (and of the fuzzer)\n");
+	fprintf(stderr,"  --input N     seed of the scripted keypad input (0 for none)\n");
+	fprintf(stderr,"  --threads N   fuzzer threads (default: all cores)\n");
+	fprintf(stderr,"  --seconds N   how long to fuzz for (default 10)\n");
+	fprintf(stderr,"  --headless    run --frames frames (default 600) without a window\n");
+	fprintf(stderr,"  --record FILE record the display to FILE (.y4m,.raw,.gif or .txt for a hash log),\n");
+	fprintf(stderr,"                \"fmt:-\" is stdout and \"fmt:|cmd\" pipes into cmd. Can be repeated\n");
+	fprintf(stderr,"  --record-input FILE record the keys of every frame and a keyframe every --keyframes N\n"
+			"                frames (default %d) to FILE\n",REPLAY_KEYFRAME_EVERY);
+	fprintf(stderr,"  --verify FILE replay a recording from --record-input on --threads threads and check it\n"
+			"                still ends up in the recorded states\n");
+	fprintf(stderr,"  --debugger    start in the debugger (breakpoints,watchpoints,stepping)\n");
+	fprintf(stderr,"  --paged       With --envs: the machines share the ROM's memory pages (copy on write)\n");
+	fprintf(stderr,"  --watch[=keep|patch] Reload the ROM when the file changes: from scratch,keeping the display,\n"
+			"                or patching the changed bytes into the running machine\n");
+	fprintf(stderr,"  --bench[=NAME] microbenchmarks of the hot functions (the ones with NAME in their name),\n"
+			"                tab separated ns per call\n");
+	fprintf(stderr,"  --explore[=K] search the ROM's state space,branching on every input each K frames (default 10)\n");
+	fprintf(stderr,"  --depth N     inputs deep at most (default %d),--states N unique states at most\n",
+		EXPLORE_DEPTH_MAX);
+	fprintf(stderr,"  --stop ADDR==V don't explore past states where memory at ADDR (or Vx) is V (also\n"
+			"                !=,<,>,<=,>=). Can be repeated\n");
+	fprintf(stderr,"  --wall[=N]    All the ROMs in one window,or N machines of the first one with different seeds\n");
+	fprintf(stderr,"  --terminal[=braille] Draw in the terminal (half blocks or braille) instead of a window\n");
+	fprintf(stderr,"  --vip         COSMAC VIP timing: instructions cost their VIP cycles instead of -s\n");
+	fprintf(stderr,"  --turbo[=N]   start fast forwarding (Tab toggles it) at N times the speed,as fast\n");
+	fprintf(stderr,"                as possible without N\n");
+	fprintf(stderr,"  --run-ahead K show the machine K frames ahead to hide K frames of input lag\n");
+	fprintf(stderr,"  --netplay LOCALPORT:HOST:PORT  two player netplay with the peer at HOST:PORT\n");
+	fprintf(stderr,"  --net-delay MS,--net-loss PERCENT  delay/drop outgoing packets (for testing)\n");
+	fprintf(stderr,"  --phosphor    let pixels fade out over a few frames instead of flickering\n");
+	fprintf(stderr,"  --latency     measure input to photon latency (headless: scripted key presses)\n");
+	fprintf(stderr,"  --metrics[=FILE] show fps,effective Hz and frame times in the window title and\n");
+	fprintf(stderr,"                write them to FILE (\"-\" for stderr) at exit\n");
+	fprintf(stderr,"  --envs N      benchmark N environments of the RL API with random actions\n");
+	fprintf(stderr,"  --reward ADDR score address for --envs\n");
+	fprintf(stderr,"  --shm NAME    export the machine to shared memory NAME every frame\n");
+	fprintf(stderr,"  --monitor NAME print the state of the emulator exporting to NAME\n");
+	fprintf(stderr,"Without a ROM the launcher shows the ROMs in %s/ to pick one.\n",LAUNCHER_DIR);
+	fprintf(stderr,"The ROM database picks the quirks and speed for known ROMs,-q and -s override it.\n");
+}
 
-			if(debug_flag){
-				printf("Register I's value after is 0x%X\n",(int)registers->I);
-				printf("mem at the location is:%X\n",memory[registers->I]);
-			}
+// Parses "A,B" into two engines
+static bool parse_engines(const char *arg,struct DiffOptions *diff){
+	char a[32] = "interp",b[32] = "ref";
 
-			break;
+	if(arg && sscanf(arg,"%31[^,],%31s",a,b) != 2){
+		fprintf(stderr,"Expected two engines as A,B\n");
+		return false;
+	}
 
-		default:
-			printf("First nibble after: %016b\n",first_nibble);
-			break;
+	if((diff->a = engine_find(a)) == NULL || (diff->b = engine_find(b)) == NULL){
+		fprintf(stderr,"Unknown engine in %s,known engines are:",arg);
+		for(const struct Engine *e = engines;e->name != NULL;e++)
+			fprintf(stderr," %s",e->name);
+		fprintf(stderr,"\n");
+		return false;
 	}
 
-	logmsg("execute",false,debug_flag);
+	return true;
 }
 
-void game_run(struct Game *g , _registers *registers,float speed){
-	Uint32 last = SDL_GetTicks();
-	while(g->is_running){
-		game_events(g,&key);
-		if(debug_flag)
-			printf("=> In game run ,  %X is pressed\n",key);
-		
-	//	clear_screen(g);
-		execute(fetch(registers),registers);
-
-		Uint32 now = SDL_GetTicks();
-		if((now - last) >= 1000/60){
-			if(delay_timer > 0)
-				delay_timer--;
+enum{
+	OPT_DIFF = 256,
+	OPT_FUZZ,
+	OPT_INTERVAL,
+	OPT_FRAMES,
+	OPT_SEED,
+	OPT_INPUT,
+	OPT_THREADS,
+	OPT_SECONDS,
+	OPT_HEADLESS,
+	OPT_RECORD,
+	OPT_RECORD_INPUT,
+	OPT_KEYFRAMES,
+	OPT_VERIFY,
+	OPT_DEBUGGER,
+	OPT_PAGED,
+	OPT_WATCH,
+	OPT_BENCH,
+	OPT_EXPLORE,
+	OPT_DEPTH,
+	OPT_STATES,
+	OPT_STOP,
+	OPT_WALL,
+	OPT_TERMINAL,
+	OPT_VIP,
+	OPT_TURBO,
+	OPT_RUN_AHEAD,
+	OPT_NETPLAY,
+	OPT_NET_DELAY,
+	OPT_NET_LOSS,
+	OPT_PHOSPHOR,
+	OPT_LATENCY,
+	OPT_METRICS,
+	OPT_ENVS,
+	OPT_REWARD,
+	OPT_SHM,
+	OPT_MONITOR
+};
+
+static const struct option long_options[] = {
+	{"diff",optional_argument,NULL,OPT_DIFF},
+	{"fuzz",optional_argument,NULL,OPT_FUZZ},
+	{"interval",required_argument,NULL,OPT_INTERVAL},
+	{"frames",required_argument,NULL,OPT_FRAMES},
+	{"seed",required_argument,NULL,OPT_SEED},
+	{"input",required_argument,NULL,OPT_INPUT},
+	{"threads",required_argument,NULL,OPT_THREADS},
+	{"seconds",required_argument,NULL,OPT_SECONDS},
+	{"headless",no_argument,NULL,OPT_HEADLESS},
+	{"record",required_argument,NULL,OPT_RECORD},
+	{"record-input",required_argument,NULL,OPT_RECORD_INPUT},
+	{"keyframes",required_argument,NULL,OPT_KEYFRAMES},
+	{"verify",required_argument,NULL,OPT_VERIFY},
+	{"debugger",no_argument,NULL,OPT_DEBUGGER},
+	{"paged",no_argument,NULL,OPT_PAGED},
+	{"watch",optional_argument,NULL,OPT_WATCH},
+	{"bench",optional_argument,NULL,OPT_BENCH},
+	{"explore",optional_argument,NULL,OPT_EXPLORE},
+	{"depth",required_argument,NULL,OPT_DEPTH},
+	{"states",required_argument,NULL,OPT_STATES},
+	{"stop",required_argument,NULL,OPT_STOP},
+	{"wall",optional_argument,NULL,OPT_WALL},
+	{"terminal",optional_argument,NULL,OPT_TERMINAL},
+	{"vip",no_argument,NULL,OPT_VIP},
+	{"turbo",optional_argument,NULL,OPT_TURBO},
+	{"run-ahead",required_argument,NULL,OPT_RUN_AHEAD},
+	{"netplay",required_argument,NULL,OPT_NETPLAY},
+	{"net-delay",required_argument,NULL,OPT_NET_DELAY},
+	{"net-loss",required_argument,NULL,OPT_NET_LOSS},
+	{"phosphor",no_argument,NULL,OPT_PHOSPHOR},
+	{"latency",no_argument,NULL,OPT_LATENCY},
+	{"metrics",optional_argument,NULL,OPT_METRICS},
+	{"envs",required_argument,NULL,OPT_ENVS},
+	{"reward",required_argument,NULL,OPT_REWARD},
+	{"shm",required_argument,NULL,OPT_SHM},
+	{"monitor",required_argument,NULL,OPT_MONITOR},
+	{NULL,0,NULL,0}
+};
 
-			if(sound_timer > 0)
-				sound_timer--;
-			last = now;
+int main(int argc,char** agrv){
+	const struct Quirks *quirks_override = NULL;
+	unsigned speed_override = 0;
+	bool do_diff = false,do_fuzz = false,headless = false,phosphor = false,turbo = false;
+	const char *metrics_path = NULL;
+	unsigned envs = 0;
+	bool paged = false;
+	int terminal = -1; // --terminal's mode,-1 for the SDL window
+	int watch = -1; // --watch's reload mode
+	int wall = -1; // --wall: 0 for a machine per ROM,N for N machines of the first ROM
+	bool do_explore = false,do_bench = false;
+	const char *bench_filter = NULL;
+	const char *record_input = NULL,*verify = NULL;
+	unsigned keyframes = REPLAY_KEYFRAME_EVERY;
+	struct ExploreOptions explore_opt = {.frames = 10,.depth = EXPLORE_DEPTH_MAX,.max_states = 1000000};
+	const char *netplay = NULL;
+	unsigned net_delay = 0,net_loss = 0;
+	bool seed_given = false;
+	bool per_frame_output = false; // --record or --shm
+	uint16_t reward_addr = 0;
+	struct DiffOptions diff = {
+		.interval = 1000,
+		.seed = time(NULL),
+		.threads = sysconf(_SC_NPROCESSORS_ONLN),
+		.seconds = 10
+	};
+	int opt;
+
+	while((opt = getopt_long(argc,agrv,"dq:s:",long_options,NULL)) != -1){
+		switch(opt){
+			case 'd':
+				debug_flag = true;
+				break;
+			case 'q':
+				if((quirks_override = quirks_find(optarg)) == NULL){
+					fprintf(stderr,"Unknown quirk profile %s\n",optarg);
+					return -1;
+				}
+				break;
+			case 's':
+				speed_override = atoi(optarg);
+				break;
+			case OPT_DIFF:
+			case OPT_FUZZ:
+				if(!parse_engines(optarg,&diff))
+					return -1;
+				do_diff = opt == OPT_DIFF;
+				do_fuzz = opt == OPT_FUZZ;
+				break;
+			case OPT_INTERVAL:
+				diff.interval = atoi(optarg);
+				break;
+			case OPT_FRAMES:
+				diff.frames = atoi(optarg);
+				break;
+			case OPT_SEED:
+				diff.seed = strtoul(optarg,NULL,0);
+				seed_given = true;
+				break;
+			case OPT_INPUT:
+				diff.input_seed = strtoul(optarg,NULL,0);
+				break;
+			case OPT_THREADS:
+				diff.threads = atoi(optarg);
+				break;
+			case OPT_SECONDS:
+				diff.seconds = atoi(optarg);
+				break;
+			case OPT_HEADLESS:
+				headless = true;
+				break;
+			case OPT_RECORD:
+				if(!record_open(optarg))
+					return -1;
+				per_frame_output = true;
+				break;
+			case OPT_RECORD_INPUT:
+				record_input = optarg;
+				break;
+			case OPT_KEYFRAMES:
+				keyframes = atoi(optarg);
+				break;
+			case OPT_VERIFY:
+				verify = optarg;
+				break;
+			case OPT_DEBUGGER:
+				debugger_init();
+				break;
+			case OPT_PAGED:
+				paged = true;
+				break;
+			case OPT_WATCH:
+				if(optarg == NULL)
+					watch = RELOAD_RESET;
+				else if(strcmp(optarg,"keep") == 0)
+					watch = RELOAD_KEEP_DISPLAY;
+				else if(strcmp(optarg,"patch") == 0)
+					watch = RELOAD_PATCH;
+				else{
+					fprintf(stderr,"--watch,--watch=keep or --watch=patch\n");
+					return -1;
+				}
+				break;
+			case OPT_BENCH:
+				do_bench = true;
+				bench_filter = optarg;
+				break;
+			case OPT_EXPLORE:
+				do_explore = true;
+				if(optarg)
+					explore_opt.frames = atoi(optarg);
+				break;
+			case OPT_DEPTH:
+				explore_opt.depth = atoi(optarg);
+				break;
+			case OPT_STATES:
+				explore_opt.max_states = atoi(optarg);
+				break;
+			case OPT_STOP:
+				if(explore_opt.stops == EXPLORE_PREDICATES_MAX ||
+				   !explore_parse_predicate(optarg,&explore_opt.stop[explore_opt.stops++])){
+					fprintf(stderr,"Expected ADDR==V (or Vx,and !=,<,>,<=,>=),at most %d of them\n",
+						EXPLORE_PREDICATES_MAX);
+					return -1;
+				}
+				break;
+			case OPT_WALL:
+				wall = optarg ? atoi(optarg) : 0;
+				break;
+			case OPT_TERMINAL:
+				terminal = optarg && strcmp(optarg,"braille") == 0 ? TERMINAL_BRAILLE :
+									    TERMINAL_HALF_BLOCKS;
+				break;
+			case OPT_VIP:
+				vip_timing = true;
+				break;
+			case OPT_TURBO:
+				turbo = true;
+				turbo_speed = optarg ? atoi(optarg) : 0;
+				break;
+			case OPT_RUN_AHEAD:
+				run_ahead = atoi(optarg);
+				break;
+			case OPT_NETPLAY:
+				netplay = optarg;
+				break;
+			case OPT_NET_DELAY:
+				net_delay = atoi(optarg);
+				break;
+			case OPT_NET_LOSS:
+				net_loss = atoi(optarg);
+				break;
+			case OPT_PHOSPHOR:
+				phosphor = true;
+				break;
+			case OPT_LATENCY:
+				latency_enabled = true;
+				break;
+			case OPT_METRICS:
+				metrics.enabled = true;
+				metrics_path = optarg;
+				break;
+			case OPT_ENVS:
+				envs = atoi(optarg);
+				break;
+			case OPT_REWARD:
+				reward_addr = strtoul(optarg,NULL,16);
+				break;
+			case OPT_SHM:
+				if(!shm_export_open(optarg))
+					return -1;
+				per_frame_output = true;
+				break;
+			case OPT_MONITOR:
+				return shm_monitor(optarg);
+			default:
+				usage(agrv[0]);
+				return -1;
 		}
-
-		SDL_Delay(1/60); // i.e. 60Hz
-		render_screen(g);
 	}
-}
 
-void display_ROM(FILE* rom){
-	int data;
-	int j = 0;
-	printf("The Instructions of the .ch8 file are:\n");
-	
-	while((data = fgetc(rom)) != EOF){
-		printf("%02X",(unsigned char)data);
-		if(++j == 2){
-			printf("\n");
-			j= 0;
-		}
+	if(do_bench)
+		return bench_run(stdout,quirks_override ? quirks_override : quirks,bench_filter);
+
+	if(verify)
+		return replay_verify(verify,diff.threads);
+
+	if(do_fuzz){
+		// No ROM and no profile means every profile gets fuzzed
+		diff.quirks = quirks_override;
+		diff.speed = speed_override ? speed_override : 100;
+		diff.frames = diff.frames ? diff.frames : 500;
+		diff.threads = diff.threads > 0 ? diff.threads : 1;
+		return difftest_fuzz(&diff);
 	}
 
-	fseek(rom,0,SEEK_SET);
-	printf("Seeked to %ld\n",ftell(rom));
-}
+	const char *rom = optind < argc ? agrv[optind] : NULL;
+	if(rom == NULL && (do_diff || do_explore || headless || terminal >= 0 || wall >= 0 || envs || netplay)){
+		usage(agrv[0]);
+		return -1;
+	}
 
-bool load_ROM(const char *name){
-	FILE* rom;
-	int data;
-	unsigned int i = 0x200;
+	// Rollbacks run frames again,what's written out or probed every frame would see them twice
+	if(netplay && (per_frame_output || watch >= 0 || debugger_armed || latency_enabled)){
+		fprintf(stderr,"--netplay can't be used with --record,--shm,--watch,--debugger or --latency\n");
+		return -1;
+	}
 
-	rom = fopen(name,"rb");
+	// No ROM given,pick one in the launcher (in the window the game then runs in)
 	if(rom == NULL){
-		if(debug_flag)
-			fprintf(stderr,"Couldn't read %s\n",name);
-		return false;
+		if(!game_new(&g)){
+			game_free(&g);
+			return -1;
+		}
+		if((rom = launcher_run(g,LAUNCHER_DIR)) == NULL){
+			game_free(&g);
+			return EXIT_SUCCESS;
+		}
 	}
-	
-	if(debug_flag)
-		display_ROM(rom);
-
-	while((data = fgetc(rom)) != EOF)
-		memory[i++] = (unsigned char) data;
 
-	fclose(rom);
-	return true;
-}
+	if(wall >= 0){
+		// ROMs that don't load are left out,so ROMs/* works
+		for(int i = optind;i < argc;i++){
+			for(int k = 0;k < (wall ? wall : 1);k++)
+				if(!wall_add(agrv[i],diff.seed + k,quirks_override,speed_override))
+					fprintf(stderr,"Leaving %s out\n",agrv[i]);
+			if(wall)
+				break;
+		}
+		int status = EXIT_FAILURE;
+		if(game_new(&g)){
+			wall_run(g,diff.input_seed);
+			status = EXIT_SUCCESS;
+		}
+		wall_free();
+		game_free(&g);
+		if(metrics_path)
+			metrics_dump(metrics_path);
+		return status;
+	}
 
-int main(int argc,char** agrv){
-	debug_flag = true;
-	srand(time(NULL));
-	_registers registers;
-	registers.PC = 0x200; // starting from the unreserved section
-	_fontset();
-	_memoryframe(0x050,0x200);	
+	struct Chip8 machine;
+	chip8_init(&machine,diff.seed);
+	_memoryframe(machine.memory,0x050,0x200);	
 	//printf("%d\n",EXIT_FAILURE);
 	bool exit_status = EXIT_FAILURE;
 
 	//printf("game: %p\n",g);
 	
 	if(debug_flag)
-		printf("agrv : %s\n",agrv[1]);
+		printf("agrv : %s\n",rom);
 
-	if(strcmp(agrv[1],"1000") == 0){
+	if(strcmp(rom,"1000") == 0){
 		printf("Filling opcode\n");
-		_fillopcode();
+		_fillopcode(machine.memory);
+		chip8_wrote(&machine,0x200,8);
 //		return 0;
 	}
 	else
-		if(!(load_ROM("ROMs/TETRIS")))
+		if(!(load_ROM(&machine,rom))){
+			game_free(&g); // the launcher's window,if there is one
+			return -1;
+		}
+
+	if(watch >= 0 && !reload_watch(rom,watch)){
+		game_free(&g);
+		return -1;
+	}
+
+	// Whatever is given on the command line wins over the ROM database
+	if(quirks_override)
+		quirks = quirks_override;
+	if(speed_override)
+		instructions_per_frame = speed_override;
+
+	if(debug_flag)
+		printf("Using the %s quirk profile at %u instructions per frame\n",quirks->name,
+		       instructions_per_frame);
+
+	if(do_diff){
+		diff.quirks = quirks;
+		diff.speed = instructions_per_frame;
+		diff.frames = diff.frames ? diff.frames : 3600; // a minute
+		return difftest_rom(&diff,&machine);
+	}
+
+	if(do_explore){
+		explore_opt.quirks = quirks;
+		explore_opt.speed = instructions_per_frame;
+		explore_opt.threads = diff.threads;
+		explore_opt.seconds = diff.seconds;
+		return explore(&explore_opt,&machine);
+	}
+
+	_memoryframe(machine.memory,0x200,0x300);
+
+	if(netplay){
+		if(!netplay_open(netplay,net_delay,net_loss))
+			return -1;
+		machine.rng = seed_given ? diff.seed : 1; // both peers have to start from the same machine
+		if(headless)
+			return netplay_run_headless(&machine,instructions_per_frame,diff.frames ? diff.frames : 600,
+						    diff.input_seed);
+	}
+
+	if(envs)
+		return vecenv_bench(&machine,envs,diff.frames ? diff.frames : 600,reward_addr,paged);
+
+	if(record_input){
+		if(netplay){
+			fprintf(stderr,"--record-input doesn't record netplay (rollbacks replay frames)\n");
+			return -1;
+		}
+		if(!replay_record_open(record_input,keyframes,quirks,instructions_per_frame,vip_timing))
+			return -1;
+	}
+
+	if(terminal >= 0){
+		if(debugger_armed){
+			fprintf(stderr,"--terminal and --debugger both want stdin\n");
+			return -1;
+		}
+		if(!terminal_open(terminal))
 			return -1;
+		terminal_turbo = turbo;
+		terminal_run(&machine,instructions_per_frame);
+		terminal_close();
+		replay_record_close(&machine);
+		record_close_all();
+		shm_export_close();
+		if(metrics_path)
+			metrics_dump(metrics_path);
+		terminal_report(stderr);
+		return EXIT_SUCCESS;
+	}
 
-	_memoryframe(0x200,0x300);
+	if(headless){
+		headless_run(&machine,instructions_per_frame,diff.frames ? diff.frames : 600,diff.input_seed);
+		replay_record_close(&machine);
+		record_close_all();
+		shm_export_close();
+		if(metrics_path)
+			metrics_dump(metrics_path);
+		if(latency_enabled)
+			latency_report(stdout);
+		return EXIT_SUCCESS;
+	}
 
-	if(game_new(&g)){
+	if(g != NULL || game_new(&g)){
 		if(debug_flag)
 			printf("game: %p\n",g);
-		game_run(g,&registers,atoi(agrv[1]));
+		g->phosphor = phosphor;
+		g->turbo = turbo;
+		game_run(g,&machine,instructions_per_frame);
 		exit_status = EXIT_SUCCESS;
 	}
 
 	game_free(&g);
+	replay_record_close(&machine);
+	record_close_all();
+	shm_export_close();
+	if(metrics_path)
+		metrics_dump(metrics_path);
+	if(latency_enabled)
+		latency_report(stdout);
+	if(netplay_active)
+		netplay_report(stdout);
 	//printf("game: %p\n",g);
 	//printf("%d\n",EXIT_SUCCESS);
 
@@ -1,7 +1,106 @@
 #ifndef CHIP_8_H
 #define CHIP_8_H
 
-bool debug_flag;
-uint8_t memory[0x1000]; 
+#include<stddef.h>
+#include<stdint.h>
+#include<stdbool.h>
+
+#define DISPLAY_WIDTH 64
+#define DISPLAY_HEIGHT 32
+
+extern bool debug_flag;
+
+typedef struct _registers{ 
+	uint8_t V[0xF + 1]; // A total of 16 registers (15 +1)
+	unsigned _BitInt(12) I; // Address register 
+	unsigned _BitInt(12) PC; // Program counter register 
+}_registers;
+
+/* Everything that makes up one machine. Nothing in the interpreter touches global state so any
+ * number of these can be run side by side (e.g. by the differential tester) and copying one is a 
+ * full snapshot of the machine.*/
+struct Chip8{
+	_registers registers;
+	/* 4096 bytes worth of memory . first 512(0x200) bytes are reserved i.e. the opcodes need to
+	 * be loaded from 0x200.*/
+	uint8_t memory[0x1000]; 
+	unsigned short stack[16]; // 16 2-bytes worth of stack
+	int sp; // stack pointer
+	// Both the timers need to be decremented by 1 , 60 times per sec (i.e. 60 Hz)
+	uint8_t delay_timer;
+	uint8_t sound_timer; // It makes the computer "beep" as long as it's above 0
+	bool display[DISPLAY_HEIGHT][DISPLAY_WIDTH];
+	bool keypad[16];
+	uint32_t rng; // CXNN's random number generator, seeded per machine so runs are repeatable
+	int32_t cycles; // VIP timing model only: machine cycles left in this frame (< 0 overran)
+	/* Per 256 byte page of memory: a number that changes,to one no page has had before,whenever
+	 * the page is written (everything that writes memory calls chip8_wrote()). The block engine 
+	 * keeps what it decoded from a page for as long as the number stays the same.*/
+	uint64_t generation[16];
+};
+
+/* A quirk profile. The flags describe the profile (for printing/picking one and for the reference
+ * engine), the behaviour itself is baked into `run` and `execute` which are generated from 
+ * interpreter.h per profile. */
+struct Quirks{
+	const char *name;
+	const char *description;
+	bool vf_reset;
+	bool memory;
+	bool shift;
+	bool wrap;
+	bool display_wait;
+	bool jump;
+	unsigned (*run)(struct Chip8 *c8,unsigned budget);
+	bool (*execute)(const unsigned short opcode,struct Chip8 *c8);
+};
+
+enum{
+	QUIRKS_CHIP8,
+	QUIRKS_SCHIP,
+	QUIRKS_XOCHIP
+};
+
+extern const struct Quirks quirk_profiles[];
+extern const struct Quirks *quirks;
+
+/* An engine is a way of executing instructions. `run` runs up to `budget` instructions (stopping
+ * early if the frame ends) and returns how many it ran, `step` runs exactly one and returns true if
+ * it ended the frame. All the engines must agree with each other, see difftest.c.*/
+struct Engine{
+	const char *name;
+	const char *description;
+	unsigned (*run)(struct Chip8 *c8,const struct Quirks *q,unsigned budget);
+	bool (*step)(struct Chip8 *c8,const struct Quirks *q);
+};
+
+extern const struct Engine engines[];
+
+const struct Quirks *quirks_find(const char *name);
+const struct Engine *engine_find(const char *name);
+void chip8_init(struct Chip8 *c8,uint32_t seed);
+bool load_ROM(struct Chip8 *c8,const char *name);
+const unsigned short fetch(struct Chip8 *c8);
+void chip8_tick_timers(struct Chip8 *c8);
+void chip8_wrote(struct Chip8 *c8,unsigned addr,unsigned len);
+unsigned engine_frame(struct Chip8 *c8,unsigned budget);
+void engine_frame_start(struct Chip8 *c8);
+bool engine_frame_left(const struct Chip8 *c8,unsigned n,unsigned budget);
+bool engine_frame_step(struct Chip8 *c8);
+unsigned engine_frame_finish(struct Chip8 *c8,unsigned n,unsigned budget);
+void engine_frame_end(struct Chip8 *c8);
+uint64_t chip8_display_hash(const struct Chip8 *c8);
+uint32_t chip8_mix(uint32_t h);
+void chip8_scripted_input(uint32_t seed,unsigned frame,bool keypad[16]);
+
+// xorshift32, the state is never 0 (chip8_init() makes sure of that)
+static inline uint8_t chip8_rand(struct Chip8 *c8){
+	uint32_t x = c8->rng;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	c8->rng = x;
+	return x >> 24;
+}
 
 #endif
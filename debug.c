@@ -1,12 +1,12 @@
 #include<stdbool.h>
+#include<stdint.h>
 #include<stdio.h>
 
 extern bool debug_flag;
-extern unsigned char memory[0x1000];
 
 void logmsg(const char* function_name,bool start,bool debug_flag);
-void _memoryframe(unsigned _BitInt(12) start,unsigned _BitInt(12) end);
-void _fillopcode();
+void _memoryframe(const uint8_t *memory,unsigned _BitInt(12) start,unsigned _BitInt(12) end);
+void _fillopcode(uint8_t *memory);
 
 void logmsg(const char* function_name,bool start,bool debug_flag){
 	if(!debug_flag)
@@ -19,7 +19,7 @@ void logmsg(const char* function_name,bool start,bool debug_flag){
 }
 
 // View the memory locations from a starting address to an ending address
-void _memoryframe(unsigned _BitInt(12) start,unsigned _BitInt(12) end){
+void _memoryframe(const uint8_t *memory,unsigned _BitInt(12) start,unsigned _BitInt(12) end){
 	logmsg("_memoryframe",true,debug_flag);
 
 	if(debug_flag)
@@ -29,7 +29,7 @@ void _memoryframe(unsigned _BitInt(12) start,unsigned _BitInt(12) end){
 	logmsg("_memoryframe",false,debug_flag);
 }
 
-void _fillopcode(){
+void _fillopcode(uint8_t *memory){
 	// Filling it with a const opcode , 00EE => basically it's C's `return`
 	// So all the opcodes are 2 bytes long and it's stored in big-endian format 
 	memory[0x200] = 0x60;
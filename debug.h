@@ -1,8 +1,10 @@
 #ifndef DEBUG_H
 #define DEBUG_H
 
+#include<stdint.h>
+
 void logmsg(const char* function_name,bool start,bool debug_flag);
-void _memoryframe(unsigned _BitInt(12) start,unsigned _BitInt(12) end);
-void _fillopcode();
+void _memoryframe(const uint8_t *memory,unsigned _BitInt(12) start,unsigned _BitInt(12) end);
+void _fillopcode(uint8_t *memory);
 
 #endif
@@ -0,0 +1,514 @@
+#include<signal.h>
+#include<stdbool.h>
+#include<stdint.h>
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+
+#include"chip_8.h"
+#include"cheat.h"
+#include"debugger.h"
+
+/* Interactive debugger (on stdin/stdout): PC breakpoints with optional conditions on a register,
+ * watchpoints on memory writes and on I, single step, stepping over 2NNN calls, a register / 
+ * stack / memory view and a memory search (see cheat.c) to find and freeze a score or lives counter.
+ *
+ * The generated interpreters know nothing about it. While nothing is armed the frame loop calls
+ * the profile's `run` as usual,the only cost is one flag checked per frame. Once a breakpoint,
+ * watchpoint or step is armed (or Ctrl-C is pressed) frames go through debugger_run() instead, 
+ * which executes one instruction at a time (with the --vip cycle budget if it's on) and checks it
+ * against bitmaps of the armed addresses.*/
+
+#define BREAKPOINTS_MAX 64
+#define WATCHPOINTS_MAX 16
+
+enum{
+	COND_NONE,
+	COND_EQ,
+	COND_NE,
+	COND_LT,
+	COND_GT,
+	COND_LE,
+	COND_GE
+};
+
+#define REG_I 16
+
+struct Breakpoint{
+	uint16_t addr;
+	int reg; // V0-VF or REG_I,for conditional breakpoints
+	int cond;
+	unsigned value;
+};
+
+struct Watchpoint{
+	uint16_t start;
+	uint16_t end;
+};
+
+volatile sig_atomic_t debugger_armed;
+bool debugger_quit;
+
+void debugger_init(void);
+bool debugger_command(struct Chip8 *c8,const char *line);
+unsigned debugger_run(struct Chip8 *c8,unsigned budget);
+
+static struct Breakpoint breakpoints[BREAKPOINTS_MAX];
+static int breakpoint_count;
+static struct Watchpoint watchpoints[WATCHPOINTS_MAX];
+static int watchpoint_count;
+static bool watch_I;
+
+// "n" over a 2NNN: the instruction after it,once back at the same stack depth. Not a numbered one.
+static struct{
+	bool armed;
+	uint16_t addr;
+	int sp;
+}over;
+
+// One bit per address
+static uint64_t pc_bitmap[0x1000 / 64];
+static uint64_t watch_bitmap[0x1000 / 64];
+
+static struct CheatSearch *search; // the "f" memory search
+
+static volatile sig_atomic_t interrupted;
+static unsigned steps; // instructions left to single step,0 for none
+
+static const char *cond_names[] = {"","==","!=","<",">","<=",">="};
+
+static inline bool bit_test(const uint64_t *bitmap,unsigned addr){
+	return bitmap[(addr & 0xFFF) >> 6] >> (addr & 63) & 1;
+}
+
+static void rearm(void){
+	memset(pc_bitmap,0,sizeof(pc_bitmap));
+	for(int i = 0;i < breakpoint_count;i++)
+		pc_bitmap[breakpoints[i].addr >> 6] |= 1ULL << (breakpoints[i].addr & 63);
+	if(over.armed)
+		pc_bitmap[over.addr >> 6] |= 1ULL << (over.addr & 63);
+
+	memset(watch_bitmap,0,sizeof(watch_bitmap));
+	for(int i = 0;i < watchpoint_count;i++)
+		for(unsigned a = watchpoints[i].start;a <= watchpoints[i].end;a++)
+			watch_bitmap[a >> 6] |= 1ULL << (a & 63);
+
+	debugger_armed = breakpoint_count || watchpoint_count || watch_I || over.armed || steps || 
+			 interrupted;
+}
+
+static void on_interrupt(int sig){
+	(void) sig;
+	interrupted = 1;
+	debugger_armed = 1;
+}
+
+// Stops before the first instruction,later Ctrl-C stops in the debugger instead of quitting
+void debugger_init(void){
+	signal(SIGINT,on_interrupt);
+	interrupted = 1;
+	debugger_armed = 1;
+	printf("Debugger: Ctrl-C to break in,\"help\" for the commands\n");
+}
+
+static void print_registers(const struct Chip8 *c8){
+	unsigned pc = c8->registers.PC;
+
+	printf("PC %03X [%02X%02X]  I %03X  DT %3u  ST %3u  sp %d\n",pc,c8->memory[pc],
+	       c8->memory[(pc + 1) & 0xFFF],(unsigned) c8->registers.I,c8->delay_timer,c8->sound_timer,
+	       c8->sp);
+	for(int i = 0;i < 16;i++)
+		printf("V%X %02X%s",i,c8->registers.V[i],i % 8 == 7 ? "\n" : "  ");
+
+	printf("stack:");
+	for(int i = c8->sp - 1;i >= 0;i--)
+		printf(" %03X",c8->stack[i]);
+	printf("\n");
+}
+
+static void print_memory(const struct Chip8 *c8,unsigned start,unsigned len){
+	for(unsigned i = 0;i < len;i++){
+		if(i % 16 == 0)
+			printf("%s%03X:",i ? "\n" : "",(start + i) & 0xFFF);
+		printf(" %02X",c8->memory[(start + i) & 0xFFF]);
+	}
+	printf("\n");
+}
+
+static void print_points(void){
+	for(int i = 0;i < breakpoint_count;i++){
+		const struct Breakpoint *b = &breakpoints[i];
+		printf("#%d break %03X",i,b->addr);
+		if(b->cond == COND_NONE)
+			printf("\n");
+		else if(b->reg == REG_I)
+			printf(" if I%s%u\n",cond_names[b->cond],b->value);
+		else
+			printf(" if V%X%s%u\n",b->reg,cond_names[b->cond],b->value);
+	}
+	for(int i = 0;i < watchpoint_count;i++)
+		printf("watch %03X-%03X\n",watchpoints[i].start,watchpoints[i].end);
+	if(watch_I)
+		printf("watch I\n");
+}
+
+static bool add_breakpoint(struct Breakpoint b){
+	if(breakpoint_count == BREAKPOINTS_MAX){
+		printf("Too many breakpoints\n");
+		return false;
+	}
+	breakpoints[breakpoint_count++] = b;
+	rearm();
+	return true;
+}
+
+static void delete_breakpoint(int i){
+	breakpoints[i] = breakpoints[--breakpoint_count];
+	rearm();
+}
+
+// "V3==5" / "I>=0x300"
+static bool parse_condition(const char *s,struct Breakpoint *b){
+	char op[3] = "";
+	char *end;
+
+	while(*s == ' ')
+		s++;
+
+	if(*s == 'I'){
+		b->reg = REG_I;
+		s++;
+	}else if(*s == 'V' || *s == 'v'){
+		char digit[2] = {s[1],0};
+		b->reg = strtol(digit,&end,16);
+		if(*end != 0)
+			return false;
+		s += 2;
+	}else{
+		return false;
+	}
+
+	while(*s == ' ')
+		s++;
+	for(int i = 0;i < 2 && strchr("=!<>",*s);i++)
+		op[i] = *s++;
+
+	b->cond = COND_NONE;
+	for(int i = 1;i < (int) (sizeof(cond_names) / sizeof(*cond_names));i++)
+		if(strcmp(op,cond_names[i]) == 0)
+			b->cond = i;
+
+	b->value = strtoul(s,&end,0);
+	return b->cond != COND_NONE && end != s;
+}
+
+static bool condition_holds(const struct Breakpoint *b,const struct Chip8 *c8){
+	unsigned v = b->reg == REG_I ? (unsigned) c8->registers.I : c8->registers.V[b->reg];
+
+	switch(b->cond){
+		case COND_EQ: return v == b->value;
+		case COND_NE: return v != b->value;
+		case COND_LT: return v < b->value;
+		case COND_GT: return v > b->value;
+		case COND_LE: return v <= b->value;
+		case COND_GE: return v >= b->value;
+	}
+	return true;
+}
+
+static void help(void){
+	printf("b ADDR [if V3==5]  break at ADDR (optionally only if Vx/I compares true: == != < > <= >=)\n"
+	       "w START [END]      break after an instruction writes to START-END\n"
+	       "w I                break after I changes\n"
+	       "d [N]              delete breakpoint N (all breakpoints and watchpoints without N)\n"
+	       "l                  list breakpoints and watchpoints\n"
+	       "s [N]              step N instructions (default 1)\n"
+	       "n                  step,over a 2NNN call\n"
+	       "c                  continue\n"
+	       "r                  registers and stack\n"
+	       "m ADDR [LEN]       memory\n"
+	       "f                  new memory search (memory and V0-VF)\n"
+	       "f OP [N]           keep what compares true: == != < > N,or since the last search:\n"
+	       "                   + (went up) - (went down) ~ (changed) = (unchanged)\n"
+	       "z ADDR|Vx [N]      freeze at N (default: its value now),z - unfreezes all\n"
+	       "q                  quit\n");
+}
+
+static void print_candidates(const struct Chip8 *c8){
+	printf("%u candidates\n",search->count);
+	if(search->count > 16)
+		return;
+	for(int a = cheat_next(search,0);a >= 0;a = cheat_next(search,a + 1)){
+		if(a >= CHEAT_V)
+			printf("V%X  = %02X\n",a - CHEAT_V,cheat_read(c8,a));
+		else
+			printf("%03X = %02X\n",a,cheat_read(c8,a));
+	}
+}
+
+// "f" and "f OP [N]"
+static void find(const struct Chip8 *c8,const char *args){
+	static const struct{const char *name;int op;bool value;} ops[] = {
+		{"==",CHEAT_EQ,true},{"!=",CHEAT_NE,true},{"<",CHEAT_LT,true},{">",CHEAT_GT,true},
+		{"+",CHEAT_INCREASED,false},{"-",CHEAT_DECREASED,false},{"~",CHEAT_CHANGED,false},
+		{"=",CHEAT_UNCHANGED,false}
+	};
+	char op[3] = "";
+	int n = 0;
+
+	if(search == NULL && (search = cheat_new(1)) == NULL)
+		return;
+	if(sscanf(args,"%2[=!<>+~-]%n",op,&n) < 1 || search->count == 0){
+		cheat_reset(search,c8);
+		printf("%u candidates\n",search->count);
+		return;
+	}
+
+	for(unsigned i = 0;i < sizeof(ops) / sizeof(*ops);i++){
+		if(strcmp(op,ops[i].name) != 0)
+			continue;
+		char *end;
+		unsigned value = strtoul(args + n,&end,0);
+		if(ops[i].value && end == args + n){
+			printf("f %s N\n",op);
+			return;
+		}
+		cheat_filter(search,c8,ops[i].op,value);
+		print_candidates(c8);
+		return;
+	}
+	printf("Unknown comparison %s\n",op);
+}
+
+// "z ADDR|Vx [N]","z -" and "z"
+static void freeze(const struct Chip8 *c8,const char *args){
+	unsigned addr;
+	char *end;
+
+	if(args[0] == '-'){
+		cheat_unfreeze_all();
+		return;
+	}
+	if(args[0] == 0 || args[0] == '\n'){
+		cheat_print_frozen();
+		return;
+	}
+	if(args[0] == 'V' || args[0] == 'v'){
+		addr = CHEAT_V + (strtoul(args + 1,&end,16) & 0xF);
+		if(end == args + 1){
+			printf("z ADDR|Vx [N]\n");
+			return;
+		}
+	}else{
+		addr = strtoul(args,&end,16) & 0xFFF;
+		if(end == args){
+			printf("z ADDR|Vx [N]\n");
+			return;
+		}
+	}
+
+	const char *rest = end;
+	unsigned value = strtoul(rest,&end,0);
+	if(end == rest)
+		value = cheat_read(c8,addr);
+	if(!cheat_freeze(addr,value))
+		printf("Too many frozen addresses\n");
+}
+
+/* Runs one debugger command,returns true if the emulation should resume.*/
+bool debugger_command(struct Chip8 *c8,const char *line){
+	char cmd[16] = "";
+	int n = 0;
+
+	if(sscanf(line," %15s %n",cmd,&n) < 1){
+		return false;
+	}
+	const char *args = line + n;
+	unsigned pc = c8->registers.PC;
+
+	if(strcmp(cmd,"c") == 0){
+		return true;
+	}else if(strcmp(cmd,"s") == 0){
+		steps = atoi(args) > 0 ? atoi(args) : 1;
+		rearm();
+		return true;
+	}else if(strcmp(cmd,"n") == 0){
+		unsigned opcode = c8->memory[pc] << 8 | c8->memory[(pc + 1) & 0xFFF];
+		if((opcode & 0xF000) == 0x2000){
+			// Run until the call returns,i.e. back at the next instruction at the same depth
+			over.armed = true;
+			over.addr = (pc + 2) & 0xFFF;
+			over.sp = c8->sp;
+			rearm();
+		}else{
+			steps = 1;
+			rearm();
+		}
+		return true;
+	}else if(strcmp(cmd,"b") == 0){
+		struct Breakpoint b = {0};
+		char *end;
+		b.addr = strtoul(args,&end,16) & 0xFFF;
+		if(end == args){
+			printf("b ADDR [if V3==5]\n");
+			return false;
+		}
+		while(*end == ' ')
+			end++;
+		if(strncmp(end,"if",2) == 0 && !parse_condition(end + 2,&b)){
+			printf("Bad condition %s",end + 2);
+			return false;
+		}
+		if(add_breakpoint(b))
+			printf("#%d break %03X\n",breakpoint_count - 1,b.addr);
+	}else if(strcmp(cmd,"w") == 0){
+		unsigned start,end;
+		int got = sscanf(args,"%x %x",&start,&end);
+		if(args[0] == 'I'){
+			watch_I = true;
+			rearm();
+		}else if(got < 1){
+			printf("w START [END] or w I\n");
+		}else if(watchpoint_count == WATCHPOINTS_MAX){
+			printf("Too many watchpoints\n");
+		}else{
+			end = got == 2 ? end : start;
+			watchpoints[watchpoint_count++] = (struct Watchpoint){start & 0xFFF,end & 0xFFF};
+			rearm();
+		}
+	}else if(strcmp(cmd,"d") == 0){
+		char *end;
+		int i = strtol(args,&end,10);
+		if(end == args){
+			breakpoint_count = watchpoint_count = 0;
+			watch_I = false;
+			over.armed = false;
+			rearm();
+		}else if(i >= 0 && i < breakpoint_count){
+			delete_breakpoint(i);
+		}else{
+			printf("No breakpoint #%d\n",i);
+		}
+	}else if(strcmp(cmd,"l") == 0){
+		print_points();
+	}else if(strcmp(cmd,"r") == 0){
+		print_registers(c8);
+	}else if(strcmp(cmd,"m") == 0){
+		unsigned start = c8->registers.I,len = 16;
+		sscanf(args,"%x %u",&start,&len);
+		print_memory(c8,start,len);
+	}else if(strcmp(cmd,"f") == 0){
+		find(c8,args);
+	}else if(strcmp(cmd,"z") == 0){
+		freeze(c8,args);
+	}else if(strcmp(cmd,"q") == 0){
+		debugger_quit = true;
+		return true;
+	}else{
+		help();
+	}
+
+	return false;
+}
+
+// Stopped: read commands until one resumes the emulation
+static void prompt(struct Chip8 *c8,const char *reason){
+	char line[128];
+
+	printf("%s\n",reason);
+	print_registers(c8);
+
+	for(;;){
+		printf("(chip8) ");
+		fflush(stdout);
+		if(fgets(line,sizeof(line),stdin) == NULL){
+			debugger_quit = true;
+			return;
+		}
+		if(debugger_command(c8,line))
+			return;
+	}
+}
+
+// Should the instruction at PC stop the machine before it runs?
+static bool breakpoint_hit(const struct Chip8 *c8){
+	unsigned pc = c8->registers.PC;
+
+	if(!bit_test(pc_bitmap,pc))
+		return false;
+
+	if(over.armed && over.addr == pc && over.sp == c8->sp){
+		over.armed = false;
+		return true;
+	}
+	for(int i = 0;i < breakpoint_count;i++)
+		if(breakpoints[i].addr == pc && condition_holds(&breakpoints[i],c8))
+			return true;
+	return false;
+}
+
+// Does the instruction at PC write to a watched address?
+static bool writes_watched(const struct Chip8 *c8){
+	unsigned pc = c8->registers.PC;
+	unsigned opcode = c8->memory[pc] << 8 | c8->memory[(pc + 1) & 0xFFF];
+	unsigned I = c8->registers.I;
+	unsigned count;
+
+	if((opcode & 0xF0FF) == 0xF033)
+		count = 3;
+	else if((opcode & 0xF0FF) == 0xF055)
+		count = ((opcode >> 8) & 0xF) + 1;
+	else
+		return false;
+
+	for(unsigned i = 0;i < count;i++)
+		if(bit_test(watch_bitmap,I + i))
+			return true;
+	return false;
+}
+
+/* A frame of the engine,one instruction at a time with the armed checks in between.*/
+unsigned debugger_run(struct Chip8 *c8,unsigned budget){
+	char reason[64];
+	unsigned n = 0;
+
+	engine_frame_start(c8);
+	while(engine_frame_left(c8,n,budget) && !debugger_quit){
+		reason[0] = 0;
+		if(interrupted){
+			interrupted = 0;
+			snprintf(reason,sizeof(reason),"Interrupted");
+		}else if(breakpoint_hit(c8)){
+			snprintf(reason,sizeof(reason),"Breakpoint at %03X",(unsigned) c8->registers.PC);
+		}
+
+		if(reason[0]){
+			rearm();
+			prompt(c8,reason);
+			if(debugger_quit)
+				break;
+		}
+
+		bool watched = watchpoint_count && writes_watched(c8);
+		unsigned pc = c8->registers.PC,I = c8->registers.I;
+
+		bool end_frame = engine_frame_step(c8);
+		n++;
+
+		if(watched){
+			snprintf(reason,sizeof(reason),"Watchpoint: %03X wrote to memory at %03X",pc,I);
+			prompt(c8,reason);
+		}else if(watch_I && c8->registers.I != I){
+			snprintf(reason,sizeof(reason),"Watchpoint: %03X changed I from %03X",pc,I);
+			prompt(c8,reason);
+		}else if(steps && --steps == 0){
+			prompt(c8,"Stepped");
+		}
+
+		if(end_frame)
+			break;
+	}
+
+	rearm();
+	return n;
+}
@@ -0,0 +1,16 @@
+#ifndef DEBUGGER_H
+#define DEBUGGER_H
+
+#include<signal.h>
+
+#include"chip_8.h"
+
+// Set while anything needs the debugger to look at every instruction (see debugger.c)
+extern volatile sig_atomic_t debugger_armed;
+extern bool debugger_quit;
+
+void debugger_init(void);
+bool debugger_command(struct Chip8 *c8,const char *line);
+unsigned debugger_run(struct Chip8 *c8,unsigned budget);
+
+#endif
@@ -0,0 +1,335 @@
+#include<pthread.h>
+#include<stdatomic.h>
+#include<stdbool.h>
+#include<stdint.h>
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<time.h>
+
+#include"chip_8.h"
+#include"difftest.h"
+
+/* Differential testing: two engines run the same ROM with the same input in lockstep and their 
+ * machines are compared every `interval` instructions (at the end of a frame). On the first 
+ * mismatch both are rewound to the last state they agreed on and the instruction that made them 
+ * differ is found by bisection (replaying single instructions from that state).
+ *
+ * The fuzzer does the same over randomly generated ROMs, on all cores.
+ */
+
+int difftest_rom(const struct DiffOptions *opt,const struct Chip8 *start);
+int difftest_fuzz(const struct DiffOptions *opt);
+
+static atomic_bool fuzz_stop;
+
+static unsigned run_frame(struct Chip8 *c8,const struct Engine *e,const struct DiffOptions *opt,
+			  unsigned frame){
+	chip8_scripted_input(opt->input_seed,frame,c8->keypad);
+	unsigned n = e->run(c8,opt->quirks,opt->speed);
+	chip8_tick_timers(c8);
+	return n;
+}
+
+/* Replays `k` instructions one at a time from `from` (the start of `frame`). Frames end exactly like
+ * they do in run_frame() so the result is the same as running whole frames. */
+static void replay(struct Chip8 *c8,const struct Chip8 *from,unsigned frame,const struct Engine *e,
+		   const struct DiffOptions *opt,uint64_t k){
+	unsigned in_frame = 0;
+
+	*c8 = *from;
+	for(uint64_t i = 0;i < k;i++){
+		if(in_frame == 0)
+			chip8_scripted_input(opt->input_seed,frame,c8->keypad);
+
+		bool end = e->step(c8,opt->quirks);
+		if(end || ++in_frame == opt->speed){
+			chip8_tick_timers(c8);
+			frame++;
+			in_frame = 0;
+		}
+	}
+}
+
+static bool same_state(const struct Chip8 *a,const struct Chip8 *b){
+	return memcmp(a->registers.V,b->registers.V,sizeof(a->registers.V)) == 0 &&
+	       a->registers.I == b->registers.I &&
+	       a->registers.PC == b->registers.PC &&
+	       a->sp == b->sp &&
+	       memcmp(a->stack,b->stack,sizeof(a->stack)) == 0 &&
+	       a->delay_timer == b->delay_timer &&
+	       a->sound_timer == b->sound_timer &&
+	       memcmp(a->keypad,b->keypad,sizeof(a->keypad)) == 0 &&
+	       a->rng == b->rng &&
+	       chip8_display_hash(a) == chip8_display_hash(b) &&
+	       memcmp(a->memory,b->memory,sizeof(a->memory)) == 0;
+}
+
+static void print_diff(const struct Chip8 *a,const struct Chip8 *b,const char *na,const char *nb){
+	for(int i = 0;i < 16;i++)
+		if(a->registers.V[i] != b->registers.V[i])
+			fprintf(stderr,"  V%X: %s 0x%02X %s 0x%02X\n",i,na,a->registers.V[i],nb,b->registers.V[i]);
+	if(a->registers.I != b->registers.I)
+		fprintf(stderr,"  I: %s 0x%03X %s 0x%03X\n",na,(int)a->registers.I,nb,(int)b->registers.I);
+	if(a->registers.PC != b->registers.PC)
+		fprintf(stderr,"  PC: %s 0x%03X %s 0x%03X\n",na,(int)a->registers.PC,nb,(int)b->registers.PC);
+	if(a->sp != b->sp || memcmp(a->stack,b->stack,sizeof(a->stack)) != 0){
+		fprintf(stderr,"  stack: %s",na);
+		for(int i = 0;i < a->sp;i++)
+			fprintf(stderr," %03X",a->stack[i]);
+		fprintf(stderr," | %s",nb);
+		for(int i = 0;i < b->sp;i++)
+			fprintf(stderr," %03X",b->stack[i]);
+		fprintf(stderr,"\n");
+	}
+	if(a->delay_timer != b->delay_timer)
+		fprintf(stderr,"  delay timer: %s %d %s %d\n",na,a->delay_timer,nb,b->delay_timer);
+	if(a->sound_timer != b->sound_timer)
+		fprintf(stderr,"  sound timer: %s %d %s %d\n",na,a->sound_timer,nb,b->sound_timer);
+	if(memcmp(a->keypad,b->keypad,sizeof(a->keypad)) != 0)
+		fprintf(stderr,"  keypad differs\n");
+	if(a->rng != b->rng)
+		fprintf(stderr,"  rng: %s 0x%08X %s 0x%08X\n",na,a->rng,nb,b->rng);
+	if(chip8_display_hash(a) != chip8_display_hash(b))
+		fprintf(stderr,"  display hash: %s %016llx %s %016llx\n",na,
+			(unsigned long long) chip8_display_hash(a),nb,(unsigned long long) chip8_display_hash(b));
+	for(int i = 0;i < 0x1000;i++)
+		if(a->memory[i] != b->memory[i])
+			fprintf(stderr,"  memory[0x%03X]: %s 0x%02X %s 0x%02X\n",i,na,a->memory[i],nb,b->memory[i]);
+}
+
+/* Both engines agree at `from` (the start of `frame`) and disagree `hi` instructions later, finds 
+ * the first instruction after which they disagree and reports it.*/
+static void bisect(const struct Chip8 *from,unsigned frame,uint64_t hi,const struct DiffOptions *opt,
+		   uint64_t base){
+	struct Chip8 *a = malloc(sizeof(*a));
+	struct Chip8 *b = malloc(sizeof(*b));
+	uint64_t lo = 0;
+
+	replay(a,from,frame,opt->a,opt,hi);
+	replay(b,from,frame,opt->b,opt,hi);
+	if(same_state(a,b)){
+		// Same state but one of them ended a frame at a different instruction
+		fprintf(stderr,"Engines %s and %s ran a different number of instructions in frame %u\n",
+			opt->a->name,opt->b->name,frame);
+		free(a);
+		free(b);
+		return;
+	}
+
+	while(hi - lo > 1){
+		uint64_t mid = lo + (hi - lo) / 2;
+
+		replay(a,from,frame,opt->a,opt,mid);
+		replay(b,from,frame,opt->b,opt,mid);
+		if(same_state(a,b))
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	// `a` is the state right before the diverging instruction
+	replay(a,from,frame,opt->a,opt,lo);
+	unsigned pc = a->registers.PC;
+	unsigned opcode = a->memory[pc] << 8 | a->memory[(pc + 1) & 0xFFF];
+
+	replay(a,from,frame,opt->a,opt,hi);
+	replay(b,from,frame,opt->b,opt,hi);
+	fprintf(stderr,"Engines %s and %s diverge at instruction %llu: PC 0x%03X opcode %04X\n",
+		opt->a->name,opt->b->name,(unsigned long long)(base + hi),pc,opcode);
+	print_diff(a,b,opt->a->name,opt->b->name);
+
+	free(a);
+	free(b);
+}
+
+/* Runs both engines from `start` in lockstep, returns true if they agreed all the way through. 
+ * `executed` gets the number of instructions run (by one engine).*/
+static bool lockstep(const struct DiffOptions *opt,const struct Chip8 *start,uint64_t *executed){
+	struct Chip8 *a = malloc(sizeof(*a));
+	struct Chip8 *b = malloc(sizeof(*b));
+	struct Chip8 *check = malloc(sizeof(*check)); // the last state both agreed on
+	unsigned check_frame = 0;
+	uint64_t since_check = 0;
+	uint64_t total = 0;
+	bool agree = true;
+
+	*a = *start;
+	*b = *start;
+	*check = *start;
+
+	for(unsigned frame = 0;frame < opt->frames && !atomic_load_explicit(&fuzz_stop,memory_order_relaxed);frame++){
+		unsigned na = run_frame(a,opt->a,opt,frame);
+		unsigned nb = run_frame(b,opt->b,opt,frame);
+		bool last = frame + 1 == opt->frames;
+
+		since_check += na > nb ? na : nb;
+		total += na;
+
+		if(na != nb || since_check >= opt->interval || last){
+			if(na != nb || !same_state(a,b)){
+				bisect(check,check_frame,since_check,opt,total - since_check);
+				agree = false;
+				break;
+			}
+
+			*check = *a;
+			check_frame = frame + 1;
+			since_check = 0;
+		}
+	}
+
+	*executed = total;
+	free(a);
+	free(b);
+	free(check);
+	return agree;
+}
+
+int difftest_rom(const struct DiffOptions *opt,const struct Chip8 *start){
+	uint64_t executed;
+	struct timespec t0,t1;
+
+	clock_gettime(CLOCK_MONOTONIC,&t0);
+	bool agree = lockstep(opt,start,&executed);
+	clock_gettime(CLOCK_MONOTONIC,&t1);
+
+	double secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+	printf("%s vs %s (%s quirks): %llu instructions,%u frames in %.3fs: %s\n",opt->a->name,
+	       opt->b->name,opt->quirks->name,(unsigned long long) executed,opt->frames,secs,
+	       agree ? "identical" : "DIVERGED");
+
+	return agree ? 0 : 1;
+}
+
+// A random but valid opcode,jumps and calls stay inside the program
+static uint16_t random_opcode(uint32_t *s){
+	static const uint8_t alu[] = {0x0,0x1,0x2,0x3,0x4,0x5,0x6,0x7,0xE};
+	static const uint8_t fx[] = {0x07,0x0A,0x15,0x18,0x1E,0x29,0x33,0x55,0x65};
+	uint32_t r = *s = chip8_mix(*s + 0x9E3779B9);
+	uint16_t x = (r >> 8) & 0xF;
+	uint16_t y = (r >> 12) & 0xF;
+	uint16_t n = (r >> 16) & 0xF;
+	uint16_t nn = (r >> 16) & 0xFF;
+	uint16_t nnn = 0x200 + ((r >> 20) % 0x700) * 2;
+
+	switch(r % 20){
+		case 0: return (r & 0x100) ? 0x00E0 : 0x00EE;
+		case 1: return 0x1000 | nnn;
+		case 2: return 0x2000 | nnn;
+		case 3: return 0x3000 | x << 8 | nn;
+		case 4: return 0x4000 | x << 8 | nn;
+		case 5: return 0x5000 | x << 8 | y << 4;
+		case 6: return 0x6000 | x << 8 | nn;
+		case 7: return 0x7000 | x << 8 | nn;
+		case 8:
+		case 9:
+		case 10: return 0x8000 | x << 8 | y << 4 | alu[n % sizeof(alu)];
+		case 11: return 0x9000 | x << 8 | y << 4;
+		case 12: return 0xA000 | (r >> 20);
+		case 13: return 0xB000 | nnn;
+		case 14: return 0xC000 | x << 8 | nn;
+		case 15:
+		case 16: return 0xD000 | x << 8 | y << 4 | n;
+		case 17: return 0xE000 | x << 8 | ((r & 0x100) ? 0x9E : 0xA1);
+		default: return 0xF000 | x << 8 | fx[n % sizeof(fx)];
+	}
+}
+
+struct FuzzWorker{
+	const struct DiffOptions *opt;
+	int id;
+	pthread_t thread;
+	uint64_t instructions;
+	uint64_t roms;
+};
+
+static void *fuzz_worker(void *arg){
+	struct FuzzWorker *w = arg;
+	struct DiffOptions opt = *w->opt;
+	struct Chip8 *start = malloc(sizeof(*start));
+	struct timespec now;
+	time_t deadline;
+
+	clock_gettime(CLOCK_MONOTONIC,&now);
+	deadline = now.tv_sec + w->opt->seconds;
+
+	for(uint32_t k = w->id;!atomic_load(&fuzz_stop);k += w->opt->threads){
+		clock_gettime(CLOCK_MONOTONIC,&now);
+		if(now.tv_sec >= deadline)
+			break;
+
+		uint32_t seed = w->opt->seed + k;
+		uint32_t s = seed;
+		uint64_t executed;
+
+		// With no profile given every ROM is run with the next one
+		opt.quirks = w->opt->quirks ? w->opt->quirks : &quirk_profiles[k % 3];
+		opt.seed = seed;
+		opt.input_seed = seed;
+
+		chip8_init(start,seed);
+		for(int i = 0x200;i < 0x1000;i += 2){
+			uint16_t op = random_opcode(&s);
+			start->memory[i] = op >> 8;
+			start->memory[i + 1] = op & 0xFF;
+		}
+		chip8_wrote(start,0x200,0x1000 - 0x200);
+
+		bool agree = lockstep(&opt,start,&executed);
+		w->instructions += executed;
+		w->roms++;
+
+		if(!agree){
+			char name[64];
+			snprintf(name,sizeof(name),"fuzz-%u.ch8",seed);
+
+			FILE *f = fopen(name,"wb");
+			if(f){
+				fwrite(&start->memory[0x200],1,0x1000 - 0x200,f);
+				fclose(f);
+			}
+			fprintf(stderr,"Reproduce with: chip_8 --diff=%s,%s -q %s -s %u --frames %u --seed %u "
+				"--input %u %s\n",opt.a->name,opt.b->name,opt.quirks->name,opt.speed,opt.frames,
+				seed,seed,name);
+			atomic_store(&fuzz_stop,true);
+			break;
+		}
+	}
+
+	free(start);
+	return NULL;
+}
+
+int difftest_fuzz(const struct DiffOptions *opt){
+	struct FuzzWorker *workers = calloc(opt->threads,sizeof(*workers));
+	uint64_t instructions = 0,roms = 0;
+	struct timespec t0,t1;
+
+	atomic_store(&fuzz_stop,false);
+	clock_gettime(CLOCK_MONOTONIC,&t0);
+
+	for(int i = 0;i < opt->threads;i++){
+		workers[i].opt = opt;
+		workers[i].id = i;
+		pthread_create(&workers[i].thread,NULL,fuzz_worker,&workers[i]);
+	}
+
+	for(int i = 0;i < opt->threads;i++){
+		pthread_join(workers[i].thread,NULL);
+		instructions += workers[i].instructions;
+		roms += workers[i].roms;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC,&t1);
+	double secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+	bool failed = atomic_load(&fuzz_stop);
+
+	printf("Fuzzed %s vs %s: %llu ROMs,%llu instructions in %.1fs on %d threads (%.1fM instructions/s)"
+	       ": %s\n",opt->a->name,opt->b->name,(unsigned long long) roms,
+	       (unsigned long long) instructions,secs,opt->threads,instructions / secs / 1e6,
+	       failed ? "DIVERGED" : "no divergence");
+
+	free(workers);
+	return failed ? 1 : 0;
+}
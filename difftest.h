@@ -0,0 +1,22 @@
+#ifndef DIFFTEST_H
+#define DIFFTEST_H
+
+#include"chip_8.h"
+
+struct DiffOptions{
+	const struct Engine *a;
+	const struct Engine *b;
+	const struct Quirks *quirks;
+	unsigned speed; // instructions per frame
+	unsigned interval; // compare the machines at least every `interval` instructions
+	unsigned frames; // how many frames to run for
+	uint32_t seed; // seed of CXNN's random numbers
+	uint32_t input_seed; // seed of the scripted keypad input,0 for no input
+	int threads; // fuzzing only
+	unsigned seconds; // fuzzing only
+};
+
+int difftest_rom(const struct DiffOptions *opt,const struct Chip8 *start);
+int difftest_fuzz(const struct DiffOptions *opt);
+
+#endif
@@ -3,6 +3,7 @@
 #include<stdbool.h>
 #include<stdio.h>
 #include<stdlib.h>
+#include<string.h>
 
 #include"chip_8.h"
 
@@ -12,23 +13,33 @@
 #define WINDOW_HEIGHT 32
 #define SCALE 20
 
-struct Game{
-	SDL_Window *window;
-	SDL_Renderer *renderer;
-	SDL_Texture *background;
-	SDL_Event event;
-	bool is_running;
-	bool keypad[16];
+#include"display.h"
+/* Extra key bindings on top of the hex keypad layout in game_events(), indexed by the CHIP-8 key
+ * (SDL_SCANCODE_UNKNOWN means no extra binding). Picked per ROM by the ROM database.*/
+const struct Keymap keymaps[] = {
+	[KEYMAP_DEFAULT] = {"default",{0}},
+	[KEYMAP_ARROWS] = {"arrows",{
+		[0x2] = SDL_SCANCODE_UP,[0x4] = SDL_SCANCODE_LEFT,[0x5] = SDL_SCANCODE_SPACE,
+		[0x6] = SDL_SCANCODE_RIGHT,[0x8] = SDL_SCANCODE_DOWN}},
+	[KEYMAP_LEFT_RIGHT] = {"leftright",{
+		[0x4] = SDL_SCANCODE_LEFT,[0x5] = SDL_SCANCODE_SPACE,[0x6] = SDL_SCANCODE_RIGHT}},
+	[KEYMAP_PONG] = {"pong",{
+		[0x1] = SDL_SCANCODE_UP,[0x4] = SDL_SCANCODE_DOWN}},
+	[KEYMAP_TETRIS] = {"tetris",{
+		[0x4] = SDL_SCANCODE_UP,[0x5] = SDL_SCANCODE_LEFT,[0x6] = SDL_SCANCODE_RIGHT,
+		[0x7] = SDL_SCANCODE_DOWN}},
 };
-bool display[WINDOW_HEIGHT][WINDOW_WIDTH] = {0}; 
+
+int keymap = KEYMAP_DEFAULT;
 
 bool game_init_sdl(struct Game *g);
 bool game_new(struct Game **game);
 void game_free(struct Game **game);
-void game_events(struct Game *g,int* key);
-bool draw(struct Game *g,int x,int y,int N,int data);
-void render_screen(struct Game *g);
-bool clear_screen(struct Game *g);
+void game_events(struct Game *g,bool keypad[16]);
+bool draw(struct Chip8 *c8,int x,int y,int N,int data);
+bool draw_wrap(struct Chip8 *c8,int x,int y,int N,int data);
+void render_screen(struct Game *g,const struct Chip8 *c8);
+bool clear_screen(struct Chip8 *c8);
 
 bool game_init_sdl(struct Game *g){
 	//printf("%d\n",SDL_FLAGS);
@@ -79,12 +90,17 @@ bool game_new(struct Game **game){
 void game_free(struct Game **game){
 	if(*game){
 		struct Game *g = *game;
-		if(g->window){
-			SDL_DestroyWindow(g->window);
-			g->window = NULL;
+		// The texture belongs to the renderer and the renderer to the window
+		if(g->screen){
+			SDL_DestroyTexture(g->screen);
+			g->screen = NULL;
 		}
 		if(g->renderer){
 			SDL_DestroyRenderer(g->renderer);
+			g->renderer = NULL;
+		}
+		if(g->window){
+			SDL_DestroyWindow(g->window);
 			g->window = NULL;
 		}
 
@@ -99,7 +115,8 @@ void game_free(struct Game **game){
 	}
 }
 
-void game_events(struct Game *g,int* key){
+// Polls SDL and updates the machine's keypad with the host keyboard
+void game_events(struct Game *g,bool keypad[16]){
 		while(SDL_PollEvent(&(g->event))){
 			switch (g->event.type){
 				case SDL_EVENT_QUIT:
@@ -107,33 +124,58 @@ void game_events(struct Game *g,int* key){
 					g->is_running = false;
 					break;
 
+				case SDL_EVENT_MOUSE_BUTTON_DOWN:
+					g->clicked = true;
+					g->click_x = g->event.button.x;
+					g->click_y = g->event.button.y;
+					break;
+
 				case SDL_EVENT_KEY_UP:
 				case SDL_EVENT_KEY_DOWN:
                 			bool isPressed = (g->event.type == (SDL_EVENT_KEY_DOWN));
+					bool before[16];
+					memcpy(before,keypad,sizeof(before));
                 			switch (g->event.key.scancode){
 						case SDL_SCANCODE_ESCAPE: g->is_running = false; break;
-                    				case SDL_SCANCODE_X: g->keypad[0x0] = isPressed;break;
-                    				case SDL_SCANCODE_1: g->keypad[0x1] = isPressed;break;
-				                case SDL_SCANCODE_2: g->keypad[0x2] = isPressed;break;
-                    				case SDL_SCANCODE_3: g->keypad[0x3] = isPressed;break;
-                    				case SDL_SCANCODE_Q: g->keypad[0x4] = isPressed;break;
-                    				case SDL_SCANCODE_W: g->keypad[0x5] = isPressed;break;
-                    				case SDL_SCANCODE_E: g->keypad[0x6] = isPressed;break;
-                    				case SDL_SCANCODE_A: g->keypad[0x7] = isPressed;break;
-                    				case SDL_SCANCODE_S: g->keypad[0x8] = isPressed;break;
-                    				case SDL_SCANCODE_D: g->keypad[0x9] = isPressed;break;
-                    				case SDL_SCANCODE_Z: g->keypad[0xA] = isPressed;break;
-                    				case SDL_SCANCODE_C: g->keypad[0xB] = isPressed;break;
-                    				case SDL_SCANCODE_4: g->keypad[0xC] = isPressed;break;
-                    				case SDL_SCANCODE_R: g->keypad[0xD] = isPressed;break;
-                    				case SDL_SCANCODE_F: g->keypad[0xE] = isPressed;break;
-                    				case SDL_SCANCODE_V: g->keypad[0xF] = isPressed;break;
+						case SDL_SCANCODE_TAB:
+							if(isPressed && !g->event.key.repeat)
+								g->turbo = !g->turbo;
+							break;
+                    				case SDL_SCANCODE_X: keypad[0x0] = isPressed;break;
+                    				case SDL_SCANCODE_1: keypad[0x1] = isPressed;break;
+				                case SDL_SCANCODE_2: keypad[0x2] = isPressed;break;
+                    				case SDL_SCANCODE_3: keypad[0x3] = isPressed;break;
+                    				case SDL_SCANCODE_Q: keypad[0x4] = isPressed;break;
+                    				case SDL_SCANCODE_W: keypad[0x5] = isPressed;break;
+                    				case SDL_SCANCODE_E: keypad[0x6] = isPressed;break;
+                    				case SDL_SCANCODE_A: keypad[0x7] = isPressed;break;
+                    				case SDL_SCANCODE_S: keypad[0x8] = isPressed;break;
+                    				case SDL_SCANCODE_D: keypad[0x9] = isPressed;break;
+                    				case SDL_SCANCODE_Z: keypad[0xA] = isPressed;break;
+                    				case SDL_SCANCODE_C: keypad[0xB] = isPressed;break;
+                    				case SDL_SCANCODE_4: keypad[0xC] = isPressed;break;
+                    				case SDL_SCANCODE_R: keypad[0xD] = isPressed;break;
+                    				case SDL_SCANCODE_F: keypad[0xE] = isPressed;break;
+                    				case SDL_SCANCODE_V: keypad[0xF] = isPressed;break;
+						default:
+							for(int i = 0;i < 16;i++)
+								if(keymaps[keymap].keys[i] != SDL_SCANCODE_UNKNOWN &&
+								   keymaps[keymap].keys[i] == g->event.key.scancode)
+									keypad[i] = isPressed;
+							break;
 					} 
+
+					// For the latency harness
+					for(int i = 0;i < 16;i++)
+						if(keypad[i] && !before[i] && !g->event.key.repeat)
+							g->key_pressed_at[i] = g->event.key.timestamp;
 			}
 	}
 }
 
-bool draw(struct Game *g,int x,int y,int N,int data){
+/* Shared by draw() and draw_wrap(). `wrap` is always a constant at the call site so each of them 
+ * gets its own copy without the check in it.*/
+static inline bool _draw(struct Chip8 *c8,int x,int y,int N,int data,const bool wrap){
 	/*The natural ways of rendering pixels is to first traverse the height and then the width.
 	 *
 	 *			(x)
@@ -149,18 +191,35 @@ bool draw(struct Game *g,int x,int y,int N,int data){
 	 * So i.e. I will first go down and then go right. The top left is (0,0) and the bottom right
 	 * is (max_x,max_y). Hence the display is defined in terms of display[height][widht] and the 
 	 * pixels in display[y][x].
+	 *
+	 * The starting coordinate always wraps around, the pixels that go past an edge either get 
+	 * clipped or wrapped around to the other side.
 	 */
 
 	bool vf_flag = 0;
+	bool (*display)[DISPLAY_WIDTH] = c8->display;
 
 	x %= 64;
 	y %= 32;
 
 	for(int i = 0; i < N; i++){
+		int y_pos = y + i;
+
+		if(y_pos >= DISPLAY_HEIGHT){
+			if(!wrap)
+				break;
+			y_pos %= DISPLAY_HEIGHT;
+		}
+
 		for(int bit = 0; bit < 8; bit++){
-    			int pixel = (memory[data + i] >> (7 - bit)) & 1;
+    			int pixel = (c8->memory[(data + i) & 0xFFF] >> (7 - bit)) & 1;
 			int x_pos = x + bit;
-			int y_pos = y + i;
+
+			if(x_pos >= DISPLAY_WIDTH){
+				if(!wrap)
+					break;
+				x_pos %= DISPLAY_WIDTH;
+			}
 			
 			if(debug_flag){
 				printf("Num is : %b\n",data); 
@@ -177,14 +236,82 @@ bool draw(struct Game *g,int x,int y,int N,int data){
 	return vf_flag;
 }
 
-void render_screen(struct Game *g){
+// Draws a sprite,clipping whatever goes past the edges of the screen
+bool draw(struct Chip8 *c8,int x,int y,int N,int data){
+	return _draw(c8,x,y,N,data,false);
+}
+
+// Draws a sprite,wrapping whatever goes past the edges of the screen to the other side 
+bool draw_wrap(struct Chip8 *c8,int x,int y,int N,int data){
+	return _draw(c8,x,y,N,data,true);
+}
+
+typedef uint8_t u8x16 __attribute__((vector_size(16)));
+typedef uint32_t u32x4 __attribute__((vector_size(16)));
+
+/* Lit pixels snap to full brightness,unlit ones lose a quarter of their brightness every frame
+ * (at least 1,so they do get to black). So a sprite that's XORed off and back on within a frame or
+ * two (i.e. every moving sprite) dims a little instead of flickering. 16 pixels at a time 
+ * (SSE2/NEON through GCC's vector extensions),then expanded to XRGB and uploaded as one streaming 
+ * texture that the renderer scales to the window,so the CPU cost doesn't depend on the window size.*/
+static void render_phosphor(struct Game *g,const struct Chip8 *c8){
+	if(g->screen == NULL){
+		g->screen = SDL_CreateTexture(g->renderer,SDL_PIXELFORMAT_XRGB8888,SDL_TEXTUREACCESS_STREAMING,
+					      DISPLAY_WIDTH,DISPLAY_HEIGHT);
+		if(g->screen == NULL){
+			if(debug_flag)
+				fprintf(stderr,"Error creating the screen texture: %s\n",SDL_GetError());
+			g->phosphor = false;
+			return;
+		}
+		SDL_SetTextureScaleMode(g->screen,SDL_SCALEMODE_NEAREST);
+	}
+
+	uint8_t *intensity = &g->intensity[0][0];
+	const uint8_t *lit = (const uint8_t *) &c8->display[0][0]; // bools are 0 or 1
+
+	for(int i = 0;i < DISPLAY_WIDTH * DISPLAY_HEIGHT;i += 16){
+		u8x16 v,on;
+		memcpy(&v,intensity + i,16);
+		memcpy(&on,lit + i,16);
+		u8x16 fade = (v >> 2) + 1; // at least 1,so it gets to black
+		v = ((v - fade) & (u8x16) (v > fade)) | -on; // -1 is 0xFF
+		memcpy(intensity + i,&v,16);
+	}
+
+	void *pixels;
+	int pitch;
+	if(!SDL_LockTexture(g->screen,NULL,&pixels,&pitch))
+		return;
+
+	for(int y = 0;y < DISPLAY_HEIGHT;y++){
+		uint32_t *row = (uint32_t *) ((uint8_t *) pixels + y * pitch);
+		for(int x = 0;x < DISPLAY_WIDTH;x += 4){
+			u32x4 v = {g->intensity[y][x],g->intensity[y][x + 1],g->intensity[y][x + 2],
+				   g->intensity[y][x + 3]};
+			v *= 0x010101; // gray
+			memcpy(row + x,&v,16);
+		}
+	}
+	SDL_UnlockTexture(g->screen);
+
+	SDL_RenderTexture(g->renderer,g->screen,NULL,NULL);
+	SDL_RenderPresent(g->renderer);
+}
+
+void render_screen(struct Game *g,const struct Chip8 *c8){
+	if(g->phosphor){
+		render_phosphor(g,c8);
+		return;
+	}
+
     	SDL_SetRenderDrawColor(g->renderer, 0, 0, 0, 255);
     	SDL_RenderClear(g->renderer);
 
     	SDL_SetRenderDrawColor(g->renderer, 255, 255, 255, 255); // White colour
   	for(int y = 0; y < WINDOW_HEIGHT; y++) {
         	for(int x = 0; x < WINDOW_WIDTH; x++) {
-            		if (display[y][x]) {
+            		if (c8->display[y][x]) {
                 		SDL_FRect rect = {x * SCALE, y * SCALE, SCALE, SCALE};
                 		SDL_RenderFillRect(g->renderer, &rect);
             		}
@@ -194,11 +321,8 @@ void render_screen(struct Game *g){
     	SDL_RenderPresent(g->renderer); // update the rendering content
 }
 
-bool clear_screen(struct Game *g){
-	memset(display, 0, sizeof(display));
-
-    	SDL_SetRenderDrawColor(g->renderer, 0, 0, 0, 255);
-    	SDL_RenderClear(g->renderer);
-    	SDL_RenderPresent(g->renderer);
+// Only clears the display, it gets drawn on the next render_screen()
+bool clear_screen(struct Chip8 *c8){
+	memset(c8->display, 0, sizeof(c8->display));
     	return true;
 }
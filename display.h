@@ -4,23 +4,42 @@
 #include<SDL3/SDL.h> 
 #include<SDL3/SDL_main.h>
 
+#include"chip_8.h"
+#include"romdb.h" // the KEYMAP_ indices
+
 struct Game{
 	SDL_Window *window;
 	SDL_Renderer *renderer;
 	SDL_Texture *background;
 	SDL_Event event;
 	bool is_running;
-	bool keypad[16];
+	bool turbo; // fast forward,toggled with Tab
+	Uint64 key_pressed_at[16]; // SDL timestamp of the last press of each key not yet picked up,or 0
+	bool clicked; // a mouse click not yet picked up,at click_x,click_y (window coordinates)
+	float click_x,click_y;
+	// Phosphor persistence: lit pixels fade out over a few frames instead of vanishing
+	bool phosphor;
+	SDL_Texture *screen; // streaming,DISPLAY_WIDTH x DISPLAY_HEIGHT
+	uint8_t intensity[DISPLAY_HEIGHT][DISPLAY_WIDTH];
+};
+
+struct Keymap{
+	const char *name;
+	SDL_Scancode keys[16];
 };
 
+extern const struct Keymap keymaps[KEYMAP_COUNT];
+extern int keymap;
+
 bool game_init_sdl(struct Game *g);
 bool game_load_media(struct Game *g);
 bool game_new(struct Game **game);
 void game_free(struct Game **game);
-void game_events(struct Game *g,int* key);
+void game_events(struct Game *g,bool keypad[16]);
 void game_draw(struct Game *g);
-bool draw(struct Game *g,int x,int y,int N,int data);
-void render_screen(struct Game *g);
-bool clear_screen(struct Game *g);
+bool draw(struct Chip8 *c8,int x,int y,int N,int data);
+bool draw_wrap(struct Chip8 *c8,int x,int y,int N,int data);
+void render_screen(struct Game *g,const struct Chip8 *c8);
+bool clear_screen(struct Chip8 *c8);
 
 #endif
@@ -0,0 +1,381 @@
+#include<pthread.h>
+#include<sched.h>
+#include<stdatomic.h>
+#include<stdbool.h>
+#include<stdint.h>
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<time.h>
+
+#include"chip_8.h"
+#include"explore.h"
+
+/* State space explorer: every reachable state of a ROM by search instead of by hand. From the start
+ * machine every input (nothing or one of the 16 keys) is held for `frames` frames,each resulting
+ * state that hasn't been seen before is explored the same way,up to `depth` inputs deep.
+ *
+ * States are deduplicated by a 64 bit hash of the whole machine (memory,registers,stack,timers and
+ * display; not the random number generator,so states that only differ in it count once) in a lock
+ * free open addressing set. Every thread has its own deque of states to explore: it takes the 
+ * newest of its own (depth first,which keeps the deques short) and when it runs out steals the
+ * oldest from another thread's. Ends when there's nothing left to explore,the state limit or the
+ * time limit.
+ *
+ * States where a stop predicate holds (e.g. a game over flag) are counted and reported with the
+ * inputs leading to them but not explored further.*/
+
+enum{
+	PRED_EQ,
+	PRED_NE,
+	PRED_LT,
+	PRED_GT,
+	PRED_LE,
+	PRED_GE
+};
+
+static const char *pred_names[] = {"==","!=","<",">","<=",">="};
+
+struct Node{
+	struct Chip8 c8;
+	unsigned depth;
+	uint8_t path[EXPLORE_DEPTH_MAX]; // the inputs that lead here: 0 for none,1-16 for key 0-F
+};
+
+struct Deque{
+	pthread_mutex_t lock;
+	struct Node **items;
+	size_t head,tail,cap; // the owner works at the tail,thieves at the head
+};
+
+struct Explorer{
+	const struct ExploreOptions *opt;
+	_Atomic uint64_t *set;
+	uint64_t mask;
+	struct Deque *deques;
+	atomic_long pending; // states pushed and not yet expanded
+	atomic_bool stop;
+	atomic_ulong unique;
+	atomic_ulong expanded;
+	atomic_ulong hits;
+	atomic_uint max_depth;
+	uint64_t pcs[0x1000 / 64];
+	pthread_mutex_t lock; // pcs and first_hit
+	struct Node first_hit;
+	bool have_hit;
+	time_t deadline;
+};
+
+struct ExploreWorker{
+	struct Explorer *e;
+	int id;
+	pthread_t thread;
+	uint64_t pcs[0x1000 / 64];
+};
+
+bool explore_parse_predicate(const char *s,struct ExplorePredicate *p);
+int explore(const struct ExploreOptions *opt,const struct Chip8 *start);
+
+// "2F0==3","VE<1"
+bool explore_parse_predicate(const char *s,struct ExplorePredicate *p){
+	char op[3] = "";
+	char *end;
+
+	if(*s == 'V' || *s == 'v'){
+		char digit[2] = {s[1],0};
+		p->addr = 0x1000 + strtoul(digit,&end,16);
+		if(*end != 0)
+			return false;
+		s += 2;
+	}else{
+		p->addr = strtoul(s,&end,16) & 0xFFF;
+		if(end == s)
+			return false;
+		s = end;
+	}
+
+	for(int i = 0;i < 2 && strchr("=!<>",*s);i++)
+		op[i] = *s++;
+	p->op = -1;
+	for(int i = 0;i < (int) (sizeof(pred_names) / sizeof(*pred_names));i++)
+		if(strcmp(op,pred_names[i]) == 0)
+			p->op = i;
+
+	p->value = strtoul(s,&end,0);
+	return p->op >= 0 && end != s && *end == 0;
+}
+
+static bool predicate_holds(const struct ExplorePredicate *p,const struct Chip8 *c8){
+	unsigned v = p->addr >= 0x1000 ? c8->registers.V[p->addr & 0xF] : c8->memory[p->addr];
+
+	switch(p->op){
+		case PRED_EQ: return v == p->value;
+		case PRED_NE: return v != p->value;
+		case PRED_LT: return v < p->value;
+		case PRED_GT: return v > p->value;
+		case PRED_LE: return v <= p->value;
+		case PRED_GE: return v >= p->value;
+	}
+	return false;
+}
+
+static inline uint64_t mix(uint64_t h,uint64_t w){
+	h = (h ^ w) * 0x9E3779B97F4A7C15ULL;
+	return h ^ h >> 29;
+}
+
+static uint64_t hash_words(uint64_t h,const void *data,size_t len){
+	const uint8_t *p = data;
+	for(;len >= 8;len -= 8,p += 8){
+		uint64_t w;
+		memcpy(&w,p,8);
+		h = mix(h,w);
+	}
+	for(;len;len--)
+		h = mix(h,*p++);
+	return h;
+}
+
+static uint64_t state_hash(const struct Chip8 *c8){
+	uint64_t h = 0x243F6A8885A308D3ULL;
+
+	h = hash_words(h,c8->memory,sizeof(c8->memory));
+	h = hash_words(h,c8->display,sizeof(c8->display));
+	h = hash_words(h,c8->registers.V,sizeof(c8->registers.V));
+	h = mix(h,(uint64_t) c8->registers.I << 32 | (uint64_t) c8->registers.PC << 16 | c8->sp);
+	h = hash_words(h,c8->stack,sizeof(c8->stack));
+	h = mix(h,c8->delay_timer << 8 | c8->sound_timer);
+	return h ? h : 1; // 0 is an empty slot
+}
+
+// Returns true if `h` wasn't in the set yet
+static bool set_insert(struct Explorer *e,uint64_t h){
+	for(uint64_t i = h & e->mask;;i = (i + 1) & e->mask){
+		uint64_t seen = atomic_load_explicit(&e->set[i],memory_order_relaxed);
+		if(seen == h)
+			return false;
+		if(seen == 0){
+			uint64_t empty = 0;
+			if(atomic_compare_exchange_strong(&e->set[i],&empty,h))
+				return true;
+			if(empty == h)
+				return false;
+		}
+	}
+}
+
+static void push(struct Deque *d,struct Node *n){
+	pthread_mutex_lock(&d->lock);
+	if(d->tail == d->cap){
+		// Move what's left to the front,grow if that's not enough
+		memmove(d->items,d->items + d->head,(d->tail - d->head) * sizeof(*d->items));
+		d->tail -= d->head;
+		d->head = 0;
+		if(d->tail == d->cap){
+			size_t cap = d->cap ? d->cap * 2 : 64;
+			struct Node **items = realloc(d->items,cap * sizeof(*items));
+			if(items == NULL){
+				fprintf(stderr,"Out of memory for the explorer's deque\n");
+				exit(EXIT_FAILURE);
+			}
+			d->items = items;
+			d->cap = cap;
+		}
+	}
+	d->items[d->tail++] = n;
+	pthread_mutex_unlock(&d->lock);
+}
+
+static struct Node *pop(struct Deque *d,bool steal){
+	struct Node *n = NULL;
+
+	pthread_mutex_lock(&d->lock);
+	if(d->head < d->tail)
+		n = steal ? d->items[d->head++] : d->items[--d->tail];
+	pthread_mutex_unlock(&d->lock);
+	return n;
+}
+
+// One frame an instruction at a time,marking the PCs that ran
+static void run_frame(struct Chip8 *c8,const struct ExploreOptions *opt,uint64_t pcs[]){
+	for(unsigned n = 0;n < opt->speed;n++){
+		unsigned pc = c8->registers.PC;
+		pcs[pc >> 6] |= 1ULL << (pc & 63);
+		if(opt->quirks->execute(fetch(c8),c8))
+			break;
+	}
+	chip8_tick_timers(c8);
+}
+
+static void expand(struct ExploreWorker *w,const struct Node *node){
+	struct Explorer *e = w->e;
+	const struct ExploreOptions *opt = e->opt;
+	struct Node *child = NULL;
+
+	for(int input = 0;input <= 16 && !atomic_load_explicit(&e->stop,memory_order_relaxed);input++){
+		if(child == NULL && (child = malloc(sizeof(*child))) == NULL){
+			fprintf(stderr,"Out of memory for explorer states\n");
+			exit(EXIT_FAILURE);
+		}
+		child->c8 = node->c8;
+		for(unsigned f = 0;f < opt->frames;f++){
+			// Held for the whole branch,EX9E/FX0A would take it away otherwise
+			memset(child->c8.keypad,0,sizeof(child->c8.keypad));
+			if(input)
+				child->c8.keypad[input - 1] = true;
+			run_frame(&child->c8,opt,w->pcs);
+		}
+		memset(child->c8.keypad,0,sizeof(child->c8.keypad));
+
+		if(!set_insert(e,state_hash(&child->c8)))
+			continue;
+
+		unsigned long unique = atomic_fetch_add(&e->unique,1) + 1;
+		if(unique >= opt->max_states)
+			atomic_store(&e->stop,true);
+
+		child->depth = node->depth + 1;
+		memcpy(child->path,node->path,node->depth);
+		child->path[node->depth] = input;
+		unsigned max = atomic_load(&e->max_depth);
+		while(child->depth > max && !atomic_compare_exchange_weak(&e->max_depth,&max,child->depth))
+			;
+
+		bool hit = false;
+		for(int i = 0;i < opt->stops && !hit;i++)
+			hit = predicate_holds(&opt->stop[i],&child->c8);
+		if(hit){
+			atomic_fetch_add(&e->hits,1);
+			pthread_mutex_lock(&e->lock);
+			if(!e->have_hit || child->depth < e->first_hit.depth){ // the shortest way there
+				e->first_hit = *child;
+				e->have_hit = true;
+			}
+			pthread_mutex_unlock(&e->lock);
+			continue;
+		}
+		if(child->depth >= opt->depth)
+			continue;
+
+		atomic_fetch_add(&e->pending,1);
+		push(&e->deques[w->id],child);
+		child = NULL;
+	}
+
+	free(child);
+}
+
+static void *explore_worker(void *arg){
+	struct ExploreWorker *w = arg;
+	struct Explorer *e = w->e;
+	unsigned checks = 0;
+
+	while(!atomic_load_explicit(&e->stop,memory_order_relaxed)){
+		struct Node *n = pop(&e->deques[w->id],false);
+		for(int k = 1;n == NULL && k < e->opt->threads;k++)
+			n = pop(&e->deques[(w->id + k) % e->opt->threads],true);
+
+		if(n == NULL){
+			if(atomic_load(&e->pending) == 0)
+				break;
+			sched_yield();
+			continue;
+		}
+
+		expand(w,n);
+		free(n);
+		atomic_fetch_add(&e->expanded,1);
+		atomic_fetch_sub(&e->pending,1);
+
+		if(++checks % 64 == 0 && time(NULL) >= e->deadline)
+			atomic_store(&e->stop,true);
+	}
+
+	pthread_mutex_lock(&e->lock);
+	for(int i = 0;i < 0x1000 / 64;i++)
+		e->pcs[i] |= w->pcs[i];
+	pthread_mutex_unlock(&e->lock);
+	return NULL;
+}
+
+int explore(const struct ExploreOptions *opt,const struct Chip8 *start){
+	struct Explorer e = {.opt = opt};
+	int threads = opt->threads > 0 ? opt->threads : 1;
+	struct ExploreOptions o = *opt;
+	o.threads = threads;
+	o.depth = o.depth && o.depth <= EXPLORE_DEPTH_MAX ? o.depth : EXPLORE_DEPTH_MAX;
+	e.opt = &o;
+
+	uint64_t size = 1024;
+	while(size < (uint64_t) o.max_states * 2)
+		size *= 2;
+	e.set = calloc(size,sizeof(*e.set));
+	e.mask = size - 1;
+	e.deques = calloc(threads,sizeof(*e.deques));
+	struct ExploreWorker *workers = calloc(threads,sizeof(*workers));
+	struct Node *root = malloc(sizeof(*root));
+	if(!e.set || !e.deques || !workers || !root){
+		fprintf(stderr,"Out of memory for %u states\n",o.max_states);
+		return -1;
+	}
+	pthread_mutex_init(&e.lock,NULL);
+	for(int i = 0;i < threads;i++)
+		pthread_mutex_init(&e.deques[i].lock,NULL);
+
+	root->c8 = *start;
+	root->depth = 0;
+	set_insert(&e,state_hash(&root->c8));
+	atomic_store(&e.unique,1);
+	atomic_store(&e.pending,1);
+	push(&e.deques[0],root);
+
+	struct timespec t0,t1;
+	clock_gettime(CLOCK_MONOTONIC,&t0);
+	e.deadline = time(NULL) + (o.seconds ? o.seconds : 10);
+
+	for(int i = 0;i < threads;i++){
+		workers[i].e = &e;
+		workers[i].id = i;
+		pthread_create(&workers[i].thread,NULL,explore_worker,&workers[i]);
+	}
+	for(int i = 0;i < threads;i++)
+		pthread_join(workers[i].thread,NULL);
+
+	clock_gettime(CLOCK_MONOTONIC,&t1);
+	double secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+	unsigned pcs = 0;
+	for(int i = 0;i < 0x1000 / 64;i++)
+		pcs += __builtin_popcountll(e.pcs[i]);
+	unsigned long expanded = atomic_load(&e.expanded),unique = atomic_load(&e.unique);
+	long left = atomic_load(&e.pending);
+
+	printf("Explored %lu states (%lu unique,%u deep) in %.1fs on %d threads: %.0f branches/s,%u PCs "
+	       "reached,%s\n",expanded,unique,atomic_load(&e.max_depth),secs,threads,
+	       expanded * 17 / secs,pcs,left > 0 ? "stopped early" : "nothing left to explore");
+
+	if(o.stops){
+		printf("Stop predicates held in %lu states",atomic_load(&e.hits));
+		if(e.have_hit){
+			printf(",the first one %u inputs in (%u frames each):",e.first_hit.depth,o.frames);
+			for(unsigned i = 0;i < e.first_hit.depth;i++){
+				if(e.first_hit.path[i])
+					printf(" %X",e.first_hit.path[i] - 1);
+				else
+					printf(" -");
+			}
+		}
+		printf("\n");
+	}
+
+	// Whatever was left unexplored
+	for(int i = 0;i < threads;i++){
+		for(size_t k = e.deques[i].head;k < e.deques[i].tail;k++)
+			free(e.deques[i].items[k]);
+		free(e.deques[i].items);
+	}
+	free(e.deques);
+	free(workers);
+	free(e.set);
+	return 0;
+}
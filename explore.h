@@ -0,0 +1,31 @@
+#ifndef EXPLORE_H
+#define EXPLORE_H
+
+#include"chip_8.h"
+
+#define EXPLORE_PREDICATES_MAX 8
+#define EXPLORE_DEPTH_MAX 64
+
+// "memory[addr] op value",addr 0x1000 + x for Vx
+struct ExplorePredicate{
+	uint16_t addr;
+	int op;
+	uint8_t value;
+};
+
+struct ExploreOptions{
+	const struct Quirks *quirks;
+	unsigned speed; // instructions per frame
+	unsigned frames; // per branch: every input is held this long
+	unsigned depth; // branches deep at most
+	unsigned max_states; // unique states
+	int threads;
+	unsigned seconds;
+	struct ExplorePredicate stop[EXPLORE_PREDICATES_MAX]; // a state where any holds isn't explored further
+	int stops;
+};
+
+bool explore_parse_predicate(const char *s,struct ExplorePredicate *p);
+int explore(const struct ExploreOptions *opt,const struct Chip8 *start);
+
+#endif
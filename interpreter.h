@@ -0,0 +1,817 @@
+/* interpreter.h: the instruction decoder/executor, written once and stamped out once per quirk 
+ * profile and memory layout.
+ *
+ * There is deliberately no include guard. profiles.h includes this file once per profile after 
+ * defining:
+ *
+ * INTERP_NAME        suffix of the generated functions (execute_<prefix><name> and 
+ *                    run_<prefix><name>)
+ * QUIRK_VF_RESET     8XY1/8XY2/8XY3 reset VF to 0
+ * QUIRK_MEMORY       FX55/FX65 leave I pointing past the last register (I += X + 1)
+ * QUIRK_SHIFT        8XY6/8XYE shift Vx in place instead of Vy into Vx
+ * QUIRK_WRAP         DXYN wraps sprites around the screen edges instead of clipping them
+ * QUIRK_DISPLAY_WAIT DXYN waits for the vblank i.e. it ends the current frame
+ * QUIRK_JUMP         BNNN behaves as BXNN (jumps to XNN + Vx)
+ *
+ * Every quirk is a compile time constant inside a generated function, so the `#if`s below cost 
+ * nothing at run time and no quirk is ever looked at while executing an instruction. All the 
+ * quirks are #undef'd at the bottom so the next profile starts from a clean slate.
+ *
+ * The memory layout is what the includer of profiles.h defines, the same for all the profiles:
+ *
+ * INTERP_MACHINE           the machine's type, it has the fields of struct Chip8 but memory and
+ *                          display
+ * INTERP_PREFIX            goes before INTERP_NAME in the names of the generated functions
+ * INTERP_PARAMS,_ARGS      extra parameters of the generated functions (with a leading comma) and
+ *                          how they're passed on, empty if there are none
+ * INTERP_FETCH(c8)         the instruction at PC, moving PC past it
+ * INTERP_LOAD(c8,addr)     the byte at `addr` (wrapped at 4K)
+ * INTERP_STORE(c8,addr,v)  writes `v` to `addr` (wrapped at 4K)
+ * INTERP_WROTE(c8,addr,len) after every FX33/FX55, see chip8_wrote()
+ * INTERP_DUMP(c8,from,to)  prints memory for debug_flag
+ * INTERP_CLEAR(c8)         00E0
+ * INTERP_DRAW(c8,x,y,n)    DXYN at (x,y) from I, returns the collision, INTERP_DRAW_WRAP(c8,x,y,n)
+ *                          with QUIRK_WRAP
+ * INTERP_RAND(c8)          CXNN's random byte
+ */
+
+#define INTERP_CAT_(a,b) a##_##b
+#define INTERP_CAT(a,b) INTERP_CAT_(a,b)
+#define INTERP_GLUE_(a,b) a##b
+#define INTERP_GLUE(a,b) INTERP_GLUE_(a,b)
+#define INTERP_FN(fn) INTERP_CAT(fn,INTERP_GLUE(INTERP_PREFIX,INTERP_NAME))
+
+/* The opcode's nibbles(4 bits) have different meaning. The first nibble tells what category of 
+ * instruction is it.
+ *
+ * The 2'nd Nibble is `X` which tells which register needs to be used (where `X` is the number. i.e.
+ * Vx)
+ * The 3'rd Nibble is `Y` which tells which is the 2nd register to be used(where `Y` is the number. i.e.
+ * Vy)
+ * Note that both `X` and `Y` can range from 0-F.
+ * The 4'th Nibble is `N` and it's a const number 
+ * 
+ * `NN` The 2nd byte (i.e. 3rd and 4th nibble) is a const number
+ * `NNN` The 2nd,3rd and 4th nibbles are an address (i.e. a 12 bit memory address)
+ */
+/* Returns true when the instruction ends the current frame (only DXYN under QUIRK_DISPLAY_WAIT)*/
+static inline bool INTERP_FN(execute)(const unsigned short opcode,INTERP_MACHINE *c8 INTERP_PARAMS){
+	if(debug_flag) // not a call per instruction otherwise
+		logmsg("execute",true,debug_flag);
+	_registers *registers = &c8->registers;
+	bool end_frame = false;
+	unsigned short first_nibble = 0xF000;
+	unsigned short second_nibble = 0x0F00;
+	unsigned short third_nibble = 0x00F0;
+	unsigned short fourth_nibble = 0x000F;
+	unsigned short N;
+	unsigned short NN = 0x00FF;
+	unsigned short NNN = 0x0FFF;
+	unsigned short X; 
+	unsigned short Y;
+
+	if(debug_flag){
+		printf("First nibble before: %016b(%X)\n",first_nibble,first_nibble);
+		printf("Second nibble before: %016b(%X)\n",second_nibble,second_nibble);
+		printf("Third nibble before: %016b(%X)\n",third_nibble,third_nibble);
+		printf("Fourth nibble before: %016b(%X)\n",fourth_nibble,fourth_nibble);
+	}
+
+	/* Basically this gets the first nibble because the starting 4 bits are 1s and it will turn 
+	 * itself into the first 4 bits of the opcode by ANDing it together and the rest are 0s so 
+	 * whatever be the case they will always remain 0.
+	 */
+	first_nibble &= opcode; 
+	first_nibble >>= 12;
+	second_nibble &= opcode; 
+	second_nibble >>= 8;
+	third_nibble &= opcode; 
+	third_nibble >>= 4;
+	fourth_nibble &= opcode; 
+	N = fourth_nibble;
+	NN &= opcode;
+	NNN &= opcode;
+	X = second_nibble;
+	Y = third_nibble;
+
+	if(debug_flag){
+		printf("First nibble after: %016b(%X)\n",first_nibble,first_nibble);
+		printf("Second nibble after: %016b(%X)\n",second_nibble,second_nibble);
+		printf("Third nibble after: %016b(%X)\n",third_nibble,third_nibble);
+		printf("Fourth nibble after: %016b(%X)\n",fourth_nibble,fourth_nibble);
+	}
+
+
+	switch(first_nibble){
+		case 0x0:
+			/* Valid instructions:
+			 * 00E0 => Clears the screen
+			 * 00EE => Returns from the subroutine*/
+			
+			if(debug_flag)
+				printf("Welcome to case 0\n");
+
+			switch(opcode){
+				case 0x00E0:
+					if(debug_flag)
+						printf("Welcome to case 00E0\n");
+					INTERP_CLEAR(c8);
+			
+					break;
+
+				case 0x00EE:
+					if(debug_flag){
+						printf("Welcome to case 00EE\n");
+						printf("PC's value before is 0x%X\n",(int)registers->PC);
+					}
+
+					if(c8->sp != 0)
+						registers->PC = c8->stack[--c8->sp];	
+
+					if(debug_flag)
+						printf("PC's value after is 0x%X\n",(int)registers->PC);
+					
+					break;
+			}
+			
+			break;
+
+		case 0x1:
+			/* Valid instructions:
+			 * 1NNN => Jumps to address NNN */
+
+			if(debug_flag){
+				printf("Welcome to case 1\n");
+				printf("PC's value is 0x%X\n",(int)registers->PC);
+			}
+			registers->PC = NNN;
+
+			break;
+		case 0x2:
+			/* Valid instructions:
+			 * 2NNN => Calls to address NNN. The difference between calling and jumping
+			 *         is that in call the address of the current PC will be pushed in 
+			 *         the stack and when the function ends (i.e. returned) the value
+			 *         will be popped of the stack*/
+
+			if(debug_flag){
+				printf("Welcome to case 2NNN\n");
+				printf("PC's value is 0x%X\n",(int)registers->PC);
+			}
+
+			if(c8->sp < 16) // an overflowing call still jumps but the return address is lost
+				c8->stack[c8->sp++] = registers->PC;
+			registers->PC = NNN;
+
+			break;
+
+		case 0x3:
+			/* Valid instructions:
+			 * 3XNN => Compares Vx and NN (Vx == NN), if true then it 
+			 * skips next instruction */
+
+			if(debug_flag){
+				printf("Welcome to case 3\n");
+				printf("PC's value before is 0x%X\n",(int)registers->PC);
+			}
+			if(registers->V[X] == NN)
+				registers->PC += 2;
+
+			if(debug_flag)
+				printf("PC's value after is 0x%X\n",(int)registers->PC);
+
+			break;
+		case 0x4:
+			/* Valid instructions:
+			 * 4XNN => Compares Vx and NN (Vx != NN), if true then 
+			 * it skips next instruction */
+
+			if(debug_flag){
+				printf("Welcome to case 4\n");
+				printf("PC's value before is 0x%X\n",(int)registers->PC);
+			}
+			if(registers->V[X] != NN)
+				registers->PC += 2;
+
+			if(debug_flag)
+				printf("PC's value after is 0x%X\n",(int)registers->PC);
+
+			break;
+		case 0x5:
+			/* Valid instructions:
+			 * 5XY0 => Compares Vx and Vy (Vx == Vy), if true then 
+			 * it skips next instruction */
+
+			if(debug_flag){
+				printf("Welcome to case 5\n");
+				printf("PC's value before is 0x%X\n",(int)registers->PC);
+			}
+			if(registers->V[X] == registers->V[Y])
+				registers->PC += 2;
+
+			if(debug_flag)
+				printf("PC's value after is 0x%X\n",(int)registers->PC);
+
+			break;
+		case 0x6:
+			/* Valid instructions:
+			 * 6XNN : Sets Vx to NN */
+
+			if(debug_flag){
+				printf("Welcome to case 6\n");
+				printf("Register %d's value before is 0x%X\n",X,registers->V[X]);
+			}
+
+			registers->V[X] = NN;
+
+			if(debug_flag)
+				printf("Register %d's value after is 0x%X\n",X,registers->V[X]);
+
+			break;
+		case 0x7:
+			/* Valid instructions:
+			 * 7XNN : Adds Vx to NN */
+
+			if(debug_flag){
+				printf("Welcome to case 7\n");
+				printf("Register %d's value before is 0x%X\n",X,registers->V[X]);
+			}
+
+			registers->V[X] += NN;
+
+			if(debug_flag)
+				printf("Register %d's value after is 0x%X\n",X,registers->V[X]);
+
+
+			break;
+		case 0x8:
+			/* Valid instructions:
+			 * 8XY0 => Set's Vx equal to Vy (Vx = Vy)
+			 * 8XY1 => Set's Vx equal to Vx OR Vy (Vx |= Vy)
+			 * 8XY2 => Set's Vx equal to Vx AND Vy (Vx &= Vy)
+			 * 8XY3 => Set's Vx equal to Vx XOR Vy (Vx ^= Vy)
+			 * 8XY4 => Adds Vy  to Vx,if overflow then VF = 1 else VF = 0 (Vx += Vy)
+			 * 8XY5 => Subtracts Vx from Vy,if underflow then VF = 0 else VF = 1 (Vx -= Vy)
+			 * 8XY6 => Shifts Vx to the right by 1 (Vx >>= 1) , stores LSB before shifting
+			 * 	   into Vf
+			 * 8XY7 => Subtracts Vy from Vx,if underflow then VF = 0 else VF = 1
+			 *	   (Vx= Vy - Vx) 
+			 * 8XYE => Shifts Vx to the left by 1 (Vx <<= 1) , sets VF = 1 if MSB of Vx
+			 * 	   prior to shifting was present , else VF = 0*/
+
+			
+			if(debug_flag)
+				printf("Welcome to case 8\n");
+
+			switch(fourth_nibble){
+				case 0x0:
+					if(debug_flag){
+						printf("Welcome to case 8XY0\n");
+						printf("Register %d's value before is 0x%X\n",X,registers->V[X]);
+					}
+
+					registers->V[X] = registers->V[Y];
+					
+					if(debug_flag)
+						printf("Register %d's value after is 0x%X\n",X,registers->V[X]);
+
+					break;
+
+				case 0x1:
+					if(debug_flag){
+						printf("Welcome to case 8XY1\n");
+						printf("Register %d's value before is 0x%X\n",X,registers->V[X]);
+					}
+
+					registers->V[X] |= registers->V[Y];
+#if QUIRK_VF_RESET
+					registers->V[0xF] = 0; // All the bitwise operations reset 
+							       // the flag register to 0
+#endif
+
+					if(debug_flag)
+						printf("Register %d's value after is 0x%X\n",X,registers->V[X]);
+
+					break;
+				case 0x2:
+					if(debug_flag){
+						printf("Welcome to case 8XY2\n");
+						printf("Register %d's value before is 0x%X\n",X,registers->V[X]);
+					}
+
+					registers->V[X] &= registers->V[Y];
+#if QUIRK_VF_RESET
+					registers->V[0xF] = 0;
+#endif
+
+					if(debug_flag)
+						printf("Register %d's value after is 0x%X\n",X,registers->V[X]);
+
+					break;
+
+				case 0x3:
+					if(debug_flag){
+						printf("Welcome to case 8XY3\n");
+						printf("Register %d's value before is 0x%X\n",X,registers->V[X]);
+					}
+
+					registers->V[X] ^= registers->V[Y];
+#if QUIRK_VF_RESET
+					registers->V[0xF] = 0;
+#endif
+
+					if(debug_flag)
+						printf("Register %d's value after is 0x%X\n",X,registers->V[X]);
+
+					break;
+
+				case 0x4:
+					if(debug_flag){
+						printf("Welcome to case 8XY4\n");
+						printf("Register %d's value before is 0x%X\n",X,registers->V[X]);
+					}
+						
+					// An extra variable for storing the sum is used for an extreme
+					// case like "80F4",if the VF is set before then the sum would
+					// be wrong so hence the result is stored in a different 
+					// variable all together.
+					int sum = registers->V[X] + registers->V[Y];
+
+					registers->V[X] += registers->V[Y];
+
+					if(sum > 255)
+							registers->V[0xF] = 1;
+					else
+							registers->V[0xF] = 0;
+
+					if(debug_flag){
+						printf("Register %d's value after is 0x%X\n",X,registers->V[X]);
+						printf("Register F's value after is 0x%X\n",registers->V[0xF]);
+					}
+
+					break;
+
+				case 0x5:
+					if(debug_flag){
+						printf("Welcome to case 8XY5\n");
+						printf("Register %d's value before is 0x%X\n",X,registers->V[X]);
+						printf("Register %d's value before is 0x%X\n",Y,registers->V[Y]);
+					}
+					
+					bool _diff = registers->V[X] >= registers->V[Y];
+					
+					registers->V[X] = registers->V[X] - registers->V[Y];
+
+					if(_diff)
+							registers->V[0xF] = 1;
+					else
+							registers->V[0xF] = 0; // underflow
+
+					if(debug_flag){
+						printf("Register %d's value after is 0x%X(%d)\n",X,registers->V[X],registers->V[X]);
+						printf("Register %d's value after is 0x%X\n",Y,registers->V[Y]);
+						printf("Register F's value after is 0x%X\n",registers->V[0xF]);
+					}
+
+					break;
+
+				case 0x6:
+					if(debug_flag){
+						printf("Welcome to case 8XY6\n");
+						printf("Register %d's value before is 0x%X\n",X,registers->V[X]);
+					}
+					
+					unsigned short last_bit = 0x1;
+					
+#if QUIRK_SHIFT
+					last_bit &= registers->V[X];
+					registers->V[X] = registers->V[X] >>1;
+#else
+					last_bit &= registers->V[Y];
+					registers->V[X] = registers->V[Y] >>1;
+#endif
+
+
+					if(last_bit == 1)
+						registers->V[0xF] =1;
+					else
+						registers->V[0xF] =0;
+
+					if(debug_flag){
+						printf("Register %d's value after is 0x%X\n",X,registers->V[X]);
+						printf("Register F's value after is 0x%X\n",registers->V[0xF]);
+					}
+
+					break;
+
+
+				case 0x7:
+					if(debug_flag){
+						printf("Welcome to case 8XY7\n");
+						printf("Register %d's value before is 0x%X\n",X,registers->V[X]);
+					}
+					
+					int diff =registers->V[Y] >= registers->V[X]; 
+
+					registers->V[X] = registers->V[Y] - registers->V[X];
+
+					if(diff)
+							registers->V[0xF] = 1;
+					else
+							registers->V[0xF] = 0;
+
+					if(debug_flag){
+						printf("Register %d's value after is 0x%X\n",X,registers->V[X]);
+						printf("Register F's value after is 0x%X\n",registers->V[0xF]);
+					}
+
+					break;
+
+				case 0xE:
+					if(debug_flag){
+						printf("Welcome to case 8XYE\n");
+						printf("Register %d's value before is 0x%X\n",X,registers->V[X]);
+					}
+					
+					unsigned short first_bit = 0x80;
+
+					if(debug_flag)
+						printf("The first bit is:%b from the num:0b%08b\n",first_bit,registers->V[X]);
+
+#if QUIRK_SHIFT
+					first_bit &= registers->V[X];
+					registers->V[X] = registers->V[X] << 1;
+#else
+					first_bit &= registers->V[Y];
+					registers->V[X] = registers->V[Y] << 1;
+#endif
+
+					first_bit >>= 7;
+
+					if(first_bit == 1)
+						registers->V[0xF] =1;
+					else
+						registers->V[0xF] =0;
+
+					if(debug_flag){
+						printf("Register %d's value after is 0x%X\n",X,registers->V[X]);
+						printf("Register F's value after is 0x%X\n",registers->V[0xF]);
+					}
+
+					break;
+
+				default:
+					if(debug_flag)
+						printf("Bad instruction\n");
+					break;
+			}
+
+			break;
+
+		case 0x9:
+			/* Valid instructions:
+			 * 9XY0 => Compares Vx and Vy (Vx != NN), if true then it 
+			 * skips next instruction */
+
+			if(debug_flag){
+				printf("Welcome to case 9\n");
+				printf("PC's value before is 0x%X\n",(int)registers->PC);
+			}
+			if(registers->V[X] != registers->V[Y])
+				registers->PC += 2;
+
+			if(debug_flag)
+				printf("PC's value after is 0x%X\n",(int)registers->PC);
+
+			break;
+
+		case 0xA:
+			/* Valid instructions:
+			 * ANNN : Sets I to the address NNN.*/
+
+			if(debug_flag){
+				printf("Welcome to case A\n");
+				printf("Register value before is 0x%X\n",(int)registers->I);
+				printf("mem at the location is:%X\n",INTERP_LOAD(c8,registers->I));
+			}
+
+			registers->I = NNN;
+
+			if(debug_flag){
+				printf("Register value after is 0x%X\n",(int)registers->I);
+				printf("mem at the location is:%X\n",INTERP_LOAD(c8,registers->I));
+			}
+
+			break;
+		case 0xB:
+			/* Valid instructions:
+			 * BNNN : Jumps to the address NNN + V0
+			 * BXNN : (QUIRK_JUMP) Jumps to the address XNN + Vx*/
+
+			if(debug_flag){
+				printf("Welcome to case B\n");
+				printf("Register value before is 0x%X\n",(int)registers->PC);
+				printf("Register value 0 before is 0x%X\n",(int)registers->V[0]);
+			}
+
+#if QUIRK_JUMP
+			registers->PC = NNN + registers->V[X];
+#else
+			registers->PC = NNN + registers->V[0];
+#endif
+
+			if(debug_flag){
+				printf("Register value after is 0x%X\n",(int)registers->PC);
+			}
+
+			break;
+		case 0xC:
+			/* Valid instructions:
+			 * CXNN : Sets VX to the result of a bitwise and operation on a random number 
+			 * 	 (Typically: 0 to 255) and NN*/
+
+			if(debug_flag){
+				printf("Welcome to case C\n");
+				printf("Register value %d before is 0x%X\n",X,registers->V[X]);
+			}
+
+			registers->V[X] = INTERP_RAND(c8) & NN; 
+
+			if(debug_flag){
+				printf("Register value %d after is 0x%X\n",X,registers->V[X]);
+			}
+
+			break;
+		case 0xD:
+			/* Valid instructions:
+			 * DXYN : Draw at coordinate (Vx,Vy) .*/
+
+			if(debug_flag){
+				printf("Welcome to case D\n");
+				printf("memory[I] has : %X\n",INTERP_LOAD(c8,registers->I));
+				printf("Height is %d\n",N);
+				for(int i = 0; i < N;i++)
+					printf("=>%08b\n",INTERP_LOAD(c8,registers->I + i));
+			}
+			
+			int x_coor = registers->V[X];
+			int y_coor = registers->V[Y];
+			if(debug_flag)
+				printf("Y and X coordinates are %dx%d\n",y_coor,x_coor);
+#if QUIRK_WRAP
+			registers->V[0xF] = INTERP_DRAW_WRAP(c8,x_coor,y_coor,N);
+#else
+			registers->V[0xF] = INTERP_DRAW(c8,x_coor,y_coor,N);
+#endif
+#if QUIRK_DISPLAY_WAIT
+			end_frame = true;
+#endif
+
+			break;
+		case 0xE:
+			/* Valid instructions:
+			 * EX9E : Skips the next instruction if the key stored in VX(only consider 
+			 *        the lowest nibble) is pressed (usually the next instruction is a jump 
+			 *        to skip a code block). (if(key == Vx))
+			 * EXA1 : Skips the next instruction if the key stored in VX(only consider 
+			 *        the lowest nibble) is not pressed (usually the next instruction is a 
+			 *        jump to skip a code block). (if(key != Vx))        */
+
+
+			if(debug_flag)
+				printf("Welcome to case E\n");
+			switch(NN){
+				case 0x9E:
+					if(debug_flag){
+						printf("Welcome to case EX9E\n");
+						printf("PC's value after is 0x%X\n",(int)registers->PC);
+					}
+
+					if(c8->keypad[registers->V[X] & 0xF])
+						registers->PC += 2;
+
+					c8->keypad[registers->V[X] & 0xF] = false;
+
+					if(debug_flag)
+						printf("PC's value after is 0x%X\n",(int)registers->PC);
+
+					break;
+					
+				case 0xA1:
+					if(debug_flag){
+						printf("Welcome to case EXA1\n");
+						printf("PC's value after is 0x%X\n",(int)registers->PC);
+					}
+
+					if(!(c8->keypad[registers->V[X] & 0xF]))
+						registers->PC += 2;
+
+					if(debug_flag)
+						printf("PC's value after is 0x%X\n",(int)registers->PC);
+
+					break;
+			}
+
+			break;
+		case 0xF:
+			/* Valid instructions:
+			 * FX07: Sets Vx to the delay timer.
+			 * FX0A: Waits for a key press and then stored in Vx
+			 * FX15: Sets the delay timer to VX.
+			 * FX18: Sets the sound timer to VX.
+			 * FX1E: Adds Vx to I.( I += Vx) 
+			 * FX29: Sets I to the font address for the character stored in Vx
+			 * FX33: Stores BCD of Vx into I. 100's at I,10's at I+1,1's at I +2.
+			 * FX55: Stores vals from V0 to Vx in memory starting at address I. Offset of 
+			 *       I is increased by 1 after a val is written into it but I itself isn't
+			 *       changed.
+			 * FX65: Fills vals from V0 to Vx from memory starting at address I. Offset of 
+			 *       I is increased by 1 after a val is written into it but I itself isn't
+			 *       changed.
+			 *
+			 * Memory past 0xFFF wraps around to 0x000.
+			 */
+
+			if(debug_flag){
+				printf("Welcome to case F\n");
+				printf("Register I's value before is 0x%X\n",(int)registers->I);
+				printf("mem at the location is:%X\n",INTERP_LOAD(c8,registers->I));
+			}
+
+			switch(NN){
+				case 0x07:
+					if(debug_flag){
+						printf("Welcome to case FX07\n");
+						printf("Register %d before has:0x%X\n",X,registers->V[X]);
+						printf("Delay timer val is:%d\n",c8->delay_timer);
+					}
+
+					registers->V[X] = c8->delay_timer; 
+					
+
+					if(debug_flag)
+						printf("Register %d after has:0x%X\n",X,registers->V[X]);
+				
+					break;
+					
+				case 0x0A:
+					if(debug_flag){
+						printf("Welcome to case FX0A\n");
+						printf("Register %d before has:0x%X\n",X,registers->V[X]);
+					}
+
+					bool keyPressed = false;
+					for (int i = 0; i < 16; i++) 
+    						if(c8->keypad[i]){
+        						registers->V[X] = i;
+        						keyPressed = true;
+        						break;
+						}
+
+			//repeat until a key is pressed
+					if(!keyPressed){
+						if(debug_flag)
+							printf("Repeating FX0A cyle\n");
+    						registers->PC -= 2;
+					}
+					
+					c8->keypad[registers->V[X] & 0xF] = false;
+
+					if(debug_flag)
+						printf("Register %d after has:0x%X\n",X,registers->V[X]);
+					break;
+
+				case 0x15:
+					if(debug_flag)
+						printf("Welcome to case FX15\n");
+
+					c8->delay_timer = registers->V[X];
+
+					break;
+				case 0x18:
+					if(debug_flag)
+						printf("Welcome to case FX18\n");
+
+					c8->sound_timer = registers->V[X];
+
+					break;
+				case 0x1E:
+					if(debug_flag)
+						printf("Welcome to case FX1E\n");
+
+					registers->I += registers->V[X];
+
+					break;
+				case 0x29:
+					if(debug_flag){
+						printf("Welcome to case FX29\n");
+						printf("Register I before: %d\n",(int)registers->I);
+					}
+					registers->I = 0x50 + registers->V[X] * 5;
+					
+					if(debug_flag)
+						printf("Register I after: %d\n",(int)registers->I);
+					break;
+
+				case 0x33:
+					if(debug_flag){
+						printf("Welcome to case FX33\n");
+						INTERP_DUMP(c8,registers->I,registers->I + 2);
+						printf("val at V%d is 0x%X\n",X,registers->V[X]);
+					}
+					
+					for(int i = 0;i < 3;i++)
+						INTERP_STORE(c8,registers->I + i,0);
+					INTERP_WROTE(c8,registers->I,3);
+
+					int num = registers->V[X];
+					int _i = 2;
+
+					while(num != 0){
+						if(debug_flag)
+							printf("Num now is:%d with digit: %d being stored at 0x%X\n",num,num%10,registers-> I + _i);
+						INTERP_STORE(c8,registers->I + _i--,num%10);
+        					num = num / 10;
+    					}
+
+					if(debug_flag)
+						INTERP_DUMP(c8,registers->I,registers->I + 2);
+					break;
+
+				case 0x55:
+					if(debug_flag){
+						printf("Welcome to case FX55\n");
+						INTERP_DUMP(c8,registers->I,registers->I + X);
+						for(int i = 0;i <= X;i++)
+							printf("val at V%d is %X\n",i,registers->V[i]);
+					}
+
+					for(int i = 0;i <= X;i++)
+						INTERP_STORE(c8,registers->I + i,registers->V[i]);
+					INTERP_WROTE(c8,registers->I,X + 1);
+					
+#if QUIRK_MEMORY
+					registers->I = registers->I + X + 1;
+#endif
+					
+					if(debug_flag)
+						INTERP_DUMP(c8,registers->I,registers->I + X);
+					break;
+
+				case 0x65:
+					if(debug_flag){
+						printf("Welcome to case FX65\n");
+						INTERP_DUMP(c8,registers->I,registers->I + X);
+						for(int i = 0;i <= X;i++)
+							printf("val at V%d is %X\n",i,registers->V[i]);
+					}
+
+					for(int i = 0;i <= X;i++)
+						registers->V[i] = INTERP_LOAD(c8,registers->I + i); 
+
+#if QUIRK_MEMORY
+					registers->I = registers->I + X + 1;
+#endif
+					
+					if(debug_flag)
+						INTERP_DUMP(c8,registers->I,registers->I + X);
+					break;
+			}
+
+			if(debug_flag){
+				printf("Register I's value after is 0x%X\n",(int)registers->I);
+				printf("mem at the location is:%X\n",INTERP_LOAD(c8,registers->I));
+			}
+
+			break;
+
+		default:
+			printf("First nibble after: %016b\n",first_nibble);
+			break;
+	}
+
+	if(debug_flag)
+		logmsg("execute",false,debug_flag);
+	return end_frame;
+}
+
+// Runs up to `budget` instructions, returns how many were actually run
+static unsigned INTERP_FN(run)(INTERP_MACHINE *c8,unsigned budget INTERP_PARAMS){
+	unsigned n = 0;
+
+	while(n < budget){
+		n++;
+		if(INTERP_FN(execute)(INTERP_FETCH(c8),c8 INTERP_ARGS))
+			break;
+	}
+
+	return n;
+}
+
+#undef INTERP_NAME
+#undef QUIRK_VF_RESET
+#undef QUIRK_MEMORY
+#undef QUIRK_SHIFT
+#undef QUIRK_WRAP
+#undef QUIRK_DISPLAY_WAIT
+#undef QUIRK_JUMP
@@ -0,0 +1,152 @@
+#include<stdbool.h>
+#include<stdint.h>
+#include<stdio.h>
+
+#include"chip_8.h"
+#include"latency.h"
+#include"metrics.h"
+
+/* Input to photon latency. A key going down starts a probe that follows it through the machine:
+ *
+ *   key      the SDL key event (or the scripted press when headless)
+ *   observe  the first EX9E/EXA1 testing that key or FX0A while it's down
+ *   draw     the first DXYN/00E0 after that which changes the display
+ *   present  the end of the render_screen() (SDL_RenderPresent) that shows it
+ *
+ * and the time between the stages goes into histograms. Only one key is followed at a time. While
+ * a probe is waiting for `observe` or `draw` the frame runs through latency_run(),one instruction
+ * at a time on the same engine as any other frame (--vip's cycle budget included),otherwise the
+ * normal interpreter runs untouched. All times are metrics_now() ns.*/
+
+#define PROBE_TIMEOUT 120 // frames,after that the press counts as never shown
+
+enum{
+	STAGE_OBSERVE,
+	STAGE_DRAW,
+	STAGE_PRESENT
+};
+
+static struct{
+	int key;
+	int stage;
+	uint64_t key_time,observe_time,draw_time;
+	uint64_t key_frame;
+}probe;
+
+bool latency_enabled;
+bool latency_probing;
+
+static struct Histogram key_to_observe,observe_to_draw,draw_to_present,key_to_present,frames;
+static unsigned lost;
+
+void latency_key(int key,uint64_t now,uint64_t frame);
+unsigned latency_run(struct Chip8 *c8,unsigned budget);
+void latency_present(uint64_t now,uint64_t frame);
+int latency_scripted_input(unsigned frame,bool keypad[16]);
+void latency_report(FILE *out);
+
+// `key` went down at `now`,during `frame`
+void latency_key(int key,uint64_t now,uint64_t frame){
+	if(!latency_enabled || latency_probing)
+		return;
+
+	probe.key = key;
+	probe.stage = STAGE_OBSERVE;
+	probe.key_time = now;
+	probe.key_frame = frame;
+	latency_probing = true;
+}
+
+unsigned latency_run(struct Chip8 *c8,unsigned budget){
+	unsigned n = 0;
+
+	engine_frame_start(c8);
+	if(probe.stage == STAGE_PRESENT)
+		return engine_frame_finish(c8,0,budget);
+
+	while(engine_frame_left(c8,n,budget)){
+		unsigned pc = c8->registers.PC;
+		unsigned opcode = c8->memory[pc] << 8 | c8->memory[(pc + 1) & 0xFFF];
+		unsigned X = (opcode >> 8) & 0xF;
+		uint64_t hash = 0;
+
+		if(probe.stage == STAGE_OBSERVE){
+			if((((opcode & 0xF0FF) == 0xE09E || (opcode & 0xF0FF) == 0xE0A1) &&
+			    (c8->registers.V[X] & 0xF) == probe.key) ||
+			   ((opcode & 0xF0FF) == 0xF00A && c8->keypad[probe.key])){
+				probe.observe_time = metrics_now();
+				probe.stage = STAGE_DRAW;
+			}
+		}
+
+		bool draws = (opcode & 0xF000) == 0xD000 || opcode == 0x00E0;
+		if(probe.stage == STAGE_DRAW && draws)
+			hash = chip8_display_hash(c8);
+
+		bool end_frame = engine_frame_step(c8);
+		n++;
+
+		if(probe.stage == STAGE_DRAW && draws && chip8_display_hash(c8) != hash){
+			probe.draw_time = metrics_now();
+			probe.stage = STAGE_PRESENT;
+			// Nothing left to look at in the instructions,finish the frame at full speed
+			if(!end_frame && engine_frame_left(c8,n,budget))
+				n += engine_frame_finish(c8,n,budget);
+			break;
+		}
+
+		if(end_frame)
+			break;
+	}
+
+	return n;
+}
+
+// A frame was shown at `now`
+void latency_present(uint64_t now,uint64_t frame){
+	if(!latency_probing)
+		return;
+
+	if(probe.stage == STAGE_PRESENT){
+		histogram_add(&key_to_observe,probe.observe_time - probe.key_time);
+		histogram_add(&observe_to_draw,probe.draw_time - probe.observe_time);
+		histogram_add(&draw_to_present,now - probe.draw_time);
+		histogram_add(&key_to_present,now - probe.key_time);
+		histogram_add(&frames,frame - probe.key_frame);
+		latency_probing = false;
+	}else if(frame - probe.key_frame > PROBE_TIMEOUT){
+		lost++;
+		latency_probing = false;
+	}
+}
+
+/* Headless presses for the harness: every 30 frames a key goes down for 8 frames,starting with 1 
+ * (the first test in ROMs/6-keypad.ch8's menu) and going round the keypad. Returns the key that 
+ * just went down or -1.*/
+int latency_scripted_input(unsigned frame,bool keypad[16]){
+	unsigned press = frame / 30,in = frame % 30;
+	int key = (press + 1) & 0xF;
+
+	for(int i = 0;i < 16;i++)
+		keypad[i] = false;
+	if(in < 8)
+		keypad[key] = true;
+
+	return in == 0 ? key : -1;
+}
+
+static void report_histogram(FILE *out,const char *name,const struct Histogram *h,double scale,
+			     const char *unit){
+	fprintf(out,"%-24s p50 %8.3f  p99 %8.3f  max %8.3f %s\n",name,histogram_percentile(h,50) / scale,
+		histogram_percentile(h,99) / scale,h->max / scale,unit);
+}
+
+void latency_report(FILE *out){
+	fprintf(out,"Input latency over %llu key presses (%u never shown):\n",
+		(unsigned long long) key_to_present.total,lost);
+	report_histogram(out,"key -> observe",&key_to_observe,1e6,"ms");
+	report_histogram(out,"observe -> draw",&observe_to_draw,1e6,"ms");
+	report_histogram(out,"draw -> present",&draw_to_present,1e6,"ms");
+	report_histogram(out,"key -> present",&key_to_present,1e6,"ms");
+	report_histogram(out,"key -> present (frames)",&frames,1,"frames");
+}
@@ -0,0 +1,17 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include<stdio.h>
+
+#include"chip_8.h"
+
+extern bool latency_enabled;
+extern bool latency_probing;
+
+void latency_key(int key,uint64_t now,uint64_t frame);
+unsigned latency_run(struct Chip8 *c8,unsigned budget);
+void latency_present(uint64_t now,uint64_t frame);
+int latency_scripted_input(unsigned frame,bool keypad[16]);
+void latency_report(FILE *out);
+
+#endif
@@ -0,0 +1,443 @@
+#include<SDL3/SDL.h>
+#include<dirent.h>
+#include<errno.h>
+#include<limits.h>
+#include<pthread.h>
+#include<stdatomic.h>
+#include<stdbool.h>
+#include<stdint.h>
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<sys/stat.h>
+#include<unistd.h>
+
+#include"chip_8.h"
+#include"display.h"
+#include"launcher.h"
+#include"rom.h"
+#include"romdb.h"
+#include"sha1.h"
+#include"zip.h"
+
+/* The launcher: what runs without a ROM on the command line. Lists every ROM in ROMs/ and in the zip
+ * archives there,each with a thumbnail: a few frames of the ROM running on its own for a few 
+ * seconds (with scripted input so it gets past the title screen),played in a loop.
+ *
+ * The thumbnails are made by worker threads and kept in a cache on disk,keyed by the SHA-1 of the
+ * ROM and the profile and speed it ran with,so after the first start they're read instead of made.
+ * The UI thread never waits for them: a ROM without its thumbnail yet is drawn as a blank tile 
+ * until a worker sets its `ready`.*/
+
+extern unsigned instructions_per_frame;
+
+#define THUMB_FRAMES 8
+#define THUMB_EVERY 24 // emulated frames between thumbnail frames,i.e. 3.2 seconds in all
+#define THUMB_BYTES (DISPLAY_WIDTH / 8 * DISPLAY_HEIGHT) // a frame,a bit per pixel
+#define THUMB_MAGIC "C8T1" // bump when the way thumbnails are made changes
+
+#define ATLAS_COLUMNS 16
+#define TILE_SCALE 3
+#define CELL_W (DISPLAY_WIDTH * TILE_SCALE + 16)
+#define CELL_H (DISPLAY_HEIGHT * TILE_SCALE + 26)
+#define PENDING_COLOR 0x202020
+
+struct LauncherRom{
+	char path[PATH_MAX]; // for load_ROM()
+	char name[64];
+	uint8_t rom[0x1000 - 0x200];
+	size_t len;
+	uint8_t sha1[20];
+	const struct Quirks *quirks;
+	unsigned speed;
+	uint8_t thumb[THUMB_FRAMES][THUMB_BYTES];
+	atomic_bool ready;
+};
+
+static struct{
+	struct LauncherRom *roms;
+	unsigned count;
+	char cache[PATH_MAX]; // directory,empty if there's none
+	atomic_uint next; // the next ROM a worker makes a thumbnail for
+	atomic_uint done;
+	atomic_bool stop;
+	pthread_t workers[8];
+	int worker_count;
+	char chosen[PATH_MAX];
+} launcher;
+
+const char *launcher_run(struct Game *g,const char *dir);
+
+static int compare_names(const void *a,const void *b){
+	return strcmp(((const struct LauncherRom *) a)->name,((const struct LauncherRom *) b)->name);
+}
+
+// Reads the ROM and looks it up in the ROM database,from the UI thread before the workers start
+static void add(const char *path,const char *name){
+	if(launcher.count == LAUNCHER_MAX)
+		return;
+
+	struct LauncherRom *r = &launcher.roms[launcher.count];
+	if(!rom_read(path,r->rom,sizeof(r->rom),&r->len) || r->len == 0)
+		return;
+	snprintf(r->path,sizeof(r->path),"%s",path);
+	snprintf(r->name,sizeof(r->name),"%s",name);
+	sha1(r->rom,r->len,r->sha1);
+
+	const struct RomInfo *info = romdb_find(r->sha1);
+	r->quirks = info ? &quirk_profiles[info->quirks] : quirks;
+	r->speed = info ? info->speed : instructions_per_frame;
+	atomic_init(&r->ready,false);
+	launcher.count++;
+}
+
+static void list(const char *dir){
+	DIR *d = opendir(dir);
+	struct dirent *e;
+	char path[PATH_MAX];
+
+	if(d == NULL){
+		if(debug_flag)
+			fprintf(stderr,"Couldn't open %s: %s\n",dir,strerror(errno));
+		return;
+	}
+
+	while((e = readdir(d)) != NULL){
+		struct stat st;
+		if(e->d_name[0] == '.')
+			continue;
+		if(snprintf(path,sizeof(path),"%s/%s",dir,e->d_name) >= (int) sizeof(path)){
+			fprintf(stderr,"Skipping %s/%s: the path is too long\n",dir,e->d_name);
+			continue;
+		}
+		if(stat(path,&st) < 0 || !S_ISREG(st.st_mode))
+			continue;
+
+		size_t n = strlen(e->d_name);
+		if(n < 4 || strcmp(e->d_name + n - 4,".zip") != 0){
+			if(st.st_size <= 0x1000 - 0x200)
+				add(path,e->d_name);
+			continue;
+		}
+
+		struct Zip *zip = zip_open(path);
+		if(zip == NULL)
+			continue;
+		for(unsigned i = 0;i < zip->count;i++){
+			const struct ZipEntry *z = &zip->entries[i];
+			char entry[PATH_MAX],name[64];
+			if(z->size == 0 || z->size > 0x1000 - 0x200 || z->name[z->name_len - 1] == '/')
+				continue;
+			if(snprintf(entry,sizeof(entry),"%s:%.*s",path,z->name_len,z->name) >= (int) sizeof(entry)){
+				fprintf(stderr,"Skipping %s:%.*s: the path is too long\n",path,z->name_len,z->name);
+				continue;
+			}
+			snprintf(name,sizeof(name),"%.*s",z->name_len,z->name);
+			add(entry,name);
+		}
+		zip_close(zip);
+	}
+	closedir(d);
+
+	qsort(launcher.roms,launcher.count,sizeof(*launcher.roms),compare_names);
+}
+
+// $XDG_CACHE_HOME/chip_8 or ~/.cache/chip_8
+static void cache_dir(void){
+	const char *xdg = getenv("XDG_CACHE_HOME"),*home = getenv("HOME");
+	char base[PATH_MAX];
+
+	launcher.cache[0] = 0;
+	if(xdg && *xdg)
+		snprintf(base,sizeof(base),"%s",xdg);
+	else if(home && *home)
+		snprintf(base,sizeof(base),"%s/.cache",home);
+	else
+		return;
+
+	mkdir(base,0755);
+	if(snprintf(launcher.cache,sizeof(launcher.cache),"%s/chip_8",base) >= (int) sizeof(launcher.cache)){
+		fprintf(stderr,"No thumbnail cache: %s is too long a path\n",base);
+		launcher.cache[0] = 0;
+		return;
+	}
+	if(mkdir(launcher.cache,0755) < 0 && errno != EEXIST){
+		if(debug_flag)
+			fprintf(stderr,"No thumbnail cache in %s: %s\n",launcher.cache,strerror(errno));
+		launcher.cache[0] = 0;
+	}
+}
+
+// The same ROM run with another profile or speed makes another thumbnail,so both go in the name
+static bool cache_path(const struct LauncherRom *r,char *path,size_t len){
+	char hex[41];
+	sha1_hex(r->sha1,hex);
+	return snprintf(path,len,"%s/%s-%s-%u.thumb",launcher.cache,hex,r->quirks->name,r->speed) < (int) len;
+}
+
+static bool cache_read(struct LauncherRom *r){
+	char path[PATH_MAX],magic[4];
+
+	if(launcher.cache[0] == 0 || !cache_path(r,path,sizeof(path)))
+		return false;
+	FILE *f = fopen(path,"rb");
+	if(f == NULL)
+		return false;
+	bool ok = fread(magic,sizeof(magic),1,f) == 1 && memcmp(magic,THUMB_MAGIC,4) == 0 &&
+		  fread(r->thumb,sizeof(r->thumb),1,f) == 1;
+	fclose(f);
+	return ok;
+}
+
+// Written next to where it goes and renamed,so a reader never sees half of it
+static void cache_write(const struct LauncherRom *r){
+	char path[PATH_MAX],tmp[PATH_MAX + 16];
+
+	if(launcher.cache[0] == 0 || !cache_path(r,path,sizeof(path)))
+		return;
+	snprintf(tmp,sizeof(tmp),"%s.%d",path,(int) getpid());
+	FILE *f = fopen(tmp,"wb");
+	if(f == NULL)
+		return;
+	bool ok = fwrite(THUMB_MAGIC,4,1,f) == 1 && fwrite(r->thumb,sizeof(r->thumb),1,f) == 1;
+	if(fclose(f) == 0 && ok)
+		rename(tmp,path);
+	else
+		unlink(tmp);
+}
+
+static void make_thumbnail(struct LauncherRom *r){
+	struct Chip8 c8;
+
+	chip8_init(&c8,1);
+	memcpy(&c8.memory[0x200],r->rom,r->len);
+	chip8_wrote(&c8,0x200,r->len);
+	for(unsigned frame = 1;frame <= THUMB_FRAMES * THUMB_EVERY;frame++){
+		chip8_scripted_input(1,frame,c8.keypad);
+		r->quirks->run(&c8,r->speed);
+		chip8_tick_timers(&c8);
+		if(frame % THUMB_EVERY)
+			continue;
+
+		uint8_t *out = r->thumb[frame / THUMB_EVERY - 1];
+		for(int y = 0;y < DISPLAY_HEIGHT;y++)
+			for(int x = 0;x < DISPLAY_WIDTH;x += 8){
+				uint8_t bits = 0;
+				for(int b = 0;b < 8;b++)
+					bits = bits << 1 | c8.display[y][x + b];
+				*out++ = bits;
+			}
+	}
+}
+
+static void *thumbnail_worker(void *arg){
+	(void) arg;
+	unsigned i;
+
+	while(!atomic_load(&launcher.stop) && (i = atomic_fetch_add(&launcher.next,1)) < launcher.count){
+		struct LauncherRom *r = &launcher.roms[i];
+		if(!cache_read(r)){
+			make_thumbnail(r);
+			cache_write(r);
+		}
+		atomic_store_explicit(&r->ready,true,memory_order_release);
+		atomic_fetch_add(&launcher.done,1);
+	}
+	return NULL;
+}
+
+// Frame `frame` of every thumbnail that's ready into the atlas,ATLAS_COLUMNS to a row
+static void fill_atlas(SDL_Texture *atlas,unsigned frame){
+	void *pixels;
+	int pitch;
+
+	if(!SDL_LockTexture(atlas,NULL,&pixels,&pitch))
+		return;
+	for(unsigned i = 0;i < launcher.count;i++){
+		const struct LauncherRom *r = &launcher.roms[i];
+		bool ready = atomic_load_explicit(&r->ready,memory_order_acquire);
+		const uint8_t *bits = r->thumb[frame % THUMB_FRAMES];
+		uint8_t *tile = (uint8_t *) pixels + (size_t) (i / ATLAS_COLUMNS) * DISPLAY_HEIGHT * pitch +
+				i % ATLAS_COLUMNS * DISPLAY_WIDTH * 4;
+
+		for(int y = 0;y < DISPLAY_HEIGHT;y++){
+			uint32_t *row = (uint32_t *) (tile + (size_t) y * pitch);
+			for(int x = 0;x < DISPLAY_WIDTH;x++)
+				row[x] = !ready ? PENDING_COLOR : bits[y * 8 + x / 8] >> (7 - x % 8) & 1 ? 0xFFFFFF : 0;
+		}
+	}
+	SDL_UnlockTexture(atlas);
+}
+
+static void render(struct Game *g,SDL_Texture *atlas,unsigned selected,unsigned top,unsigned columns,
+		   unsigned rows){
+	SDL_SetRenderDrawColor(g->renderer,0,0,0,255);
+	SDL_RenderClear(g->renderer);
+
+	for(unsigned i = top * columns;i < launcher.count && i < (top + rows) * columns;i++){
+		float x = (i % columns) * CELL_W + 8,y = (i / columns - top) * CELL_H + 8;
+		SDL_FRect src = {i % ATLAS_COLUMNS * DISPLAY_WIDTH,i / ATLAS_COLUMNS * DISPLAY_HEIGHT,
+				 DISPLAY_WIDTH,DISPLAY_HEIGHT};
+		SDL_FRect dst = {x,y,DISPLAY_WIDTH * TILE_SCALE,DISPLAY_HEIGHT * TILE_SCALE};
+		SDL_RenderTexture(g->renderer,atlas,&src,&dst);
+
+		char name[DISPLAY_WIDTH * TILE_SCALE / 8 + 1];
+		snprintf(name,sizeof(name),"%.*s",(int) sizeof(name) - 1,launcher.roms[i].name);
+		if(i == selected){
+			SDL_FRect outline = {x - 3,y - 3,dst.w + 6,dst.h + 6};
+			SDL_SetRenderDrawColor(g->renderer,255,176,0,255);
+			SDL_RenderRect(g->renderer,&outline);
+		}else{
+			SDL_SetRenderDrawColor(g->renderer,160,160,160,255);
+		}
+		SDL_RenderDebugText(g->renderer,x,y + dst.h + 6,name);
+	}
+
+	SDL_RenderPresent(g->renderer);
+}
+
+static void set_title(struct Game *g,unsigned selected){
+	char title[256];
+	const struct RomInfo *info = romdb_find(launcher.roms[selected].sha1);
+	unsigned done = atomic_load(&launcher.done);
+
+	snprintf(title,sizeof(title),"%u ROMs - %s%s%s%s",launcher.count,launcher.roms[selected].name,
+		 info ? " (" : "",info ? info->title : "",info ? ")" : "");
+	if(done < launcher.count)
+		snprintf(title + strlen(title),sizeof(title) - strlen(title)," - thumbnails %u/%u",done,
+			 launcher.count);
+	SDL_SetWindowTitle(g->window,title);
+}
+
+// The cell under a point in window coordinates,or -1
+static int cell_at(struct Game *g,float wx,float wy,unsigned top,unsigned columns){
+	float x,y;
+
+	if(!SDL_RenderCoordinatesFromWindow(g->renderer,wx,wy,&x,&y) || x < 0 || y < 0)
+		return -1;
+	unsigned column = x / CELL_W,i = (top + (unsigned) (y / CELL_H)) * columns + column;
+	return column < columns && i < launcher.count ? (int) i : -1;
+}
+
+static void launcher_free(void){
+	atomic_store(&launcher.stop,true);
+	for(int i = 0;i < launcher.worker_count;i++)
+		pthread_join(launcher.workers[i],NULL);
+	free(launcher.roms);
+	launcher.roms = NULL;
+	launcher.count = 0;
+	launcher.worker_count = 0;
+}
+
+/* Shows the ROMs in `dir` until one is picked (arrow keys and Enter,or a click) and returns its 
+ * path,NULL if the window was closed.*/
+const char *launcher_run(struct Game *g,const char *dir){
+	const Uint64 frame_ns = SDL_NS_PER_SECOND / 60;
+	const char *chosen = NULL;
+
+	if((launcher.roms = calloc(LAUNCHER_MAX,sizeof(*launcher.roms))) == NULL){
+		if(debug_flag)
+			fprintf(stderr,"Error while allocating memory\n");
+		return NULL;
+	}
+	list(dir);
+	if(launcher.count == 0){
+		fprintf(stderr,"No ROMs in %s\n",dir);
+		launcher_free();
+		return NULL;
+	}
+	cache_dir();
+
+	SDL_Texture *atlas = SDL_CreateTexture(g->renderer,SDL_PIXELFORMAT_XRGB8888,SDL_TEXTUREACCESS_STREAMING,
+					       ATLAS_COLUMNS * DISPLAY_WIDTH,
+					       (launcher.count + ATLAS_COLUMNS - 1) / ATLAS_COLUMNS * DISPLAY_HEIGHT);
+	if(atlas == NULL){
+		if(debug_flag)
+			fprintf(stderr,"Error creating the launcher texture: %s\n",SDL_GetError());
+		launcher_free();
+		return NULL;
+	}
+	SDL_SetTextureScaleMode(atlas,SDL_SCALEMODE_NEAREST);
+
+	atomic_store(&launcher.next,0);
+	atomic_store(&launcher.done,0);
+	atomic_store(&launcher.stop,false);
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	int workers = cores < 1 ? 1 : cores > 8 ? 8 : cores;
+	for(int i = 0;i < workers;i++)
+		if(pthread_create(&launcher.workers[launcher.worker_count],NULL,thumbnail_worker,NULL) == 0)
+			launcher.worker_count++;
+	if(launcher.worker_count == 0) // thumbnails are nice to have,not worth giving up over
+		fprintf(stderr,"No threads for the thumbnails\n");
+
+	unsigned selected = 0,top = 0,shown_done = -1,titled = -1;
+	Uint64 next = SDL_GetTicksNS();
+	for(unsigned frame = 0;g->is_running && chosen == NULL;frame++){
+		int w,h;
+		if(!SDL_GetCurrentRenderOutputSize(g->renderer,&w,&h))
+			w = CELL_W * 6,h = CELL_H * 5;
+		unsigned columns = w / CELL_W ? w / CELL_W : 1,rows = h / CELL_H ? h / CELL_H : 1;
+
+		while(SDL_PollEvent(&g->event)){
+			switch(g->event.type){
+				case SDL_EVENT_QUIT:
+					g->is_running = false;
+					break;
+				case SDL_EVENT_MOUSE_BUTTON_DOWN:{
+					int i = cell_at(g,g->event.button.x,g->event.button.y,top,columns);
+					if(i >= 0)
+						chosen = launcher.roms[selected = i].path;
+					break;
+				}
+				case SDL_EVENT_KEY_DOWN:
+					switch(g->event.key.scancode){
+						case SDL_SCANCODE_ESCAPE: g->is_running = false; break;
+						case SDL_SCANCODE_LEFT: selected -= selected > 0; break;
+						case SDL_SCANCODE_RIGHT: selected += selected + 1 < launcher.count; break;
+						case SDL_SCANCODE_UP: selected -= selected >= columns ? columns : 0; break;
+						case SDL_SCANCODE_DOWN:
+							selected += selected + columns < launcher.count ? columns : 0;
+							break;
+						case SDL_SCANCODE_RETURN:
+						case SDL_SCANCODE_SPACE:
+							chosen = launcher.roms[selected].path;
+							break;
+						default: break;
+					}
+					break;
+			}
+		}
+
+		// Keep the selection in view
+		if(selected / columns < top)
+			top = selected / columns;
+		if(selected / columns >= top + rows)
+			top = selected / columns - rows + 1;
+
+		unsigned done = atomic_load(&launcher.done);
+		if(frame % (60 / THUMB_FRAMES) == 0 || done != shown_done){
+			fill_atlas(atlas,frame / (60 / THUMB_FRAMES));
+			shown_done = done;
+		}
+		if(titled != selected + done * LAUNCHER_MAX){
+			set_title(g,selected);
+			titled = selected + done * LAUNCHER_MAX;
+		}
+		render(g,atlas,selected,top,columns,rows);
+
+		next += frame_ns;
+		Uint64 now = SDL_GetTicksNS();
+		if(now < next)
+			SDL_DelayNS(next - now);
+		else
+			next = now;
+	}
+
+	if(chosen){
+		snprintf(launcher.chosen,sizeof(launcher.chosen),"%s",chosen);
+		chosen = launcher.chosen;
+	}
+	SDL_DestroyTexture(atlas);
+	launcher_free();
+	return chosen;
+}
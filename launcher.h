@@ -0,0 +1,11 @@
+#ifndef LAUNCHER_H
+#define LAUNCHER_H
+
+#include"display.h"
+
+#define LAUNCHER_DIR "ROMs"
+#define LAUNCHER_MAX 1024
+
+const char *launcher_run(struct Game *g,const char *dir);
+
+#endif
@@ -0,0 +1,158 @@
+#include<stdbool.h>
+#include<stdint.h>
+#include<stdio.h>
+#include<time.h>
+
+#include"metrics.h"
+
+/* Runtime metrics: how long the host takes per frame and where the time goes (polling events,
+ * emulating,rendering),how many frames were late and how fast the emulated CPU effectively ran. 
+ * The frame loop feeds it a handful of timestamps per frame.
+ *
+ * Times go into HDR style histograms: 32 linear buckets per power of two nanoseconds,so adding a
+ * value is a couple of shifts and the percentiles are good to ~3% from nanoseconds to minutes.*/
+
+struct Metrics metrics;
+
+uint64_t metrics_now(void);
+void histogram_add(struct Histogram *h,uint64_t value);
+uint64_t histogram_percentile(const struct Histogram *h,double percentile);
+void metrics_frame(unsigned instructions,uint64_t start,uint64_t poll,uint64_t emulate,
+		   uint64_t render);
+bool metrics_summary(char *out,size_t len);
+bool metrics_dump(const char *path);
+
+uint64_t metrics_now(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline unsigned bucket_of(uint64_t value){
+	if(value < (1u << HISTOGRAM_SUB_BITS))
+		return value;
+
+	unsigned exponent = 63 - __builtin_clzll(value);
+	unsigned bucket = ((exponent - HISTOGRAM_SUB_BITS + 1) << HISTOGRAM_SUB_BITS) |
+			  ((value >> (exponent - HISTOGRAM_SUB_BITS)) & ((1u << HISTOGRAM_SUB_BITS) - 1));
+
+	return bucket < HISTOGRAM_BUCKETS ? bucket : HISTOGRAM_BUCKETS - 1;
+}
+
+// The largest value that lands in `bucket`
+static uint64_t bucket_top(unsigned bucket){
+	if(bucket < (1u << HISTOGRAM_SUB_BITS))
+		return bucket;
+
+	unsigned exponent = (bucket >> HISTOGRAM_SUB_BITS) + HISTOGRAM_SUB_BITS - 1;
+	uint64_t sub = bucket & ((1u << HISTOGRAM_SUB_BITS) - 1);
+	uint64_t width = 1ULL << (exponent - HISTOGRAM_SUB_BITS);
+
+	return ((1ULL << exponent) | (sub << (exponent - HISTOGRAM_SUB_BITS))) + width - 1;
+}
+
+void histogram_add(struct Histogram *h,uint64_t value){
+	h->counts[bucket_of(value)]++;
+	h->total++;
+	h->sum += value;
+	if(value > h->max)
+		h->max = value;
+}
+
+// e.g. 99.9 for p999
+uint64_t histogram_percentile(const struct Histogram *h,double percentile){
+	uint64_t rank = (uint64_t) (h->total * percentile / 100.0 + 0.5);
+	uint64_t seen = 0;
+
+	if(h->total == 0)
+		return 0;
+	if(rank == 0)
+		rank = 1;
+
+	for(unsigned i = 0;i < HISTOGRAM_BUCKETS;i++){
+		seen += h->counts[i];
+		if(seen >= rank)
+			return bucket_top(i) < h->max ? bucket_top(i) : h->max;
+	}
+
+	return h->max;
+}
+
+/* One frame: instructions it ran,when it started and how long each part of it took (ns).*/
+void metrics_frame(unsigned instructions,uint64_t start,uint64_t poll,uint64_t emulate,
+		   uint64_t render){
+	if(metrics.frames == 0)
+		metrics.start = metrics.summary_time = start;
+	else
+		histogram_add(&metrics.frame_time,start - metrics.last_frame);
+
+	metrics.last_frame = start;
+	metrics.frames++;
+	metrics.instructions += instructions;
+	histogram_add(&metrics.poll_time,poll);
+	histogram_add(&metrics.emulate_time,emulate);
+	histogram_add(&metrics.render_time,render);
+}
+
+/* One line for the window title, made at most once a second (returns false in between).*/
+bool metrics_summary(char *out,size_t len){
+	uint64_t now = metrics_now();
+	uint64_t elapsed = now - metrics.summary_time;
+
+	if(elapsed < 1000000000ULL)
+		return false;
+
+	double seconds = elapsed / 1e9;
+	snprintf(out,len,"CHIP-8 | %.1f fps | %.0f Hz | frame p50 %.2f p99 %.2f p999 %.2f ms | late %llu",
+		 (metrics.frames - metrics.summary_frames) / seconds,
+		 (metrics.instructions - metrics.summary_instructions) / seconds,
+		 histogram_percentile(&metrics.frame_time,50) / 1e6,
+		 histogram_percentile(&metrics.frame_time,99) / 1e6,
+		 histogram_percentile(&metrics.frame_time,99.9) / 1e6,
+		 (unsigned long long) metrics.late_frames);
+
+	metrics.summary_time = now;
+	metrics.summary_frames = metrics.frames;
+	metrics.summary_instructions = metrics.instructions;
+	return true;
+}
+
+static void dump_histogram(FILE *out,const char *name,const struct Histogram *h){
+	fprintf(out,"%s_ns count %llu mean %llu p50 %llu p99 %llu p999 %llu max %llu\n",name,
+		(unsigned long long) h->total,
+		(unsigned long long) (h->total ? h->sum / h->total : 0),
+		(unsigned long long) histogram_percentile(h,50),
+		(unsigned long long) histogram_percentile(h,99),
+		(unsigned long long) histogram_percentile(h,99.9),
+		(unsigned long long) h->max);
+}
+
+// "name value..." lines,"-" is stderr
+bool metrics_dump(const char *path){
+	FILE *out = path[0] == '-' && path[1] == 0 ? stderr : fopen(path,"w");
+	if(out == NULL){
+		perror(path);
+		return false;
+	}
+
+	double seconds = (metrics_now() - metrics.start) / 1e9;
+
+	fprintf(out,"seconds %.3f\n",seconds);
+	fprintf(out,"frames %llu\n",(unsigned long long) metrics.frames);
+	fprintf(out,"late_frames %llu\n",(unsigned long long) metrics.late_frames);
+	fprintf(out,"instructions %llu\n",(unsigned long long) metrics.instructions);
+	fprintf(out,"instructions_per_frame %.2f\n",
+		metrics.frames ? (double) metrics.instructions / metrics.frames : 0.0);
+	fprintf(out,"fps %.2f\n",seconds > 0 ? metrics.frames / seconds : 0.0);
+	fprintf(out,"effective_hz %.0f\n",seconds > 0 ? metrics.instructions / seconds : 0.0);
+	dump_histogram(out,"frame_time",&metrics.frame_time);
+	dump_histogram(out,"poll_time",&metrics.poll_time);
+	dump_histogram(out,"emulate_time",&metrics.emulate_time);
+	dump_histogram(out,"render_time",&metrics.render_time);
+	if(metrics.run_ahead_time.total)
+		dump_histogram(out,"run_ahead_time",&metrics.run_ahead_time);
+
+	if(out != stderr)
+		fclose(out);
+	return true;
+}
@@ -0,0 +1,49 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include<stdbool.h>
+#include<stddef.h>
+#include<stdint.h>
+
+// Log-linear buckets: 32 per power of two, i.e. values are kept to within ~3%
+#define HISTOGRAM_SUB_BITS 5
+#define HISTOGRAM_BUCKETS ((41 - HISTOGRAM_SUB_BITS) << HISTOGRAM_SUB_BITS)
+
+struct Histogram{
+	uint64_t counts[HISTOGRAM_BUCKETS];
+	uint64_t total;
+	uint64_t sum;
+	uint64_t max;
+};
+
+struct Metrics{
+	bool enabled;
+	uint64_t start;
+	uint64_t frames;
+	uint64_t instructions;
+	uint64_t late_frames; // frames that didn't make their 60Hz deadline
+	struct Histogram frame_time; // host time from one frame to the next
+	struct Histogram emulate_time;
+	struct Histogram render_time;
+	struct Histogram poll_time;
+	struct Histogram run_ahead_time; // snapshot and speculative frames,when running ahead
+
+	uint64_t last_frame;
+
+	// For the live summary,since it was last made
+	uint64_t summary_time;
+	uint64_t summary_frames;
+	uint64_t summary_instructions;
+};
+
+extern struct Metrics metrics;
+
+uint64_t metrics_now(void);
+void histogram_add(struct Histogram *h,uint64_t value);
+uint64_t histogram_percentile(const struct Histogram *h,double percentile);
+void metrics_frame(unsigned instructions,uint64_t start,uint64_t poll,uint64_t emulate,
+		   uint64_t render);
+bool metrics_summary(char *out,size_t len);
+bool metrics_dump(const char *path);
+
+#endif
@@ -0,0 +1,418 @@
+#include<arpa/inet.h>
+#include<errno.h>
+#include<fcntl.h>
+#include<netdb.h>
+#include<netinet/in.h>
+#include<stdbool.h>
+#include<stdint.h>
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<sys/socket.h>
+#include<time.h>
+#include<unistd.h>
+
+#include"chip_8.h"
+#include"metrics.h"
+#include"netplay.h"
+
+/* Two player netplay with rollback. Both peers run the same deterministic machine and only send
+ * each other their keypad (a 16 bit mask per frame) over UDP,the machine sees both keypads ORed
+ * together.
+ *
+ * A frame never waits for the other peer's keys: they're predicted (the last keys that arrived 
+ * are assumed to still be held) and the machine is snapshotted at the start of every frame. When
+ * the real keys turn out different from the prediction the machine goes back to the snapshot of
+ * the first wrong frame and runs everything since again in one go. A peer that gets more than
+ * NET_MAX_AHEAD frames ahead of what it heard from the other one waits for it.
+ *
+ * Every packet carries the last NET_REDUNDANCY frames of keys the other peer hasn't acknowledged
+ * yet (so lost packets cost nothing) and a hash of the newest state both peers agree on,so a
+ * desync is caught straight away. --net-delay and --net-loss delay and drop outgoing packets to 
+ * try it on 127.0.0.1.*/
+
+#define NET_RING 64 // frames of snapshots and keys kept
+#define NET_MAX_AHEAD 12 // frames that can be predicted before waiting for the peer
+#define NET_REDUNDANCY 32
+#define NET_MAGIC 0x504E3843 // "C8NP"
+#define NET_QUEUE 256
+
+struct Packet{
+	uint32_t frame; // newest frame in `keys`
+	uint32_t ack; // the sender has the receiver's keys up to here (exclusive)
+	uint32_t synced_frame; // the state at the start of this frame is final on the sender...
+	uint64_t synced_hash; // ...and hashes to this
+	uint8_t count;
+	uint16_t keys[NET_REDUNDANCY]; // frames frame - count + 1 .. frame
+};
+
+static struct{
+	int fd;
+	struct sockaddr_in peer;
+	unsigned delay_ms;
+	unsigned loss_percent;
+	uint32_t rng;
+
+	uint32_t frame; // the next frame to run
+	uint32_t remote_known; // the peer's keys are known for frames below this
+	uint32_t peer_ack;
+	uint16_t local[NET_RING];
+	uint16_t remote[NET_RING];
+	uint16_t used[NET_RING]; // the remote keys the frame was actually run with
+	struct Chip8 snapshots[NET_RING]; // state at the start of each frame
+
+	// The newest agreed state the peer told us about
+	uint32_t peer_synced_frame;
+	uint64_t peer_synced_hash;
+	bool peer_synced_seen;
+	bool peer_synced_checked;
+
+	struct{
+		uint64_t due;
+		int len;
+		uint8_t data[128];
+	}queue[NET_QUEUE];
+	unsigned queue_head,queue_tail;
+
+	// Stats
+	uint64_t rollbacks,resimulated,stalls,sent,dropped,received,desyncs;
+	unsigned max_rollback;
+	struct Histogram rollback_time; // ns per rollback
+	struct Histogram resim_frame_time; // ns per re-simulated frame
+}net;
+
+bool netplay_active;
+
+bool netplay_open(const char *spec,unsigned delay_ms,unsigned loss_percent);
+unsigned netplay_frame(struct Chip8 *c8,unsigned budget,const bool local_keys[16]);
+int netplay_run_headless(struct Chip8 *c8,unsigned budget,unsigned frames,uint32_t input_seed);
+void netplay_report(FILE *out);
+
+// "LOCALPORT:HOST:PORT"
+bool netplay_open(const char *spec,unsigned delay_ms,unsigned loss_percent){
+	unsigned local_port,port;
+	char host[128];
+
+	if(sscanf(spec,"%u:%127[^:]:%u",&local_port,host,&port) != 3){
+		fprintf(stderr,"Expected LOCALPORT:HOST:PORT,got %s\n",spec);
+		return false;
+	}
+
+	struct addrinfo hints = {.ai_family = AF_INET,.ai_socktype = SOCK_DGRAM},*res;
+	if(getaddrinfo(host,NULL,&hints,&res) != 0){
+		fprintf(stderr,"Couldn't resolve %s\n",host);
+		return false;
+	}
+	net.peer = *(struct sockaddr_in *) res->ai_addr;
+	net.peer.sin_port = htons(port);
+	freeaddrinfo(res);
+
+	net.fd = socket(AF_INET,SOCK_DGRAM,0);
+	struct sockaddr_in local = {.sin_family = AF_INET,.sin_port = htons(local_port),
+				    .sin_addr.s_addr = htonl(INADDR_ANY)};
+	if(net.fd < 0 || bind(net.fd,(struct sockaddr *) &local,sizeof(local)) < 0){
+		perror("netplay");
+		return false;
+	}
+	fcntl(net.fd,F_SETFL,O_NONBLOCK);
+
+	net.delay_ms = delay_ms;
+	net.loss_percent = loss_percent;
+	net.rng = local_port;
+	netplay_active = true;
+	return true;
+}
+
+static uint16_t keys_mask(const bool keys[16]){
+	uint16_t mask = 0;
+	for(int i = 0;i < 16;i++)
+		mask |= keys[i] << i;
+	return mask;
+}
+
+// Everything that makes the machine what it is (a struct copy may not copy padding)
+static uint64_t state_hash(const struct Chip8 *c8){
+	uint64_t h = chip8_display_hash(c8);
+	const uint8_t *parts[] = {c8->memory,c8->registers.V,(const uint8_t *) c8->stack};
+	const size_t sizes[] = {sizeof(c8->memory),sizeof(c8->registers.V),sizeof(c8->stack)};
+	uint32_t extra[] = {c8->registers.I,c8->registers.PC,c8->sp,c8->delay_timer,c8->sound_timer,c8->rng};
+
+	for(int p = 0;p < 3;p++)
+		for(size_t i = 0;i < sizes[p];i++)
+			h = (h ^ parts[p][i]) * 0x100000001b3ULL;
+	for(int i = 0;i < 6;i++)
+		h = (h ^ extra[i]) * 0x100000001b3ULL;
+	return h;
+}
+
+static unsigned simulate(struct Chip8 *c8,unsigned budget,uint32_t frame,uint16_t remote){
+	uint16_t keys = net.local[frame % NET_RING] | remote;
+
+	net.snapshots[frame % NET_RING] = *c8;
+	net.used[frame % NET_RING] = remote;
+	for(int i = 0;i < 16;i++)
+		c8->keypad[i] = (keys >> i) & 1;
+	unsigned n = engine_frame(c8,budget);
+	engine_frame_end(c8);
+	return n;
+}
+
+static uint16_t remote_keys(uint32_t frame){
+	if(frame < net.remote_known)
+		return net.remote[frame % NET_RING];
+	return net.remote_known ? net.remote[(net.remote_known - 1) % NET_RING] : 0; // prediction
+}
+
+// The newest frame whose starting state can't change any more
+static uint32_t synced_frame(void){
+	return net.remote_known < net.frame ? net.remote_known : net.frame;
+}
+
+static bool synced_hash(const struct Chip8 *c8,uint32_t frame,uint64_t *hash){
+	if(frame > synced_frame() || net.frame - frame >= NET_RING)
+		return false;
+	*hash = frame == net.frame ? state_hash(c8) : state_hash(&net.snapshots[frame % NET_RING]);
+	return true;
+}
+
+// Little endian,so both ends agree whatever they run on
+static void put_le(uint8_t **p,uint64_t v,int n){
+	for(int i = 0;i < n;i++)
+		*(*p)++ = v >> (8 * i);
+}
+
+static uint64_t get_le(const uint8_t **p,int n){
+	uint64_t v = 0;
+	for(int i = 0;i < n;i++)
+		v |= (uint64_t) *(*p)++ << (8 * i);
+	return v;
+}
+
+static void flush_queue(bool all){
+	uint64_t now = metrics_now();
+
+	while(net.queue_tail != net.queue_head){
+		unsigned i = net.queue_tail % NET_QUEUE;
+		if(!all && net.queue[i].due > now)
+			break;
+		sendto(net.fd,net.queue[i].data,net.queue[i].len,0,(struct sockaddr *) &net.peer,sizeof(net.peer));
+		net.queue_tail++;
+	}
+}
+
+static void send_packet(const struct Chip8 *c8){
+	uint8_t buf[128],*p = buf;
+	uint32_t newest = net.frame - 1; // keys are known up to the last frame run
+	uint32_t first = net.peer_ack;
+	uint32_t synced = synced_frame();
+	uint64_t hash = 0;
+
+	if(net.frame == 0)
+		return;
+	if(newest + 1 - first > NET_REDUNDANCY)
+		first = newest + 1 - NET_REDUNDANCY;
+	synced_hash(c8,synced,&hash);
+
+	put_le(&p,NET_MAGIC,4);
+	put_le(&p,newest,4);
+	put_le(&p,net.remote_known,4);
+	put_le(&p,synced,4);
+	put_le(&p,hash,8);
+	put_le(&p,newest + 1 - first,1);
+	for(uint32_t f = first;f <= newest;f++)
+		put_le(&p,net.local[f % NET_RING],2);
+
+	net.sent++;
+	net.rng = chip8_mix(net.rng + 1);
+	if(net.rng % 100 < net.loss_percent){
+		net.dropped++;
+		return;
+	}
+
+	if(net.queue_head - net.queue_tail == NET_QUEUE)
+		flush_queue(true);
+	unsigned i = net.queue_head++ % NET_QUEUE;
+	net.queue[i].due = metrics_now() + net.delay_ms * 1000000ULL;
+	net.queue[i].len = p - buf;
+	memcpy(net.queue[i].data,buf,p - buf);
+	flush_queue(false);
+}
+
+static bool parse_packet(const uint8_t *buf,int len,struct Packet *pk){
+	const uint8_t *p = buf;
+	if(len < 25 || get_le(&p,4) != NET_MAGIC)
+		return false;
+	pk->frame = get_le(&p,4);
+	pk->ack = get_le(&p,4);
+	pk->synced_frame = get_le(&p,4);
+	pk->synced_hash = get_le(&p,8);
+	pk->count = get_le(&p,1);
+	if(pk->count > NET_REDUNDANCY || len < 25 + 2 * pk->count)
+		return false;
+	for(int i = 0;i < pk->count;i++)
+		pk->keys[i] = get_le(&p,2);
+	return true;
+}
+
+// Reads whatever arrived,returns the first frame that ran with the wrong remote keys (or net.frame)
+static uint32_t receive(void){
+	uint8_t buf[128];
+	uint32_t wrong = net.frame;
+	int len;
+
+	while((len = recv(net.fd,buf,sizeof(buf),0)) > 0){
+		struct Packet pk;
+		if(!parse_packet(buf,len,&pk))
+			continue;
+		net.received++;
+
+		if(pk.ack > net.peer_ack)
+			net.peer_ack = pk.ack;
+		if(pk.synced_frame > net.peer_synced_frame || !net.peer_synced_seen){
+			net.peer_synced_seen = true;
+			net.peer_synced_frame = pk.synced_frame;
+			net.peer_synced_hash = pk.synced_hash;
+			net.peer_synced_checked = false;
+		}
+
+		for(int i = 0;i < pk.count;i++){
+			uint32_t f = pk.frame - pk.count + 1 + i;
+			if(f != net.remote_known || f >= net.frame + NET_RING - NET_MAX_AHEAD)
+				continue; // already known,or after a gap
+
+			net.remote[f % NET_RING] = pk.keys[i];
+			net.remote_known++;
+			if(f < net.frame && net.used[f % NET_RING] != pk.keys[i] && f < wrong)
+				wrong = f;
+		}
+	}
+
+	return wrong;
+}
+
+static void rollback(struct Chip8 *c8,unsigned budget,uint32_t from){
+	uint64_t start = metrics_now();
+	unsigned frames = net.frame - from;
+
+	*c8 = net.snapshots[from % NET_RING];
+	for(uint32_t f = from;f < net.frame;f++)
+		simulate(c8,budget,f,remote_keys(f));
+
+	uint64_t took = metrics_now() - start;
+	histogram_add(&net.rollback_time,took);
+	histogram_add(&net.resim_frame_time,took / frames);
+	net.rollbacks++;
+	net.resimulated += frames;
+	if(frames > net.max_rollback)
+		net.max_rollback = frames;
+}
+
+static void check_desync(const struct Chip8 *c8){
+	uint64_t hash;
+
+	if(!net.peer_synced_seen || net.peer_synced_checked || !synced_hash(c8,net.peer_synced_frame,&hash))
+		return;
+
+	net.peer_synced_checked = true;
+	if(hash != net.peer_synced_hash){
+		if(net.desyncs++ == 0)
+			fprintf(stderr,"Netplay desync at frame %u\n",net.peer_synced_frame);
+	}
+}
+
+/* Runs the next frame with `local_keys` held here. Returns the instructions run,0 if it had to wait
+ * for the peer (c8 is unchanged then).*/
+unsigned netplay_frame(struct Chip8 *c8,unsigned budget,const bool local_keys[16]){
+	uint32_t wrong = receive();
+	flush_queue(false);
+
+	if(wrong < net.frame)
+		rollback(c8,budget,wrong);
+	check_desync(c8);
+
+	if(net.frame > net.remote_known && net.frame - net.remote_known >= NET_MAX_AHEAD){
+		net.stalls++;
+		send_packet(c8); // keep our keys flowing,the peer might be waiting on us too
+		return 0;
+	}
+
+	net.local[net.frame % NET_RING] = keys_mask(local_keys);
+	unsigned n = simulate(c8,budget,net.frame,remote_keys(net.frame));
+	net.frame++;
+	send_packet(c8);
+
+	return n ? n : 1;
+}
+
+/* Headless peer for testing: scripted keys for `frames` frames at 60Hz,then waits until the peer's
+ * keys for all of them arrived and prints the hash of the final state,which has to be the same on
+ * both peers.*/
+int netplay_run_headless(struct Chip8 *c8,unsigned budget,unsigned frames,uint32_t input_seed){
+	const uint64_t frame_ns = 1000000000ULL / 60;
+	uint64_t next = metrics_now(),deadline = 0;
+	unsigned frame = 0,waited = 0;
+	bool keys[16];
+
+	while(frame < frames || net.remote_known < net.frame){
+		if(frame < frames){
+			chip8_scripted_input(input_seed,frame,keys);
+			if(netplay_frame(c8,budget,keys)){
+				frame++;
+				waited = 0;
+			}else if(++waited == 600){
+				fprintf(stderr,"Netplay: no word from the peer for 10 seconds\n");
+				break;
+			}
+		}else{
+			// Done,just settle the frames that ran on predictions
+			uint32_t wrong = receive();
+			if(wrong < net.frame)
+				rollback(c8,budget,wrong);
+			check_desync(c8);
+			send_packet(c8);
+			flush_queue(false);
+
+			if(deadline == 0)
+				deadline = metrics_now() + 5000000000ULL;
+			if(metrics_now() > deadline){
+				fprintf(stderr,"Netplay: the peer went away\n");
+				break;
+			}
+		}
+
+		next += frame_ns;
+		uint64_t now = metrics_now();
+		if(now < next)
+			nanosleep(&(struct timespec){.tv_nsec = next - now},NULL);
+		else
+			next = now;
+	}
+
+	// Give the peer our last keys
+	for(int i = 0;i < 30;i++){
+		receive();
+		send_packet(c8);
+		flush_queue(false);
+		nanosleep(&(struct timespec){.tv_nsec = frame_ns},NULL);
+	}
+	flush_queue(true);
+
+	check_desync(c8);
+	netplay_report(stdout);
+	printf("final frame %u state %016llx\n",net.frame,(unsigned long long) state_hash(c8));
+	return net.desyncs ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+void netplay_report(FILE *out){
+	fprintf(out,"netplay: %u frames,%llu stalls,%llu packets sent (%llu dropped),%llu received,"
+		"%llu desyncs\n",net.frame,(unsigned long long) net.stalls,(unsigned long long) net.sent,
+		(unsigned long long) net.dropped,(unsigned long long) net.received,
+		(unsigned long long) net.desyncs);
+	fprintf(out,"rollbacks: %llu,%llu frames re-simulated,longest %u frames\n",
+		(unsigned long long) net.rollbacks,(unsigned long long) net.resimulated,net.max_rollback);
+	if(net.rollbacks)
+		fprintf(out,"rollback time: p50 %.1f p99 %.1f max %.1f us,per frame p50 %.2f us\n",
+			histogram_percentile(&net.rollback_time,50) / 1e3,
+			histogram_percentile(&net.rollback_time,99) / 1e3,net.rollback_time.max / 1e3,
+			histogram_percentile(&net.resim_frame_time,50) / 1e3);
+}
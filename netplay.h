@@ -0,0 +1,15 @@
+#ifndef NETPLAY_H
+#define NETPLAY_H
+
+#include<stdio.h>
+
+#include"chip_8.h"
+
+extern bool netplay_active;
+
+bool netplay_open(const char *spec,unsigned delay_ms,unsigned loss_percent);
+unsigned netplay_frame(struct Chip8 *c8,unsigned budget,const bool local_keys[16]);
+int netplay_run_headless(struct Chip8 *c8,unsigned budget,unsigned frames,uint32_t input_seed);
+void netplay_report(FILE *out);
+
+#endif
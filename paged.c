@@ -0,0 +1,237 @@
+#include<stdbool.h>
+#include<stdint.h>
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+
+#include"chip_8.h"
+#include"debug.h"
+#include"paged.h"
+
+/* Paged memory for running thousands of instances of one ROM. A struct Chip8 is ~6KB,4KB of it 
+ * memory that's mostly the font and the ROM and never written,2KB a display of bools. Here all the
+ * machines read the same image (a 4KB struct Chip8 memory,see paged_init()) through a table of 16
+ * page pointers and a page is copied into the machine's own (from a pool) on the first FX33/FX55
+ * that writes to it. The check on a store is one bit test. With the display a bit per pixel a 
+ * machine is ~450 bytes plus the pages it wrote to,usually one or two.
+ *
+ * The interpreters are interpreter.h's,stamped out per profile over this layout. They're also 
+ * registered as the "paged" engine,converting from and to a struct Chip8 around every call,so the
+ * differential tester checks it against the others.*/
+
+#define CHUNK_PAGES 1024
+
+void paged_init(struct PagedChip8 *m,const struct Chip8 *c8,uint8_t *image);
+void paged_export(const struct PagedChip8 *m,struct Chip8 *c8);
+void paged_release(struct PagedChip8 *m,struct PagePool *pool,uint8_t *image);
+unsigned paged_run(struct PagedChip8 *m,struct PagePool *pool,const struct Quirks *q,unsigned budget);
+void paged_pool_free(struct PagePool *pool);
+bool paged_engine_step(struct Chip8 *c8,const struct Quirks *q);
+unsigned paged_engine_run(struct Chip8 *c8,const struct Quirks *q,unsigned budget);
+
+static uint8_t *page_alloc(struct PagePool *pool){
+	uint8_t *page = pool->free_list;
+
+	if(page){
+		memcpy(&pool->free_list,page,sizeof(void *));
+	}else{
+		if(pool->chunk == NULL || pool->chunk_used == CHUNK_PAGES){
+			void **chunks = realloc(pool->chunks,(pool->chunk_count + 1) * sizeof(*chunks));
+			void *chunk = aligned_alloc(64,CHUNK_PAGES * PAGE_SIZE);
+			if(chunks == NULL || chunk == NULL){
+				fprintf(stderr,"Out of memory for pages\n");
+				exit(EXIT_FAILURE);
+			}
+			chunks[pool->chunk_count++] = chunk;
+			pool->chunks = chunks;
+			pool->chunk = chunk;
+			pool->chunk_used = 0;
+		}
+		page = pool->chunk[pool->chunk_used++];
+	}
+
+	pool->in_use++;
+	return page;
+}
+
+static void page_free(struct PagePool *pool,uint8_t *page){
+	memcpy(page,&pool->free_list,sizeof(void *));
+	pool->free_list = page;
+	pool->in_use--;
+}
+
+void paged_pool_free(struct PagePool *pool){
+	for(unsigned i = 0;i < pool->chunk_count;i++)
+		free(pool->chunks[i]);
+	free(pool->chunks);
+	memset(pool,0,sizeof(*pool));
+}
+
+/* `m` starts as `c8` with every page shared from `image`,which has to stay around (and unchanged)
+ * as long as any machine uses it. Normally it's c8->memory of the machine the others start from.*/
+void paged_init(struct PagedChip8 *m,const struct Chip8 *c8,uint8_t *image){
+	m->registers = c8->registers;
+	memcpy(m->stack,c8->stack,sizeof(m->stack));
+	m->sp = c8->sp;
+	m->delay_timer = c8->delay_timer;
+	m->sound_timer = c8->sound_timer;
+	memcpy(m->keypad,c8->keypad,sizeof(m->keypad));
+	m->rng = c8->rng;
+	m->own = 0;
+	for(int p = 0;p < PAGES;p++)
+		m->pages[p] = image + p * PAGE_SIZE;
+	for(int y = 0;y < DISPLAY_HEIGHT;y++){
+		uint64_t row = 0;
+		for(int x = 0;x < DISPLAY_WIDTH;x++)
+			row = row << 1 | c8->display[y][x];
+		m->display[y] = row;
+	}
+}
+
+// The whole machine into a struct Chip8,e.g. to hand it to the tools that work on those
+void paged_export(const struct PagedChip8 *m,struct Chip8 *c8){
+	c8->registers = m->registers;
+	for(int p = 0;p < PAGES;p++){
+		memcpy(c8->memory + p * PAGE_SIZE,m->pages[p],PAGE_SIZE);
+		if(m->own >> p & 1)
+			chip8_wrote(c8,p * PAGE_SIZE,PAGE_SIZE);
+	}
+	memcpy(c8->stack,m->stack,sizeof(c8->stack));
+	c8->sp = m->sp;
+	c8->delay_timer = m->delay_timer;
+	c8->sound_timer = m->sound_timer;
+	for(int y = 0;y < DISPLAY_HEIGHT;y++)
+		for(int x = 0;x < DISPLAY_WIDTH;x++)
+			c8->display[y][x] = m->display[y] >> (63 - x) & 1;
+	memcpy(c8->keypad,m->keypad,sizeof(c8->keypad));
+	c8->rng = m->rng;
+}
+
+// Gives the machine's own pages back to the pool,it reads `image` again
+void paged_release(struct PagedChip8 *m,struct PagePool *pool,uint8_t *image){
+	for(int p = 0;p < PAGES;p++)
+		if(m->own >> p & 1){
+			page_free(pool,m->pages[p]);
+			m->pages[p] = image + p * PAGE_SIZE;
+		}
+	m->own = 0;
+}
+
+static inline void store(struct PagedChip8 *m,struct PagePool *pool,unsigned addr,uint8_t v){
+	addr &= 0xFFF;
+	unsigned p = addr >> PAGE_BITS;
+
+	if(!(m->own >> p & 1)){ // first write: copy on write
+		uint8_t *page = page_alloc(pool);
+		memcpy(page,m->pages[p],PAGE_SIZE);
+		m->pages[p] = page;
+		m->own |= 1 << p;
+	}
+	m->pages[p][addr & (PAGE_SIZE - 1)] = v;
+}
+
+static inline uint8_t paged_rand(struct PagedChip8 *m){
+	uint32_t x = m->rng;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	m->rng = x;
+	return x >> 24;
+}
+
+// A row of the sprite is a shifted (or rotated,when wrapping) byte
+static inline bool paged_draw(struct PagedChip8 *m,const bool wrap,int x,int y,int n){
+	uint64_t collision = 0;
+
+	x %= DISPLAY_WIDTH;
+	y %= DISPLAY_HEIGHT;
+
+	for(int row = 0;row < n;row++){
+		int py = y + row;
+		if(py >= DISPLAY_HEIGHT && !wrap)
+			break;
+		py %= DISPLAY_HEIGHT;
+
+		uint64_t bits = (uint64_t) paged_load(m,m->registers.I + row) << 56;
+		if(wrap)
+			bits = x ? bits >> x | bits << (64 - x) : bits;
+		else
+			bits >>= x;
+
+		collision |= m->display[py] & bits;
+		m->display[py] ^= bits;
+	}
+
+	return collision != 0;
+}
+
+static inline uint16_t paged_fetch(struct PagedChip8 *m){
+	uint16_t pc = m->registers.PC;
+	m->registers.PC = (pc + 2) & 0xFFF;
+	return paged_load(m,pc) << 8 | paged_load(m,pc + 1);
+}
+
+// The interpreters over this layout,one per quirk profile
+#define INTERP_MACHINE struct PagedChip8
+#define INTERP_PREFIX paged_
+#define INTERP_PARAMS ,struct PagePool *pool
+#define INTERP_ARGS ,pool
+#define INTERP_FETCH(m) paged_fetch(m)
+#define INTERP_LOAD(m,addr) paged_load(m,addr)
+#define INTERP_STORE(m,addr,v) store(m,pool,addr,v)
+#define INTERP_WROTE(m,addr,len) ((void) 0) // paged_export() tells the struct Chip8
+#define INTERP_DUMP(m,from,to) ((void) 0) // no flat memory to print
+#define INTERP_CLEAR(m) memset((m)->display,0,sizeof((m)->display))
+#define INTERP_DRAW(m,x,y,n) paged_draw(m,false,x,y,n)
+#define INTERP_DRAW_WRAP(m,x,y,n) paged_draw(m,true,x,y,n)
+#define INTERP_RAND(m) paged_rand(m)
+#include"profiles.h"
+
+static const struct{
+	unsigned (*run)(struct PagedChip8 *m,unsigned budget,struct PagePool *pool);
+	bool (*execute)(const unsigned short opcode,struct PagedChip8 *m,struct PagePool *pool);
+}profiles[] = {
+	[QUIRKS_CHIP8] = {run_paged_chip8,execute_paged_chip8},
+	[QUIRKS_SCHIP] = {run_paged_schip,execute_paged_schip},
+	[QUIRKS_XOCHIP] = {run_paged_xochip,execute_paged_xochip}
+};
+
+// A frame: up to `budget` instructions,then the timers tick
+unsigned paged_run(struct PagedChip8 *m,struct PagePool *pool,const struct Quirks *q,unsigned budget){
+	unsigned n = profiles[q - quirk_profiles].run(m,budget,pool);
+
+	if(m->delay_timer > 0)
+		m->delay_timer--;
+	if(m->sound_timer > 0)
+		m->sound_timer--;
+	return n;
+}
+
+/* The engine interface,for the differential tester: into the paged layout and back around every
+ * call. Slow,the point is to check the paged interpreter and copy on write.*/
+static unsigned paged_engine(struct Chip8 *c8,const struct Quirks *q,unsigned budget,bool step){
+	struct PagedChip8 m;
+	struct PagePool pool = {0};
+	uint8_t image[0x1000];
+	unsigned n = 0;
+	bool end_frame = false;
+
+	memcpy(image,c8->memory,sizeof(image));
+	paged_init(&m,c8,image);
+	if(step)
+		end_frame = profiles[q - quirk_profiles].execute(paged_fetch(&m),&m,&pool);
+	else
+		n = profiles[q - quirk_profiles].run(&m,budget,&pool);
+	paged_export(&m,c8);
+	paged_pool_free(&pool);
+
+	return step ? end_frame : n;
+}
+
+bool paged_engine_step(struct Chip8 *c8,const struct Quirks *q){
+	return paged_engine(c8,q,1,true);
+}
+
+unsigned paged_engine_run(struct Chip8 *c8,const struct Quirks *q,unsigned budget){
+	return paged_engine(c8,q,budget,false);
+}
@@ -0,0 +1,52 @@
+#ifndef PAGED_H
+#define PAGED_H
+
+#include<stddef.h>
+#include<stdint.h>
+
+#include"chip_8.h"
+
+#define PAGE_BITS 8
+#define PAGE_SIZE (1 << PAGE_BITS)
+#define PAGES (0x1000 / PAGE_SIZE)
+
+// Where private pages come from,shared by all the machines of a run
+struct PagePool{
+	void *free_list; // released pages,linked through their first bytes
+	uint8_t (*chunk)[PAGE_SIZE]; // being handed out
+	unsigned chunk_used;
+	void **chunks; // everything allocated,for paged_pool_free()
+	unsigned chunk_count;
+	size_t in_use; // pages
+};
+
+/* A machine for runs of many instances: the same state as struct Chip8 but memory is a table of 
+ * 256 byte pages that point into a shared image (the font and the ROM) until the machine first 
+ * writes to them,and the display is a bit per pixel.*/
+struct PagedChip8{
+	_registers registers;
+	unsigned short stack[16];
+	int sp;
+	uint8_t delay_timer;
+	uint8_t sound_timer;
+	bool keypad[16];
+	uint32_t rng;
+	uint16_t own; // bit p: pages[p] is this machine's own copy
+	uint8_t *pages[PAGES];
+	uint64_t display[DISPLAY_HEIGHT]; // x = 0 is the top bit
+};
+
+void paged_init(struct PagedChip8 *m,const struct Chip8 *c8,uint8_t *image);
+void paged_export(const struct PagedChip8 *m,struct Chip8 *c8);
+void paged_release(struct PagedChip8 *m,struct PagePool *pool,uint8_t *image);
+unsigned paged_run(struct PagedChip8 *m,struct PagePool *pool,const struct Quirks *q,unsigned budget);
+void paged_pool_free(struct PagePool *pool);
+bool paged_engine_step(struct Chip8 *c8,const struct Quirks *q);
+unsigned paged_engine_run(struct Chip8 *c8,const struct Quirks *q,unsigned budget);
+
+static inline uint8_t paged_load(const struct PagedChip8 *m,unsigned addr){
+	addr &= 0xFFF;
+	return m->pages[addr >> PAGE_BITS][addr & (PAGE_SIZE - 1)];
+}
+
+#endif
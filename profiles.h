@@ -0,0 +1,51 @@
+/* profiles.h: the quirk profiles, interpreter.h stamped out once for each, see interpreter.h for
+ * what each quirk does.
+ *
+ * chip8:  the original COSMAC VIP interpreter
+ * schip:  SUPER-CHIP 1.1 (as it behaves on the HP48)
+ * xochip: XO-CHIP (Octo)
+ *
+ * There is deliberately no include guard either. It's included once per memory layout (chip_8.c 
+ * for struct Chip8, paged.c for struct PagedChip8) after defining the layout's INTERP_ macros,
+ * which are #undef'd at the bottom.
+ */
+#define INTERP_NAME chip8
+#define QUIRK_VF_RESET 1
+#define QUIRK_MEMORY 1
+#define QUIRK_SHIFT 0
+#define QUIRK_WRAP 0
+#define QUIRK_DISPLAY_WAIT 1
+#define QUIRK_JUMP 0
+#include"interpreter.h"
+
+#define INTERP_NAME schip
+#define QUIRK_VF_RESET 0
+#define QUIRK_MEMORY 0
+#define QUIRK_SHIFT 1
+#define QUIRK_WRAP 0
+#define QUIRK_DISPLAY_WAIT 0
+#define QUIRK_JUMP 1
+#include"interpreter.h"
+
+#define INTERP_NAME xochip
+#define QUIRK_VF_RESET 0
+#define QUIRK_MEMORY 1
+#define QUIRK_SHIFT 0
+#define QUIRK_WRAP 1
+#define QUIRK_DISPLAY_WAIT 0
+#define QUIRK_JUMP 0
+#include"interpreter.h"
+
+#undef INTERP_MACHINE
+#undef INTERP_PREFIX
+#undef INTERP_PARAMS
+#undef INTERP_ARGS
+#undef INTERP_FETCH
+#undef INTERP_LOAD
+#undef INTERP_STORE
+#undef INTERP_WROTE
+#undef INTERP_DUMP
+#undef INTERP_CLEAR
+#undef INTERP_DRAW
+#undef INTERP_DRAW_WRAP
+#undef INTERP_RAND
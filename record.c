@@ -0,0 +1,421 @@
+#include<pthread.h>
+#include<stdbool.h>
+#include<stdint.h>
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+
+#include"chip_8.h"
+#include"record.h"
+
+/* Headless frame capture. Every emulated frame is handed to record_frame() which costs a display
+ * hash and,only when the picture changed,packing it into 256 bytes. Consecutive identical frames 
+ * are deduplicated into one record with a repeat count.
+ *
+ * Records are double buffered: the emulator appends to the front batch while the recorder's own 
+ * thread writes out the back batch, the two are swapped under a mutex that is only ever held for 
+ * an append or a swap. So the emulator never waits for the disk or for an encoder on the other 
+ * end of a pipe,if the writer falls behind the front batch just grows.
+ *
+ * Formats (picked by the extension or a "format:" prefix,"-" is stdout and "|cmd" pipes into cmd):
+ * y4m   YUV4MPEG2 (mono) at 60fps, e.g. "y4m:|ffmpeg -i - out.mp4"
+ * raw   8 bit gray frames at 60fps, e.g. "raw:|ffmpeg -f rawvideo -pix_fmt gray -s 64x32 -r 60 -i - out.mp4"
+ * gif   animated GIF, repeated frames become one frame with a longer delay
+ * txt   hash log,one line per distinct frame: first frame,display hash,how many frames it stayed
+ */
+
+#define RECORDERS_MAX 4
+#define FRAME_BYTES (DISPLAY_WIDTH * DISPLAY_HEIGHT / 8)
+
+enum{
+	FORMAT_Y4M,
+	FORMAT_RAW,
+	FORMAT_GIF,
+	FORMAT_HASHES
+};
+
+struct FrameRecord{
+	uint8_t pixels[FRAME_BYTES]; // 1 bit per pixel,row major,MSB first
+	uint64_t hash;
+	uint64_t first; // the emulated frame it first appeared in
+	uint32_t repeat; // how many emulated frames it stayed on screen
+};
+
+struct Batch{
+	struct FrameRecord *records;
+	size_t count;
+	size_t cap;
+};
+
+struct Recorder{
+	FILE *out;
+	bool is_pipe;
+	int format;
+
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	struct Batch batches[2];
+	int front; // the batch the emulator appends to
+	bool closing;
+
+	// Emulator side,the record being deduplicated into
+	struct FrameRecord pending;
+	bool has_pending;
+	bool stopped; // out of memory,nothing more is recorded
+	uint64_t frames;
+
+	// Writer side
+	uint64_t written_cs; // GIF: centiseconds of delay written so far
+	uint64_t written_frames;
+	uint16_t (*lzw)[4]; // GIF: LZW dictionary as a trie,lzw[code][pixel] is the child code
+};
+
+bool record_open(const char *spec);
+void record_frame(const struct Chip8 *c8);
+void record_close_all(void);
+
+static struct Recorder *recorders[RECORDERS_MAX];
+static int recorder_count;
+
+static inline int frame_pixel(const struct FrameRecord *f,int x,int y){
+	int i = y * DISPLAY_WIDTH + x;
+	return (f->pixels[i >> 3] >> (7 - (i & 7))) & 1;
+}
+
+static void write_gray(struct Recorder *r,const struct FrameRecord *f){
+	uint8_t plane[DISPLAY_WIDTH * DISPLAY_HEIGHT];
+
+	for(int y = 0;y < DISPLAY_HEIGHT;y++)
+		for(int x = 0;x < DISPLAY_WIDTH;x++)
+			plane[y * DISPLAY_WIDTH + x] = frame_pixel(f,x,y) ? 255 : 0;
+
+	for(uint32_t i = 0;i < f->repeat;i++){
+		if(r->format == FORMAT_Y4M)
+			fputs("FRAME\n",r->out);
+		fwrite(plane,1,sizeof(plane),r->out);
+	}
+}
+
+/* GIF LZW, see the GIF89a spec. Codes are packed LSB first and cut into sub-blocks of 255 bytes.*/
+struct BitWriter{
+	FILE *out;
+	uint32_t bits;
+	int nbits;
+	uint8_t block[255];
+	int len;
+};
+
+static void gif_put_byte(struct BitWriter *w,uint8_t byte){
+	w->block[w->len++] = byte;
+	if(w->len == 255){
+		fputc(255,w->out);
+		fwrite(w->block,1,255,w->out);
+		w->len = 0;
+	}
+}
+
+static void gif_put_code(struct BitWriter *w,unsigned code,int size){
+	w->bits |= code << w->nbits;
+	w->nbits += size;
+	while(w->nbits >= 8){
+		gif_put_byte(w,w->bits & 0xFF);
+		w->bits >>= 8;
+		w->nbits -= 8;
+	}
+}
+
+static void gif_flush(struct BitWriter *w){
+	if(w->nbits > 0)
+		gif_put_byte(w,w->bits & 0xFF);
+	if(w->len > 0){
+		fputc(w->len,w->out);
+		fwrite(w->block,1,w->len,w->out);
+	}
+	fputc(0,w->out); // block terminator
+}
+
+static void write_gif_header(struct Recorder *r){
+	static const uint8_t netscape[] = {0x21,0xFF,0x0B,'N','E','T','S','C','A','P','E','2','.','0',
+					   0x03,0x01,0x00,0x00,0x00};
+
+	fwrite("GIF89a",1,6,r->out);
+	fputc(DISPLAY_WIDTH & 0xFF,r->out);
+	fputc(DISPLAY_WIDTH >> 8,r->out);
+	fputc(DISPLAY_HEIGHT & 0xFF,r->out);
+	fputc(DISPLAY_HEIGHT >> 8,r->out);
+	fputc(0x80,r->out); // global colour table of 2 entries
+	fputc(0,r->out);
+	fputc(0,r->out);
+	fwrite("\x00\x00\x00\xFF\xFF\xFF",1,6,r->out); // black,white
+	fwrite(netscape,1,sizeof(netscape),r->out); // loop forever
+}
+
+static void write_gif_frame(struct Recorder *r,const struct FrameRecord *f){
+	const int min_size = 2,clear = 1 << min_size,eoi = clear + 1;
+
+	// 60 frames a second doesn't divide into centiseconds,keep the rounding error from adding up
+	r->written_frames += f->repeat;
+	uint64_t target = (r->written_frames * 100 + 30) / 60;
+	unsigned delay = target - r->written_cs;
+	r->written_cs = target;
+
+	uint8_t gce[] = {0x21,0xF9,0x04,0x00,delay & 0xFF,delay >> 8,0x00,0x00};
+	fwrite(gce,1,sizeof(gce),r->out);
+
+	uint8_t desc[] = {0x2C,0,0,0,0,DISPLAY_WIDTH & 0xFF,DISPLAY_WIDTH >> 8,DISPLAY_HEIGHT & 0xFF,
+			  DISPLAY_HEIGHT >> 8,0x00};
+	fwrite(desc,1,sizeof(desc),r->out);
+	fputc(min_size,r->out);
+
+	struct BitWriter w = {.out = r->out};
+	int size = min_size + 1;
+	unsigned next = eoi + 1;
+
+	memset(r->lzw,0,4096 * sizeof(*r->lzw));
+	gif_put_code(&w,clear,size);
+
+	unsigned cur = frame_pixel(f,0,0);
+	for(int i = 1;i < DISPLAY_WIDTH * DISPLAY_HEIGHT;i++){
+		int p = frame_pixel(f,i % DISPLAY_WIDTH,i / DISPLAY_WIDTH);
+
+		if(r->lzw[cur][p]){
+			cur = r->lzw[cur][p];
+			continue;
+		}
+
+		gif_put_code(&w,cur,size);
+		if(next < 4096){
+			if(next == (1u << size))
+				size++;
+			r->lzw[cur][p] = next++;
+		}else{
+			gif_put_code(&w,clear,size);
+			memset(r->lzw,0,4096 * sizeof(*r->lzw));
+			size = min_size + 1;
+			next = eoi + 1;
+		}
+		cur = p;
+	}
+
+	gif_put_code(&w,cur,size);
+	gif_put_code(&w,eoi,size);
+	gif_flush(&w);
+}
+
+static void write_record(struct Recorder *r,const struct FrameRecord *f){
+	switch(r->format){
+		case FORMAT_Y4M:
+		case FORMAT_RAW:
+			write_gray(r,f);
+			break;
+		case FORMAT_GIF:
+			write_gif_frame(r,f);
+			break;
+		case FORMAT_HASHES:
+			fprintf(r->out,"%llu %016llx %u\n",(unsigned long long) f->first,
+				(unsigned long long) f->hash,f->repeat);
+			break;
+	}
+}
+
+static void *writer_thread(void *arg){
+	struct Recorder *r = arg;
+
+	pthread_mutex_lock(&r->lock);
+	for(;;){
+		while(r->batches[r->front].count == 0 && !r->closing)
+			pthread_cond_wait(&r->cond,&r->lock);
+
+		if(r->batches[r->front].count == 0)
+			break; // closing and nothing left
+
+		// Swap: the emulator carries on appending to the other batch while this one is written
+		struct Batch *back = &r->batches[r->front];
+		r->front ^= 1;
+		pthread_mutex_unlock(&r->lock);
+
+		for(size_t i = 0;i < back->count;i++)
+			write_record(r,&back->records[i]);
+		back->count = 0;
+
+		pthread_mutex_lock(&r->lock);
+	}
+	pthread_mutex_unlock(&r->lock);
+
+	return NULL;
+}
+
+// Stops the recording (keeping what's been written) if there's no memory for the record
+static void push_record(struct Recorder *r,const struct FrameRecord *f){
+	pthread_mutex_lock(&r->lock);
+
+	struct Batch *b = &r->batches[r->front];
+	if(b->count == b->cap){
+		size_t cap = b->cap ? b->cap * 2 : 256;
+		struct FrameRecord *records = realloc(b->records,cap * sizeof(*records));
+		if(records == NULL){
+			fprintf(stderr,"Out of memory for the recording,stopping it at frame %llu\n",
+				(unsigned long long) f->first);
+			r->stopped = true;
+			pthread_mutex_unlock(&r->lock);
+			return;
+		}
+		b->records = records;
+		b->cap = cap;
+	}
+	b->records[b->count++] = *f;
+
+	pthread_cond_signal(&r->cond);
+	pthread_mutex_unlock(&r->lock);
+}
+
+// `spec` is a path or "format:path","-" is stdout and "|cmd" pipes into cmd
+bool record_open(const char *spec){
+	static const char *names[] = {[FORMAT_Y4M] = "y4m",[FORMAT_RAW] = "raw",[FORMAT_GIF] = "gif",
+				      [FORMAT_HASHES] = "txt"};
+	int format = -1;
+	const char *path = spec;
+
+	if(recorder_count == RECORDERS_MAX){
+		fprintf(stderr,"Too many recordings (at most %d)\n",RECORDERS_MAX);
+		return false;
+	}
+
+	for(int i = 0;i < 4;i++){
+		size_t len = strlen(names[i]);
+		const char *ext = strrchr(spec,'.');
+
+		if(strncmp(spec,names[i],len) == 0 && spec[len] == ':'){
+			format = i;
+			path = spec + len + 1;
+			break;
+		}
+		if(ext && strcmp(ext + 1,names[i]) == 0)
+			format = i;
+	}
+
+	if(format < 0){
+		fprintf(stderr,"Don't know the format of %s (y4m,raw,gif or txt)\n",spec);
+		return false;
+	}
+
+	struct Recorder *r = calloc(1,sizeof(*r));
+	if(r == NULL){
+		fprintf(stderr,"Out of memory for recording %s\n",path);
+		return false;
+	}
+	r->format = format;
+
+	if(strcmp(path,"-") == 0){
+		r->out = stdout;
+	}else if(path[0] == '|'){
+		r->out = popen(path + 1,"w");
+		r->is_pipe = true;
+	}else{
+		r->out = fopen(path,"wb");
+	}
+
+	if(r->out == NULL){
+		fprintf(stderr,"Couldn't open %s for recording\n",path);
+		free(r);
+		return false;
+	}
+
+	switch(format){
+		case FORMAT_Y4M:
+			fprintf(r->out,"YUV4MPEG2 W%d H%d F60:1 Ip A1:1 Cmono\n",DISPLAY_WIDTH,DISPLAY_HEIGHT);
+			break;
+		case FORMAT_GIF:
+			if((r->lzw = malloc(4096 * sizeof(*r->lzw))) == NULL){
+				fprintf(stderr,"Out of memory for recording %s\n",path);
+				if(r->is_pipe)
+					pclose(r->out);
+				else if(r->out != stdout)
+					fclose(r->out);
+				free(r);
+				return false;
+			}
+			write_gif_header(r);
+			break;
+		case FORMAT_HASHES:
+			fprintf(r->out,"# first_frame display_hash frames\n");
+			break;
+	}
+
+	pthread_mutex_init(&r->lock,NULL);
+	pthread_cond_init(&r->cond,NULL);
+	pthread_create(&r->thread,NULL,writer_thread,r);
+
+	recorders[recorder_count++] = r;
+	return true;
+}
+
+// Called once per emulated frame
+void record_frame(const struct Chip8 *c8){
+	if(recorder_count == 0)
+		return;
+
+	uint64_t hash = chip8_display_hash(c8);
+
+	for(int i = 0;i < recorder_count;i++){
+		struct Recorder *r = recorders[i];
+		uint64_t frame = r->frames++;
+
+		if(r->stopped)
+			continue;
+
+		if(r->has_pending && r->pending.hash == hash){
+			r->pending.repeat++;
+			continue;
+		}
+
+		if(r->has_pending)
+			push_record(r,&r->pending);
+
+		memset(r->pending.pixels,0,FRAME_BYTES);
+		for(int y = 0;y < DISPLAY_HEIGHT;y++)
+			for(int x = 0;x < DISPLAY_WIDTH;x++)
+				if(c8->display[y][x]){
+					int p = y * DISPLAY_WIDTH + x;
+					r->pending.pixels[p >> 3] |= 0x80 >> (p & 7);
+				}
+		r->pending.hash = hash;
+		r->pending.first = frame;
+		r->pending.repeat = 1;
+		r->has_pending = true;
+	}
+}
+
+// Flushes whatever is left and waits for the writers to finish
+void record_close_all(void){
+	for(int i = 0;i < recorder_count;i++){
+		struct Recorder *r = recorders[i];
+
+		if(r->has_pending && !r->stopped)
+			push_record(r,&r->pending);
+
+		pthread_mutex_lock(&r->lock);
+		r->closing = true;
+		pthread_cond_signal(&r->cond);
+		pthread_mutex_unlock(&r->lock);
+		pthread_join(r->thread,NULL);
+
+		if(r->format == FORMAT_GIF)
+			fputc(0x3B,r->out); // trailer
+
+		if(r->is_pipe)
+			pclose(r->out);
+		else if(r->out != stdout)
+			fclose(r->out);
+		else
+			fflush(stdout);
+
+		free(r->batches[0].records);
+		free(r->batches[1].records);
+		free(r->lzw);
+		free(r);
+	}
+
+	recorder_count = 0;
+}
@@ -0,0 +1,10 @@
+#ifndef RECORD_H
+#define RECORD_H
+
+#include"chip_8.h"
+
+bool record_open(const char *spec);
+void record_frame(const struct Chip8 *c8);
+void record_close_all(void);
+
+#endif
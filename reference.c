@@ -0,0 +1,244 @@
+#include<stdbool.h>
+#include<stdint.h>
+#include<string.h>
+
+#include"chip_8.h"
+#include"reference.h"
+
+/* The reference engine: a deliberately plain interpreter written straight from the spec with no 
+ * debug output,no code generation and the quirks looked up at run time from the profile's flags.
+ * It's slow on purpose and exists to be compared against (see difftest.c), so keep it boring.
+ *
+ * Behaviour that isn't in the spec matches the rest of the emulator: memory wraps at 0xFFF,a call
+ * with a full stack still jumps but drops the return address,a return with an empty stack does
+ * nothing,EX9E/FX0A consume the key they saw and unknown opcodes do nothing.
+ */
+
+bool reference_step(struct Chip8 *c8,const struct Quirks *q);
+unsigned reference_run(struct Chip8 *c8,const struct Quirks *q,unsigned budget);
+
+// Sprites always start on screen, the rest is either clipped or wrapped
+static bool reference_draw(struct Chip8 *c8,const struct Quirks *q,int x,int y,int n){
+	bool collision = false;
+
+	x %= DISPLAY_WIDTH;
+	y %= DISPLAY_HEIGHT;
+
+	for(int row = 0;row < n;row++){
+		int py = y + row;
+		if(py >= DISPLAY_HEIGHT && !q->wrap)
+			break;
+		py %= DISPLAY_HEIGHT;
+
+		uint8_t sprite = c8->memory[(c8->registers.I + row) & 0xFFF];
+
+		for(int col = 0;col < 8;col++){
+			int px = x + col;
+			if(px >= DISPLAY_WIDTH && !q->wrap)
+				break;
+			px %= DISPLAY_WIDTH;
+
+			if(sprite & (0x80 >> col)){
+				if(c8->display[py][px])
+					collision = true;
+				c8->display[py][px] ^= 1;
+			}
+		}
+	}
+
+	return collision;
+}
+
+bool reference_step(struct Chip8 *c8,const struct Quirks *q){
+	_registers *r = &c8->registers;
+	uint16_t pc = r->PC;
+	uint16_t op = c8->memory[pc] << 8 | c8->memory[(pc + 1) & 0xFFF];
+	uint8_t *V = r->V;
+	int x = (op >> 8) & 0xF;
+	int y = (op >> 4) & 0xF;
+	int n = op & 0xF;
+	int nn = op & 0xFF;
+	int nnn = op & 0xFFF;
+	int flag;
+
+	r->PC = (pc + 2) & 0xFFF;
+
+	switch(op >> 12){
+		case 0x0:
+			if(op == 0x00E0){
+				memset(c8->display,0,sizeof(c8->display));
+			}else if(op == 0x00EE){
+				if(c8->sp > 0)
+					r->PC = c8->stack[--c8->sp];
+			}
+			break;
+		case 0x1:
+			r->PC = nnn;
+			break;
+		case 0x2:
+			if(c8->sp < 16)
+				c8->stack[c8->sp++] = r->PC;
+			r->PC = nnn;
+			break;
+		case 0x3:
+			if(V[x] == nn)
+				r->PC = (r->PC + 2) & 0xFFF;
+			break;
+		case 0x4:
+			if(V[x] != nn)
+				r->PC = (r->PC + 2) & 0xFFF;
+			break;
+		case 0x5:
+			if(V[x] == V[y])
+				r->PC = (r->PC + 2) & 0xFFF;
+			break;
+		case 0x6:
+			V[x] = nn;
+			break;
+		case 0x7:
+			V[x] += nn;
+			break;
+		case 0x8:
+			switch(n){
+				case 0x0:
+					V[x] = V[y];
+					break;
+				case 0x1:
+					V[x] |= V[y];
+					if(q->vf_reset)
+						V[0xF] = 0;
+					break;
+				case 0x2:
+					V[x] &= V[y];
+					if(q->vf_reset)
+						V[0xF] = 0;
+					break;
+				case 0x3:
+					V[x] ^= V[y];
+					if(q->vf_reset)
+						V[0xF] = 0;
+					break;
+				case 0x4:
+					flag = V[x] + V[y] > 0xFF;
+					V[x] += V[y];
+					V[0xF] = flag;
+					break;
+				case 0x5:
+					flag = V[x] >= V[y];
+					V[x] -= V[y];
+					V[0xF] = flag;
+					break;
+				case 0x6:
+					if(!q->shift)
+						V[x] = V[y];
+					flag = V[x] & 1;
+					V[x] >>= 1;
+					V[0xF] = flag;
+					break;
+				case 0x7:
+					flag = V[y] >= V[x];
+					V[x] = V[y] - V[x];
+					V[0xF] = flag;
+					break;
+				case 0xE:
+					if(!q->shift)
+						V[x] = V[y];
+					flag = V[x] >> 7;
+					V[x] <<= 1;
+					V[0xF] = flag;
+					break;
+			}
+			break;
+		case 0x9:
+			if(V[x] != V[y])
+				r->PC = (r->PC + 2) & 0xFFF;
+			break;
+		case 0xA:
+			r->I = nnn;
+			break;
+		case 0xB:
+			r->PC = (nnn + V[q->jump ? x : 0]) & 0xFFF;
+			break;
+		case 0xC:
+			V[x] = chip8_rand(c8) & nn;
+			break;
+		case 0xD:
+			V[0xF] = reference_draw(c8,q,V[x],V[y],n);
+			return q->display_wait;
+		case 0xE:
+			if(nn == 0x9E){
+				if(c8->keypad[V[x] & 0xF])
+					r->PC = (r->PC + 2) & 0xFFF;
+				c8->keypad[V[x] & 0xF] = false;
+			}else if(nn == 0xA1){
+				if(!c8->keypad[V[x] & 0xF])
+					r->PC = (r->PC + 2) & 0xFFF;
+			}
+			break;
+		case 0xF:
+			switch(nn){
+				case 0x07:
+					V[x] = c8->delay_timer;
+					break;
+				case 0x0A:
+					flag = -1;
+					for(int k = 0;k < 16;k++)
+						if(c8->keypad[k]){
+							flag = k;
+							break;
+						}
+					if(flag < 0)
+						r->PC = pc; // wait,i.e. run this instruction again
+					else
+						V[x] = flag;
+					c8->keypad[V[x] & 0xF] = false;
+					break;
+				case 0x15:
+					c8->delay_timer = V[x];
+					break;
+				case 0x18:
+					c8->sound_timer = V[x];
+					break;
+				case 0x1E:
+					r->I = (r->I + V[x]) & 0xFFF;
+					break;
+				case 0x29:
+					r->I = (0x50 + V[x] * 5) & 0xFFF;
+					break;
+				case 0x33:
+					c8->memory[r->I] = V[x] / 100;
+					c8->memory[(r->I + 1) & 0xFFF] = V[x] / 10 % 10;
+					c8->memory[(r->I + 2) & 0xFFF] = V[x] % 10;
+					chip8_wrote(c8,r->I,3);
+					break;
+				case 0x55:
+					for(int k = 0;k <= x;k++)
+						c8->memory[(r->I + k) & 0xFFF] = V[k];
+					chip8_wrote(c8,r->I,x + 1);
+					if(q->memory)
+						r->I = (r->I + x + 1) & 0xFFF;
+					break;
+				case 0x65:
+					for(int k = 0;k <= x;k++)
+						V[k] = c8->memory[(r->I + k) & 0xFFF];
+					if(q->memory)
+						r->I = (r->I + x + 1) & 0xFFF;
+					break;
+			}
+			break;
+	}
+
+	return false;
+}
+
+unsigned reference_run(struct Chip8 *c8,const struct Quirks *q,unsigned budget){
+	unsigned n = 0;
+
+	while(n < budget){
+		n++;
+		if(reference_step(c8,q))
+			break;
+	}
+
+	return n;
+}
@@ -0,0 +1,9 @@
+#ifndef REFERENCE_H
+#define REFERENCE_H
+
+#include"chip_8.h"
+
+bool reference_step(struct Chip8 *c8,const struct Quirks *q);
+unsigned reference_run(struct Chip8 *c8,const struct Quirks *q,unsigned budget);
+
+#endif
@@ -0,0 +1,165 @@
+#include<errno.h>
+#include<limits.h>
+#include<stdbool.h>
+#include<stdint.h>
+#include<stdio.h>
+#include<string.h>
+#include<sys/inotify.h>
+#include<unistd.h>
+
+#include"chip_8.h"
+#include"metrics.h"
+#include"reload.h"
+#include"rom.h"
+
+/* Hot reload (--watch): the ROM file is watched with inotify and when it's saved the new version
+ * is loaded into the running machine,without touching SDL or anything else. The directory is
+ * watched rather than the file since most editors save by writing a new file and renaming it over
+ * the old one. reload_poll() is one non blocking read() per frame.
+ *
+ * How much of the machine survives depends on the mode: RELOAD_RESET clears memory from 0x200 up,
+ * the registers,stack and timers (the font stays where it is),RELOAD_KEEP_DISPLAY does the same 
+ * but leaves the display alone,RELOAD_PATCH keeps the whole state and only writes the bytes that
+ * differ between the old and the new file,for tweaking sprites and constants without restarting
+ * a level.*/
+
+#define ROM_MAX (0x1000 - 0x200)
+
+bool reload_active;
+
+bool reload_watch(const char *rom,int mode);
+bool reload_poll(struct Chip8 *c8);
+void reload_close(void);
+
+static struct{
+	int fd;
+	int mode;
+	char path[PATH_MAX];
+	char name[NAME_MAX + 1]; // what changes in the directory,the ROM or the archive it's in
+	uint8_t image[ROM_MAX]; // the ROM as last loaded
+	size_t len;
+}watch = {.fd = -1};
+
+bool reload_watch(const char *rom,int mode){
+	char dir[PATH_MAX];
+
+	if(strlen(rom) >= sizeof(watch.path))
+		return false;
+	strcpy(watch.path,rom);
+	watch.mode = mode;
+
+	// "archive.zip:ENTRY" changes when the archive does
+	snprintf(dir,sizeof(dir),"%s",rom);
+	char *sep = strstr(dir,".zip:");
+	if(sep)
+		sep[4] = 0;
+	char *slash = strrchr(dir,'/');
+	const char *base = slash ? slash + 1 : dir;
+	size_t base_len = strlen(base);
+	if(base_len >= sizeof(watch.name)){
+		fprintf(stderr,"%s: the file name is too long to watch\n",rom);
+		return false;
+	}
+	memcpy(watch.name,base,base_len + 1);
+	if(slash)
+		slash[slash == dir] = 0; // "/rom" is in "/"
+	else
+		strcpy(dir,".");
+
+	if(!rom_read(rom,watch.image,sizeof(watch.image),&watch.len))
+		return false;
+
+	watch.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if(watch.fd < 0 || inotify_add_watch(watch.fd,dir,IN_CLOSE_WRITE | IN_MOVED_TO) < 0){
+		if(debug_flag)
+			perror("inotify");
+		reload_close();
+		return false;
+	}
+
+	reload_active = true;
+	printf("Watching %s for changes\n",rom);
+	return true;
+}
+
+void reload_close(void){
+	if(watch.fd >= 0)
+		close(watch.fd);
+	watch.fd = -1;
+	reload_active = false;
+}
+
+// Has the ROM been written since the last call?
+static bool changed(void){
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	bool hit = false;
+	ssize_t n;
+
+	while((n = read(watch.fd,buf,sizeof(buf))) > 0){
+		for(char *p = buf;p < buf + n;){
+			const struct inotify_event *e = (const struct inotify_event *) p;
+			if(e->len && strcmp(e->name,watch.name) == 0)
+				hit = true;
+			p += sizeof(*e) + e->len;
+		}
+	}
+	if(n < 0 && errno != EAGAIN && debug_flag)
+		perror("inotify read");
+
+	return hit;
+}
+
+/* Once a frame: reloads the ROM into `c8` if it changed. Returns true if it did.*/
+bool reload_poll(struct Chip8 *c8){
+	if(!changed())
+		return false;
+
+	uint64_t start = metrics_now();
+	uint8_t image[ROM_MAX];
+	size_t len;
+
+	rom_forget(watch.path);
+	if(!rom_read(watch.path,image,sizeof(image),&len) || len == 0){
+		// Most likely caught halfway through a save,the next event brings the rest
+		fprintf(stderr,"Couldn't reload %s,keeping the old version\n",watch.path);
+		return false;
+	}
+
+	uint8_t *memory = &c8->memory[0x200];
+	unsigned patched = 0;
+
+	if(watch.mode == RELOAD_PATCH){
+		size_t end = len > watch.len ? len : watch.len;
+		for(size_t i = 0;i < end;i++){
+			uint8_t old = i < watch.len ? watch.image[i] : 0,now = i < len ? image[i] : 0;
+			if(old != now){
+				memory[i] = now;
+				patched++;
+			}
+		}
+	}else{
+		memset(&c8->registers,0,sizeof(c8->registers));
+		c8->registers.PC = 0x200;
+		memset(c8->stack,0,sizeof(c8->stack));
+		c8->sp = 0;
+		c8->delay_timer = c8->sound_timer = 0;
+		c8->cycles = 0;
+		if(watch.mode == RELOAD_RESET)
+			memset(c8->display,0,sizeof(c8->display));
+		memset(memory,0,ROM_MAX);
+		memcpy(memory,image,len);
+	}
+	chip8_wrote(c8,0x200,ROM_MAX);
+
+	memcpy(watch.image,image,len);
+	watch.len = len;
+
+	uint64_t took = metrics_now() - start;
+	if(watch.mode == RELOAD_PATCH)
+		printf("Reloaded %s (%zu bytes,%u changed) in %llu us\n",watch.path,len,patched,
+		       (unsigned long long) took / 1000);
+	else
+		printf("Reloaded %s (%zu bytes) in %llu us\n",watch.path,len,(unsigned long long) took / 1000);
+	fflush(stdout);
+	return true;
+}
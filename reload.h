@@ -0,0 +1,18 @@
+#ifndef RELOAD_H
+#define RELOAD_H
+
+#include"chip_8.h"
+
+enum{
+	RELOAD_RESET, // start the new ROM from scratch
+	RELOAD_KEEP_DISPLAY, // ...but leave what's on the screen
+	RELOAD_PATCH // keep running,only the bytes that changed in the file are written to memory
+};
+
+extern bool reload_active;
+
+bool reload_watch(const char *rom,int mode);
+bool reload_poll(struct Chip8 *c8);
+void reload_close(void);
+
+#endif
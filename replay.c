@@ -0,0 +1,391 @@
+#include<pthread.h>
+#include<stdatomic.h>
+#include<stdbool.h>
+#include<stdint.h>
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<time.h>
+
+#include"chip_8.h"
+#include"replay.h"
+#include"vip.h"
+
+/* Recording the input of a session and checking that replaying it still gives the same machine,
+ * e.g. hours of recorded play after a change to the interpreter. The emulation is a pure function of
+ * the machine and the keys of every frame (CXNN's random numbers come from the machine's own rng),
+ * so a recording is the keys of every frame plus a keyframe,the whole machine,every N frames.
+ *
+ * The keyframes split a replay into segments that don't depend on each other: segment k starts from
+ * keyframe k,replays its N frames of input and has to end in exactly keyframe k + 1 (the last one 
+ * in the final hash). So the verifier replays all the segments at once on every core,a replay of
+ * an hour takes about as long as its slowest segment per core instead of an hour of frames.
+ *
+ * Anything that changes the machine besides the keys while recording (cheats,--watch reloads,the
+ * debugger) shows up as a segment that doesn't match.*/
+
+enum{
+	TAG_KEYFRAME = 'K',
+	TAG_INPUT = 'I',
+	TAG_END = 'E'
+};
+
+bool replay_recording = false;
+
+static struct{
+	FILE *out;
+	unsigned keyframe_every;
+	uint32_t frame;
+}recorder;
+
+bool replay_record_open(const char *path,unsigned keyframe_every,const struct Quirks *q,unsigned speed,
+			bool vip);
+void replay_frame(const struct Chip8 *c8);
+void replay_record_close(const struct Chip8 *c8);
+int replay_verify(const char *path,int threads);
+
+static void state_save(const struct Chip8 *c8,struct ReplayState *s){
+	memset(s,0,sizeof(*s));
+	memcpy(s->V,c8->registers.V,sizeof(s->V));
+	s->I = c8->registers.I;
+	s->PC = c8->registers.PC;
+	for(int i = 0;i < 16;i++)
+		s->stack[i] = c8->stack[i];
+	s->sp = c8->sp;
+	s->delay_timer = c8->delay_timer;
+	s->sound_timer = c8->sound_timer;
+	s->rng = c8->rng;
+	s->cycles = c8->cycles;
+	for(int y = 0;y < DISPLAY_HEIGHT;y++)
+		for(int x = 0;x < DISPLAY_WIDTH;x++)
+			s->display[(y * DISPLAY_WIDTH + x) / 8] |= c8->display[y][x] << (7 - x % 8);
+	memcpy(s->memory,c8->memory,sizeof(s->memory));
+}
+
+static void state_load(struct Chip8 *c8,const struct ReplayState *s){
+	memset(c8,0,sizeof(*c8));
+	memcpy(c8->registers.V,s->V,sizeof(s->V));
+	c8->registers.I = s->I;
+	c8->registers.PC = s->PC;
+	for(int i = 0;i < 16;i++)
+		c8->stack[i] = s->stack[i];
+	c8->sp = s->sp;
+	c8->delay_timer = s->delay_timer;
+	c8->sound_timer = s->sound_timer;
+	c8->rng = s->rng;
+	c8->cycles = s->cycles;
+	for(int y = 0;y < DISPLAY_HEIGHT;y++)
+		for(int x = 0;x < DISPLAY_WIDTH;x++)
+			c8->display[y][x] = s->display[(y * DISPLAY_WIDTH + x) / 8] >> (7 - x % 8) & 1;
+	memcpy(c8->memory,s->memory,sizeof(s->memory));
+	chip8_wrote(c8,0,sizeof(c8->memory));
+}
+
+// FNV-1a over the saved state
+static uint64_t state_hash(const struct ReplayState *s){
+	const uint8_t *p = (const uint8_t *) s;
+	uint64_t h = 0xcbf29ce484222325ULL;
+
+	for(size_t i = 0;i < sizeof(*s);i++){
+		h ^= p[i];
+		h *= 0x100000001b3ULL;
+	}
+	return h;
+}
+
+/* Starts recording to `path`. The first keyframe is the machine of the first frame so the recording
+ * doesn't need the ROM to be replayed.*/
+bool replay_record_open(const char *path,unsigned keyframe_every,const struct Quirks *q,unsigned speed,
+			bool vip){
+	struct ReplayHeader header = {
+		.magic = REPLAY_MAGIC,
+		.version = REPLAY_VERSION,
+		.speed = speed,
+		.vip = vip,
+		.keyframe_every = keyframe_every ? keyframe_every : REPLAY_KEYFRAME_EVERY
+	};
+
+	snprintf(header.quirks,sizeof(header.quirks),"%s",q->name);
+	if((recorder.out = fopen(path,"wb")) == NULL){
+		fprintf(stderr,"Couldn't open %s for the input recording\n",path);
+		return false;
+	}
+	if(fwrite(&header,sizeof(header),1,recorder.out) != 1){
+		fclose(recorder.out);
+		return false;
+	}
+	recorder.keyframe_every = header.keyframe_every;
+	recorder.frame = 0;
+	replay_recording = true;
+	return true;
+}
+
+// Called at the start of every frame,with the keys the frame is going to run with
+void replay_frame(const struct Chip8 *c8){
+	uint8_t tag;
+
+	if(recorder.frame % recorder.keyframe_every == 0){
+		struct ReplayState s;
+		state_save(c8,&s);
+		tag = TAG_KEYFRAME;
+		fwrite(&tag,1,1,recorder.out);
+		fwrite(&recorder.frame,sizeof(recorder.frame),1,recorder.out);
+		fwrite(&s,sizeof(s),1,recorder.out);
+	}
+
+	uint16_t keys = 0;
+	for(int i = 0;i < 16;i++)
+		keys |= c8->keypad[i] << i;
+	tag = TAG_INPUT;
+	fwrite(&tag,1,1,recorder.out);
+	fwrite(&keys,sizeof(keys),1,recorder.out);
+	recorder.frame++;
+}
+
+void replay_record_close(const struct Chip8 *c8){
+	if(!replay_recording)
+		return;
+
+	struct ReplayState s;
+	state_save(c8,&s);
+	uint64_t hash = state_hash(&s);
+	uint8_t tag = TAG_END;
+	fwrite(&tag,1,1,recorder.out);
+	fwrite(&recorder.frame,sizeof(recorder.frame),1,recorder.out);
+	fwrite(&hash,sizeof(hash),1,recorder.out);
+	if(fclose(recorder.out) != 0)
+		fprintf(stderr,"Error writing the input recording\n");
+	replay_recording = false;
+}
+
+/* A recording read back: the keys of every frame and where each keyframe is.*/
+struct Segment{
+	uint32_t first; // frame
+	uint32_t frames;
+	const struct ReplayState *start;
+	const struct ReplayState *end; // NULL for the last one,which ends in `final_hash`
+	bool ok;
+	char detail[128];
+};
+
+struct Replay{
+	struct ReplayHeader header;
+	const struct Quirks *quirks;
+	uint8_t *data;
+	uint16_t *keys;
+	uint32_t frames;
+	struct Segment *segments;
+	unsigned segment_count;
+	bool has_end;
+	uint64_t final_hash;
+	atomic_uint next;
+};
+
+static bool replay_load(const char *path,struct Replay *r){
+	FILE *f = fopen(path,"rb");
+	long len;
+
+	if(f == NULL || fseek(f,0,SEEK_END) != 0 || (len = ftell(f)) < (long) sizeof(r->header)){
+		fprintf(stderr,"Couldn't read the input recording %s\n",path);
+		if(f)
+			fclose(f);
+		return false;
+	}
+	rewind(f);
+	r->data = malloc(len);
+	bool ok = r->data && fread(r->data,len,1,f) == 1;
+	fclose(f);
+	if(!ok)
+		return false;
+
+	memcpy(&r->header,r->data,sizeof(r->header));
+	if(r->header.magic != REPLAY_MAGIC || r->header.version != REPLAY_VERSION){
+		fprintf(stderr,"%s isn't an input recording of this version\n",path);
+		return false;
+	}
+	r->header.quirks[sizeof(r->header.quirks) - 1] = 0;
+	if((r->quirks = quirks_find(r->header.quirks)) == NULL){
+		fprintf(stderr,"%s was recorded with the unknown quirk profile %s\n",path,r->header.quirks);
+		return false;
+	}
+
+	// At most a key record per 3 bytes and a keyframe per segment
+	r->keys = malloc(len / 3 * sizeof(*r->keys));
+	r->segments = calloc(len / sizeof(struct ReplayState) + 1,sizeof(*r->segments));
+	if(r->keys == NULL || r->segments == NULL)
+		return false;
+
+	// Cut short (e.g. the emulator crashed) is fine,up to the last complete record
+	size_t pos = sizeof(r->header);
+	while(pos < (size_t) len){
+		uint8_t tag = r->data[pos++];
+		if(tag == TAG_INPUT && pos + 2 <= (size_t) len){
+			memcpy(&r->keys[r->frames++],r->data + pos,2);
+			pos += 2;
+		}else if(tag == TAG_KEYFRAME && pos + 4 + sizeof(struct ReplayState) <= (size_t) len){
+			uint32_t frame;
+			memcpy(&frame,r->data + pos,4);
+			if(frame != r->frames){
+				fprintf(stderr,"%s: keyframe for frame %u at frame %u\n",path,frame,r->frames);
+				return false;
+			}
+			// Only used in place,so it has to be aligned
+			struct ReplayState *s = malloc(sizeof(*s));
+			if(s == NULL)
+				return false;
+			memcpy(s,r->data + pos + 4,sizeof(*s));
+			pos += 4 + sizeof(*s);
+			if(r->segment_count)
+				r->segments[r->segment_count - 1].end = s;
+			r->segments[r->segment_count++] = (struct Segment){.first = frame,.start = s};
+		}else if(tag == TAG_END && pos + 12 <= (size_t) len){
+			uint32_t frames;
+			memcpy(&frames,r->data + pos,4);
+			memcpy(&r->final_hash,r->data + pos + 4,8);
+			r->has_end = frames == r->frames;
+			break;
+		}else{
+			if(debug_flag)
+				fprintf(stderr,"%s: stops at byte %zu\n",path,pos - 1);
+			break;
+		}
+	}
+
+	if(r->segment_count == 0){
+		fprintf(stderr,"%s has no keyframes\n",path);
+		return false;
+	}
+	for(unsigned i = 0;i < r->segment_count;i++){
+		struct Segment *s = &r->segments[i];
+		s->frames = (i + 1 < r->segment_count ? r->segments[i + 1].first : r->frames) - s->first;
+	}
+	// Without the end record the last keyframe is the end of what can be checked
+	if(!r->has_end){
+		if(r->segment_count == 1){
+			fprintf(stderr,"%s has one keyframe and no end,there's nothing to check\n",path);
+			return false;
+		}
+		r->segment_count--;
+	}
+	return true;
+}
+
+static void replay_free(struct Replay *r){
+	if(r->segments)
+		for(unsigned i = 0;i < r->segment_count + 1 && r->segments[i].start;i++)
+			free((void *) r->segments[i].start);
+	free(r->segments);
+	free(r->keys);
+	free(r->data);
+}
+
+// Where two states differ,for the report
+static void describe(const struct ReplayState *got,const struct ReplayState *want,char *out,size_t len){
+	if(got->PC != want->PC)
+		snprintf(out,len,"PC %03X instead of %03X",got->PC,want->PC);
+	else if(memcmp(got->V,want->V,sizeof(got->V)) != 0)
+		snprintf(out,len,"different registers");
+	else if(memcmp(got->display,want->display,sizeof(got->display)) != 0)
+		snprintf(out,len,"different display");
+	else if(memcmp(got->memory,want->memory,sizeof(got->memory)) != 0){
+		int i = 0;
+		while(got->memory[i] == want->memory[i])
+			i++;
+		snprintf(out,len,"memory differs from %03X",i);
+	}else{
+		snprintf(out,len,"different I,stack,timers or rng");
+	}
+}
+
+static void run_segment(struct Replay *r,struct Segment *seg){
+	struct Chip8 c8;
+	struct ReplayState s;
+
+	state_load(&c8,seg->start);
+	for(uint32_t f = seg->first;f < seg->first + seg->frames;f++){
+		for(int i = 0;i < 16;i++)
+			c8.keypad[i] = r->keys[f] >> i & 1;
+		if(r->header.vip)
+			vip_run(&c8,r->quirks);
+		else
+			r->quirks->run(&c8,r->header.speed);
+		chip8_tick_timers(&c8);
+	}
+
+	state_save(&c8,&s);
+	if(seg->end){
+		seg->ok = memcmp(&s,seg->end,sizeof(s)) == 0;
+		if(!seg->ok)
+			describe(&s,seg->end,seg->detail,sizeof(seg->detail));
+	}else{
+		seg->ok = state_hash(&s) == r->final_hash;
+		if(!seg->ok)
+			snprintf(seg->detail,sizeof(seg->detail),"the final hash differs");
+	}
+}
+
+static void *verify_worker(void *arg){
+	struct Replay *r = arg;
+	unsigned i;
+
+	while((i = atomic_fetch_add(&r->next,1)) < r->segment_count)
+		run_segment(r,&r->segments[i]);
+	return NULL;
+}
+
+/* Replays the recording at `path` segment by segment on `threads` threads. Returns 0 if every 
+ * segment ends where the recording did.*/
+int replay_verify(const char *path,int threads){
+	struct Replay r = {0};
+	struct timespec t0,t1;
+	int status = EXIT_FAILURE;
+
+	if(!replay_load(path,&r)){
+		replay_free(&r);
+		return EXIT_FAILURE;
+	}
+	if(threads < 1)
+		threads = 1;
+	if((unsigned) threads > r.segment_count)
+		threads = r.segment_count;
+
+	pthread_t workers[threads];
+	clock_gettime(CLOCK_MONOTONIC,&t0);
+	atomic_init(&r.next,0);
+	int started = 0;
+	for(int i = 0;i < threads;i++)
+		started += pthread_create(&workers[started],NULL,verify_worker,&r) == 0;
+	if(started == 0)
+		verify_worker(&r);
+	for(int i = 0;i < started;i++)
+		pthread_join(workers[i],NULL);
+	clock_gettime(CLOCK_MONOTONIC,&t1);
+	double secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+	uint32_t checked = 0;
+	unsigned bad = 0;
+	for(unsigned i = 0;i < r.segment_count;i++){
+		checked += r.segments[i].frames;
+		if(!r.segments[i].ok){
+			if(bad++ < 10)
+				printf("Segment %u (frames %u-%u) doesn't end where the recording did: %s\n",i,
+				       r.segments[i].first,r.segments[i].first + r.segments[i].frames,
+				       r.segments[i].detail);
+		}
+	}
+
+	printf("%s: %u of %u frames (%s,%s) in %u segments checked in %.2fs on %d threads,%.0f frames/s\n",
+	       path,checked,r.frames,r.quirks->name,r.header.vip ? "VIP timing" : "fixed speed",
+	       r.segment_count,secs,started ? started : 1,checked / secs);
+	if(!r.has_end)
+		printf("The recording has no end record,the frames after the last keyframe weren't checked\n");
+	if(bad)
+		printf("%u of %u segments differ\n",bad,r.segment_count);
+	else{
+		printf("Every segment matches\n");
+		status = EXIT_SUCCESS;
+	}
+
+	replay_free(&r);
+	return status;
+}
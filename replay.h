@@ -0,0 +1,52 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include<stdbool.h>
+#include<stdint.h>
+
+#include"chip_8.h"
+
+/* Input recording (see replay.c). The file is a ReplayHeader and then tagged records in host byte 
+ * order: a keyframe ('K',the frame number and the whole machine) every `keyframe_every` frames from
+ * frame 0 on,the keys of every frame ('I',a bit per key) and at the end 'E' with the frame count 
+ * and the hash of the final machine.*/
+
+#define REPLAY_MAGIC 0x4E493843 // "C8IN"
+#define REPLAY_VERSION 1
+#define REPLAY_KEYFRAME_EVERY 600 // 10 seconds
+
+struct ReplayHeader{
+	uint32_t magic;
+	uint32_t version;
+	char quirks[16]; // the profile's name
+	uint16_t speed; // instructions per frame
+	uint8_t vip; // --vip timing instead of `speed`
+	uint8_t reserved;
+	uint32_t keyframe_every;
+};
+
+// The machine without the keypad (that's input)
+struct ReplayState{
+	uint8_t V[16];
+	uint16_t I;
+	uint16_t PC;
+	uint16_t stack[16];
+	uint8_t sp;
+	uint8_t delay_timer;
+	uint8_t sound_timer;
+	uint8_t reserved;
+	uint32_t rng;
+	int32_t cycles;
+	uint8_t display[DISPLAY_WIDTH * DISPLAY_HEIGHT / 8]; // a bit per pixel,MSB first
+	uint8_t memory[0x1000];
+};
+
+extern bool replay_recording;
+
+bool replay_record_open(const char *path,unsigned keyframe_every,const struct Quirks *q,unsigned speed,
+			bool vip);
+void replay_frame(const struct Chip8 *c8);
+void replay_record_close(const struct Chip8 *c8);
+int replay_verify(const char *path,int threads);
+
+#endif
@@ -0,0 +1,128 @@
+#include<fcntl.h>
+#include<stdbool.h>
+#include<stdint.h>
+#include<stdio.h>
+#include<string.h>
+#include<sys/stat.h>
+#include<unistd.h>
+
+#include"rom.h"
+#include"zip.h"
+
+/* Reading ROMs: a file in one read() after checking it fits,or an entry of a zip archive given as
+ * "archive.zip:ENTRY". Archives stay open (mapped,with their central directory indexed) for the 
+ * rest of the run so loading more ROMs out of the same archive is a hash lookup and a copy.*/
+
+extern bool debug_flag;
+
+bool rom_read(const char *path,uint8_t *out,size_t max,size_t *len);
+void rom_forget(const char *path);
+
+#define ARCHIVES_MAX 8
+
+static struct{
+	char path[256];
+	struct Zip *zip;
+}archives[ARCHIVES_MAX];
+
+static struct Zip *archive_open(const char *path){
+	int i;
+
+	for(i = 0;i < ARCHIVES_MAX && archives[i].zip;i++)
+		if(strcmp(archives[i].path,path) == 0)
+			return archives[i].zip;
+
+	struct Zip *zip = zip_open(path);
+	if(zip && i < ARCHIVES_MAX && strlen(path) < sizeof(archives[i].path)){
+		strcpy(archives[i].path,path);
+		archives[i].zip = zip;
+	}
+	// else it's leaked,there's no point in more than a handful of archives
+
+	return zip;
+}
+
+static bool read_archive(const char *path,const char *name,uint8_t *out,size_t max,size_t *len){
+	struct Zip *zip = archive_open(path);
+	if(zip == NULL)
+		return false;
+
+	const struct ZipEntry *entry = zip_find(zip,name);
+	if(entry == NULL){
+		fprintf(stderr,"No %s in %s,it has:",name,path);
+		for(unsigned i = 0;i < zip->count;i++)
+			fprintf(stderr," %.*s",zip->entries[i].name_len,zip->entries[i].name);
+		fprintf(stderr,"\n");
+		return false;
+	}
+
+	return zip_read(zip,entry,out,max,len);
+}
+
+static bool read_file(const char *path,uint8_t *out,size_t max,size_t *len){
+	int fd = open(path,O_RDONLY);
+	struct stat st;
+
+	if(fd < 0 || fstat(fd,&st) < 0){
+		if(debug_flag)
+			fprintf(stderr,"Couldn't read %s\n",path);
+		if(fd >= 0)
+			close(fd);
+		return false;
+	}
+
+	if(!S_ISREG(st.st_mode) || (size_t) st.st_size > max){
+		fprintf(stderr,"%s is %lld bytes,at most %zu fit\n",path,(long long) st.st_size,max);
+		close(fd);
+		return false;
+	}
+
+	size_t got = 0;
+	while(got < (size_t) st.st_size){
+		ssize_t n = read(fd,out + got,st.st_size - got);
+		if(n <= 0)
+			break;
+		got += n;
+	}
+	close(fd);
+
+	*len = got;
+	return got == (size_t) st.st_size;
+}
+
+// The archive `path` (or the one "archive.zip:ENTRY" is in) changed,it's opened again next time
+void rom_forget(const char *path){
+	const char *sep = strstr(path,".zip");
+	size_t n = sep ? (size_t) (sep - path + 4) : strlen(path);
+
+	for(int i = 0;i < ARCHIVES_MAX && archives[i].zip;i++){
+		if(strlen(archives[i].path) != n || strncmp(archives[i].path,path,n) != 0)
+			continue;
+		zip_close(archives[i].zip);
+		// Keep the used entries together,archive_open() stops at the first free one
+		int last = i;
+		while(last + 1 < ARCHIVES_MAX && archives[last + 1].zip)
+			last++;
+		archives[i] = archives[last];
+		archives[last].zip = NULL;
+		archives[last].path[0] = 0;
+		return;
+	}
+}
+
+// Reads a ROM of at most `max` bytes into `out`
+bool rom_read(const char *path,uint8_t *out,size_t max,size_t *len){
+	const char *sep = strstr(path,".zip:");
+
+	if(sep == NULL)
+		return read_file(path,out,max,len);
+
+	char archive[256];
+	size_t n = sep - path + 4;
+	if(n >= sizeof(archive))
+		return false;
+	memcpy(archive,path,n);
+	archive[n] = 0;
+
+	return read_archive(archive,sep + 5,out,max,len);
+}
@@ -0,0 +1,11 @@
+#ifndef ROM_H
+#define ROM_H
+
+#include<stdbool.h>
+#include<stddef.h>
+#include<stdint.h>
+
+bool rom_read(const char *path,uint8_t *out,size_t max,size_t *len);
+void rom_forget(const char *path);
+
+#endif
@@ -0,0 +1,122 @@
+#include<stdbool.h>
+#include<stdio.h>
+#include<string.h>
+
+#include"chip_8.h"
+#include"romdb.h"
+#include"sha1.h"
+
+/* The table is an open addressed hash table laid out at compile time: a ROM lives in the slot given
+ * by the first byte of its SHA-1 (mod ROMDB_SLOTS) or in the next free slot after it. A SHA-1 is 
+ * already uniformly distributed so it doesn't need hashing again and a lookup is a couple of
+ * memcmp()s at most, nothing gets parsed or built at startup.
+ *
+ * To add a ROM: get its hash with `sha1sum`, put it in its slot (or the next free one) and keep
+ * at least one slot empty so lookups of unknown ROMs terminate.
+ *
+ * Everything under ROMs/ is in here, the games in c8games.zip are byte for byte the same files.
+ */
+#define ROMDB_SLOTS 128
+
+const char *platform_names[] = {"CHIP-8","SCHIP","XO-CHIP"};
+
+static const struct RomInfo romdb[ROMDB_SLOTS] = {
+	[0x05] = {{0x05,0x0f,0x07,0xa5,0x43,0x71,0xda,0x79,0xf9,0x24,0xdd,0x02,0x27,0xb8,0x9d,0x07,0xb4,0xf2,0xae,0xd0},
+		"Hidden",PLATFORM_CHIP8,QUIRKS_CHIP8,KEYMAP_ARROWS,11}, // HIDDEN
+	[0x0D] = {{0x0d,0x0c,0xc1,0x29,0xda,0xd3,0xc4,0x5b,0xa6,0x72,0xf8,0x5f,0xec,0x71,0xa6,0x68,0x23,0x22,0x12,0xcc},
+		"Missile Command",PLATFORM_CHIP8,QUIRKS_CHIP8,KEYMAP_DEFAULT,11}, // MISSILE
+	[0x12] = {{0x12,0x93,0xdb,0x0c,0xcc,0xcb,0xe7,0xdd,0x3f,0xc5,0xa0,0x9a,0x2a,0xbc,0x5d,0x7b,0x17,0x5e,0x18,0xe0},
+		"Puzzle",PLATFORM_CHIP8,QUIRKS_CHIP8,KEYMAP_ARROWS,11}, // PUZZLE
+	[0x18] = {{0x18,0xb9,0xd1,0x5f,0x4c,0x15,0x9e,0x1f,0x0e,0xd5,0x8c,0x2d,0x8e,0xc1,0xd8,0x93,0x25,0xd3,0xa3,0xb6},
+		"Tank",PLATFORM_CHIP8,QUIRKS_CHIP8,KEYMAP_ARROWS,11}, // TANK
+	[0x1B] = {{0x1b,0xa5,0x86,0x56,0x81,0x0b,0x67,0xfd,0x13,0x1e,0xb9,0xaf,0x3e,0x39,0x87,0x86,0x3b,0xf2,0x6c,0x90},
+		"IBM logo",PLATFORM_CHIP8,QUIRKS_CHIP8,KEYMAP_DEFAULT,11}, // IBM_Logo.ch8
+	[0x1C] = {{0x1b,0xdb,0x4d,0xda,0xa7,0x04,0x92,0x66,0xfa,0x32,0x26,0x85,0x1f,0x28,0x85,0x5a,0x36,0x5c,0xfd,0x12},
+		"Syzygy",PLATFORM_CHIP8,QUIRKS_CHIP8,KEYMAP_ARROWS,11}, // SYZYGY
+	[0x26] = {{0xa6,0x06,0x11,0x33,0x96,0x61,0xe3,0xab,0x2d,0x8a,0xf0,0x24,0xad,0x1d,0xa5,0x88,0x0a,0x6f,0x86,0x65},
+		"Pong 2",PLATFORM_CHIP8,QUIRKS_CHIP8,KEYMAP_PONG,11}, // PONG2
+	[0x28] = {{0xa8,0xd6,0xe9,0xb1,0x97,0x6c,0x99,0xdd,0xc0,0xc4,0x81,0x88,0x28,0xa6,0xd3,0xcb,0x3a,0xe6,0xf3,0x48},
+		"wdl",PLATFORM_CHIP8,QUIRKS_CHIP8,KEYMAP_DEFAULT,11}, // wdl.ch8
+	[0x2D] = {{0x2d,0x10,0xc0,0x7b,0x53,0x2f,0x4f,0xa7,0xc0,0x7a,0x07,0x32,0x4b,0xa2,0x6c,0xa3,0x9f,0xe4,0x84,0xfd},
+		"Connect 4",PLATFORM_CHIP8,QUIRKS_CHIP8,KEYMAP_LEFT_RIGHT,11}, // CONNECT4
+	[0x2E] = {{0xad,0xe8,0x39,0x58,0x5d,0xde,0xb0,0xe3,0x63,0x31,0x77,0xdf,0x03,0xc1,0xd9,0x15,0x89,0xe6,0x29,0xeb},
+		"Vers",PLATFORM_CHIP8,QUIRKS_CHIP8,KEYMAP_DEFAULT,11}, // VERS
+	[0x30] = {{0x30,0xf2,0x7e,0x5c,0xee,0x5b,0x32,0x5f,0xd1,0x68,0x1e,0xe9,0x8a,0x14,0xde,0x60,0xbf,0xbe,0x95,0x1f},
+		"CHIP-8 splash screen",PLATFORM_CHIP8,QUIRKS_CHIP8,KEYMAP_DEFAULT,30}, // 1-chip8-logo.ch8
+	[0x32] = {{0xb2,0x32,0xef,0x88,0x0b,0xd6,0x06,0x0f,0xb4,0x5f,0xa6,0xef,0xfe,0xd7,0xed,0xf0,0xae,0x95,0x67,0x0e},
+		"Pong",PLATFORM_CHIP8,QUIRKS_CHIP8,KEYMAP_PONG,11}, // PONG
+	[0x33] = {{0xb2,0xda,0xcf,0x6d,0x85,0x78,0x5d,0x6c,0x23,0x15,0xce,0x44,0x99,0x12,0xc8,0xa8,0xa5,0x95,0x4e,0x2e},
+		"Opcode test (corax+)",PLATFORM_CHIP8,QUIRKS_CHIP8,KEYMAP_DEFAULT,30}, // test_opcode_corax_plus.ch8
+	[0x39] = {{0xb9,0x27,0x2a,0xe1,0xac,0xda,0xaa,0x79,0xab,0x64,0x9f,0x6b,0x48,0xb7,0x20,0x88,0xca,0x2b,0x1d,0x74},
+		"Maze",PLATFORM_CHIP8,QUIRKS_CHIP8,KEYMAP_DEFAULT,11}, // MAZE
+	[0x3D] = {{0xbd,0xb9,0x24,0x75,0xac,0xfe,0x11,0xbc,0x78,0x14,0xa2,0xf5,0xea,0xde,0x13,0xfc,0xd0,0x9b,0x75,0x6a},
+		"UFO",PLATFORM_CHIP8,QUIRKS_CHIP8,KEYMAP_DEFAULT,11}, // UFO
+	[0x42] = {{0x42,0x9d,0x45,0x5a,0x4b,0xc5,0x31,0x67,0x94,0x2b,0xf6,0xfd,0x93,0x4d,0x72,0xb0,0xf6,0x48,0xdc,0xe3},
+		"Tic-Tac-Toe",PLATFORM_CHIP8,QUIRKS_CHIP8,KEYMAP_DEFAULT,11}, // TICTAC
+	[0x45] = {{0x45,0x5b,0x9f,0xc6,0x9c,0xc0,0x6e,0x2b,0x5b,0x72,0xf7,0xd1,0xac,0x5f,0x6c,0x86,0xac,0x34,0x9e,0x77},
+		"Keypad test",PLATFORM_CHIP8,QUIRKS_CHIP8,KEYMAP_DEFAULT,30}, // 6-keypad.ch8
+	[0x52] = {{0x52,0x60,0xf8,0x93,0x1e,0x0e,0x9f,0x41,0xe5,0x55,0xb3,0x82,0xa1,0x4a,0x88,0x36,0x8e,0x3e,0xd8,0x86},
+		"Guess",PLATFORM_CHIP8,QUIRKS_CHIP8,KEYMAP_DEFAULT,11}, // GUESS
+	[0x54] = {{0xd4,0x0a,0xbc,0x54,0x37,0x4e,0x43,0x43,0x63,0x9f,0x99,0x3e,0x89,0x7e,0x00,0x90,0x4d,0xdf,0x85,0xd9},
+		"Blinky",PLATFORM_CHIP8,QUIRKS_SCHIP,KEYMAP_ARROWS,15}, // BLINKY
+	[0x55] = {{0x55,0xa6,0x71,0x6d,0xac,0xc2,0xf9,0x3d,0xce,0x3d,0x39,0xfb,0x8d,0x23,0x10,0x83,0x01,0x6a,0x1c,0xc0},
+		"Flags test",PLATFORM_CHIP8,QUIRKS_CHIP8,KEYMAP_DEFAULT,30}, // 4_flags.ch8
+	[0x56] = {{0xd6,0xfa,0x9d,0xc9,0x00,0x5d,0xc0,0x49,0x6f,0x39,0xba,0x52,0xfe,0xf5,0x6f,0x9f,0xd0,0xa5,0xa1,0x58},
+		"Kaleidoscope",PLATFORM_CHIP8,QUIRKS_CHIP8,KEYMAP_ARROWS,11}, // KALEID
+	[0x57] = {{0xd6,0x66,0x68,0x8a,0x8f,0xce,0x46,0x8a,0x7d,0x88,0xb5,0x36,0xbc,0x1e,0xf5,0xf3,0x5b,0xa1,0x20,0x31},
+		"Wipe Off",PLATFORM_CHIP8,QUIRKS_CHIP8,KEYMAP_LEFT_RIGHT,11}, // WIPEOFF
+	[0x59] = {{0xd9,0x79,0x85,0x8b,0xb9,0xff,0xd0,0x7b,0x48,0xf5,0x2f,0x92,0xa8,0xbc,0xac,0x01,0x99,0xf3,0x62,0x3e},
+		"Merlin",PLATFORM_CHIP8,QUIRKS_CHIP8,KEYMAP_DEFAULT,11}, // MERLIN
+	[0x5A] = {{0xda,0x71,0x0f,0x63,0x1f,0x8e,0x35,0x53,0x4d,0x0b,0x91,0x70,0xbc,0xf8,0x92,0xa6,0x0f,0x49,0xc4,0x3d},
+		"Vertical Brix",PLATFORM_CHIP8,QUIRKS_CHIP8,KEYMAP_PONG,11}, // VBRIX
+	[0x5F] = {{0x5f,0x51,0x80,0x84,0x74,0x4b,0xf3,0xcb,0x87,0x33,0xf6,0xe5,0x45,0x4d,0xfd,0x16,0x34,0x32,0x05,0x63},
+		"Tetris",PLATFORM_CHIP8,QUIRKS_CHIP8,KEYMAP_TETRIS,11}, // TETRIS
+	[0x62] = {{0xe2,0x14,0x9c,0xb8,0x36,0x13,0x1a,0x14,0x2c,0xa7,0xe2,0xdc,0x2f,0x22,0x83,0x38,0x1a,0xe5,0xfa,0xaa},
+		"Quirks test",PLATFORM_CHIP8,QUIRKS_CHIP8,KEYMAP_DEFAULT,30}, // 5-quirks.ch8
+	[0x6A] = {{0xea,0x9a,0xf3,0xc0,0x9b,0x0d,0x9e,0x26,0x5f,0xcd,0x92,0xbc,0xc5,0xd5,0x1a,0x29,0x39,0xfd,0xf2,0x7a},
+		"15 Puzzle",PLATFORM_CHIP8,QUIRKS_CHIP8,KEYMAP_DEFAULT,11}, // 15PUZZLE
+	[0x6F] = {{0x6f,0x65,0x09,0xf3,0x82,0x20,0xe0,0x57,0xa7,0xe3,0x2e,0xbb,0x22,0xdd,0x35,0x3c,0x10,0x78,0xe3,0xe7},
+		"Blitz",PLATFORM_CHIP8,QUIRKS_CHIP8,KEYMAP_DEFAULT,11}, // BLITZ
+	[0x71] = {{0xf1,0x37,0x66,0xc1,0x4a,0xeb,0x02,0xad,0x8d,0x4d,0x10,0x3c,0xb5,0xea,0xdd,0x28,0x2d,0x20,0xcd,0xdc},
+		"Brix",PLATFORM_CHIP8,QUIRKS_CHIP8,KEYMAP_LEFT_RIGHT,11}, // BRIX
+	[0x72] = {{0xf1,0x00,0x19,0x7f,0x0f,0x2f,0x05,0xb4,0xf3,0xc8,0xc3,0x1a,0xb9,0xc2,0xc3,0x93,0x0d,0x3e,0x95,0x71},
+		"Space Invaders",PLATFORM_CHIP8,QUIRKS_SCHIP,KEYMAP_LEFT_RIGHT,15}, // INVADERS
+	[0x73] = {{0xf1,0xcf,0xcf,0xfe,0x19,0x37,0xed,0x6d,0xd6,0xee,0xed,0x1a,0x7f,0x85,0xdf,0xc7,0x77,0xbd,0xa7,0x00},
+		"Opcode test",PLATFORM_CHIP8,QUIRKS_CHIP8,KEYMAP_DEFAULT,30}, // test_opcode.ch8
+	[0x79] = {{0xf9,0xad,0x6b,0xa2,0x7c,0xe0,0xef,0xd1,0xd2,0xa0,0xe5,0xd2,0x5b,0x73,0x27,0x96,0xc8,0xaf,0xeb,0x6f},
+		"CHIP-8 test ROM",PLATFORM_CHIP8,QUIRKS_CHIP8,KEYMAP_DEFAULT,30}, // chip_8_test_rom.ch8
+	[0x7D] = {{0x7d,0xa3,0xeb,0xa5,0x2a,0x8d,0x80,0x25,0xdd,0xf1,0x4e,0xe4,0x0d,0x28,0xf1,0x51,0x58,0x55,0x29,0xa0},
+		"Piper",PLATFORM_CHIP8,QUIRKS_CHIP8,KEYMAP_ARROWS,11}, // piper.ch8
+	[0x7F] = {{0x7f,0xb6,0x96,0x47,0xe6,0xb1,0x0e,0x2b,0x12,0xf9,0x35,0x7d,0x5c,0x1c,0x17,0x73,0x49,0x02,0x82,0x36},
+		"Dodge",PLATFORM_CHIP8,QUIRKS_CHIP8,KEYMAP_ARROWS,11}, // dodge.ch8
+};
+
+const struct RomInfo *romdb_find(const uint8_t sha1[20]);
+const struct RomInfo *romdb_lookup(const uint8_t *rom,size_t len);
+
+// Returns the entry with the given hash or NULL if the ROM isn't known
+const struct RomInfo *romdb_find(const uint8_t sha1[20]){
+	for(unsigned i = sha1[0] % ROMDB_SLOTS;romdb[i].title != NULL;i = (i + 1) % ROMDB_SLOTS)
+		if(memcmp(romdb[i].sha1,sha1,20) == 0)
+			return &romdb[i];
+
+	return NULL;
+}
+
+const struct RomInfo *romdb_lookup(const uint8_t *rom,size_t len){
+	uint8_t digest[20];
+	sha1(rom,len,digest);
+
+	const struct RomInfo *info = romdb_find(digest);
+
+	if(debug_flag){
+		char hex[41];
+		sha1_hex(digest,hex);
+		if(info)
+			printf("ROM %s is \"%s\" (%s)\n",hex,info->title,platform_names[info->platform]);
+		else
+			printf("ROM %s isn't in the ROM database\n",hex);
+	}
+
+	return info;
+}
@@ -0,0 +1,38 @@
+#ifndef ROMDB_H
+#define ROMDB_H
+
+#include<stddef.h>
+#include<stdint.h>
+
+enum{
+	PLATFORM_CHIP8,
+	PLATFORM_SCHIP,
+	PLATFORM_XOCHIP
+};
+
+// Which of display.h's keymaps a ROM uses, here so the database doesn't need SDL
+enum{
+	KEYMAP_DEFAULT,
+	KEYMAP_ARROWS,
+	KEYMAP_LEFT_RIGHT,
+	KEYMAP_PONG,
+	KEYMAP_TETRIS,
+	KEYMAP_COUNT
+};
+
+// What a ROM needs to run correctly, keyed by the SHA-1 of the ROM's bytes
+struct RomInfo{
+	uint8_t sha1[20];
+	const char *title;
+	uint8_t platform;
+	uint8_t quirks; // index into quirk_profiles
+	uint8_t keymap; // index into keymaps
+	uint16_t speed; // instructions per frame
+};
+
+extern const char *platform_names[];
+
+const struct RomInfo *romdb_find(const uint8_t sha1[20]);
+const struct RomInfo *romdb_lookup(const uint8_t *rom,size_t len);
+
+#endif
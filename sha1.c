@@ -0,0 +1,88 @@
+#include<stdint.h>
+#include<stdio.h>
+#include<string.h>
+
+#include"sha1.h"
+
+void sha1(const uint8_t *data,size_t len,uint8_t digest[20]);
+void sha1_hex(const uint8_t digest[20],char hex[41]);
+
+#define ROL(x,n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+// Processes one 64 byte block of the message
+static void sha1_block(uint32_t h[5],const uint8_t *block){
+	uint32_t w[80];
+
+	for(int i = 0;i < 16;i++)
+		w[i] = (uint32_t)block[i*4] << 24 | (uint32_t)block[i*4 + 1] << 16 | 
+		       (uint32_t)block[i*4 + 2] << 8 | block[i*4 + 3];
+	for(int i = 16;i < 80;i++)
+		w[i] = ROL(w[i-3] ^ w[i-8] ^ w[i-14] ^ w[i-16],1);
+
+	uint32_t a = h[0],b = h[1],c = h[2],d = h[3],e = h[4];
+
+	for(int i = 0;i < 80;i++){
+		uint32_t f,k;
+
+		if(i < 20){
+			f = (b & c) | (~b & d);
+			k = 0x5A827999;
+		}else if(i < 40){
+			f = b ^ c ^ d;
+			k = 0x6ED9EBA1;
+		}else if(i < 60){
+			f = (b & c) | (b & d) | (c & d);
+			k = 0x8F1BBCDC;
+		}else{
+			f = b ^ c ^ d;
+			k = 0xCA62C1D6;
+		}
+
+		uint32_t t = ROL(a,5) + f + e + k + w[i];
+		e = d;
+		d = c;
+		c = ROL(b,30);
+		b = a;
+		a = t;
+	}
+
+	h[0] += a;
+	h[1] += b;
+	h[2] += c;
+	h[3] += d;
+	h[4] += e;
+}
+
+void sha1(const uint8_t *data,size_t len,uint8_t digest[20]){
+	uint32_t h[5] = {0x67452301,0xEFCDAB89,0x98BADCFE,0x10325476,0xC3D2E1F0};
+	uint8_t tail[128] = {0};
+	size_t full = len & ~(size_t)63;
+
+	for(size_t i = 0;i < full;i += 64)
+		sha1_block(h,data + i);
+
+	// The last (partial) block gets a 1 bit,zeros and the length in bits appended to it
+	size_t rest = len - full;
+	memcpy(tail,data + full,rest);
+	tail[rest] = 0x80;
+
+	size_t tail_len = rest < 56 ? 64 : 128;
+	uint64_t bits = (uint64_t) len * 8;
+	for(int i = 0;i < 8;i++)
+		tail[tail_len - 1 - i] = bits >> (i * 8);
+
+	for(size_t i = 0;i < tail_len;i += 64)
+		sha1_block(h,tail + i);
+
+	for(int i = 0;i < 5;i++){
+		digest[i*4] = h[i] >> 24;
+		digest[i*4 + 1] = h[i] >> 16;
+		digest[i*4 + 2] = h[i] >> 8;
+		digest[i*4 + 3] = h[i];
+	}
+}
+
+void sha1_hex(const uint8_t digest[20],char hex[41]){
+	for(int i = 0;i < 20;i++)
+		sprintf(&hex[i*2],"%02x",digest[i]);
+}
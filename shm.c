@@ -0,0 +1,168 @@
+#include<fcntl.h>
+#include<stdatomic.h>
+#include<stdbool.h>
+#include<stdio.h>
+#include<string.h>
+#include<sys/mman.h>
+#include<time.h>
+#include<unistd.h>
+
+#include"chip_8.h"
+#include"shm.h"
+
+/* Exports the machine to a POSIX shared memory segment once a frame so other programs (a debugger
+ * UI,a bot,a metrics scraper...) can mmap it read only and look at it while it runs. Writes are 
+ * guarded by a seqlock: the sequence number is odd while a frame is being written and readers 
+ * retry until they copied a frame with the same even number on both sides (see shm_read()). The
+ * emulator never waits on a reader.
+ *
+ * The segment has a layout of its own (fixed size fields,a byte per pixel) rather than struct Chip8,
+ * so a frame is copied into it. Memory is copied a 256 byte page at a time and only the pages
+ * written since the last frame (chip8_wrote()'s generations),the display is one memcpy: usually
+ * the 2K of the display and the ~100 bytes of registers,a few hundred nanoseconds a frame.
+ *
+ * The segment is /dev/shm/<name> on Linux and is removed when the emulator exits.*/
+
+bool shm_export_open(const char *name);
+void shm_export(const struct Chip8 *c8);
+void shm_export_close(void);
+int shm_monitor(const char *name);
+
+static struct SharedState *shared;
+static char shared_name[256];
+static uint64_t exported[16]; // the generation of each page in the segment
+static bool exported_all; // ...once a first frame was exported
+
+// shm_open wants a name like "/chip8"
+static void shm_name(const char *name,char out[256]){
+	snprintf(out,256,"%s%s",name[0] == '/' ? "" : "/",name);
+}
+
+bool shm_export_open(const char *name){
+	shm_name(name,shared_name);
+
+	int fd = shm_open(shared_name,O_CREAT | O_RDWR,0644);
+	if(fd < 0){
+		perror(shared_name);
+		return false;
+	}
+
+	if(ftruncate(fd,sizeof(struct SharedState)) < 0){
+		perror(shared_name);
+		close(fd);
+		return false;
+	}
+
+	shared = mmap(NULL,sizeof(struct SharedState),PROT_READ | PROT_WRITE,MAP_SHARED,fd,0);
+	close(fd);
+	if(shared == MAP_FAILED){
+		perror(shared_name);
+		shared = NULL;
+		return false;
+	}
+
+	memset(shared,0,sizeof(*shared));
+	exported_all = false;
+	shared->magic = SHM_MAGIC;
+	shared->version = SHM_VERSION;
+
+	if(debug_flag)
+		fprintf(stderr,"Exporting the machine to shared memory %s\n",shared_name);
+
+	return true;
+}
+
+// Called once per emulated frame
+void shm_export(const struct Chip8 *c8){
+	if(shared == NULL)
+		return;
+
+	struct SharedMachine *m = &shared->machine;
+	uint32_t seq = atomic_load_explicit(&shared->seq,memory_order_relaxed);
+
+	atomic_store_explicit(&shared->seq,seq + 1,memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+
+	m->frame++;
+	memcpy(m->V,c8->registers.V,16);
+	m->I = c8->registers.I;
+	m->PC = c8->registers.PC;
+	for(int i = 0;i < 16;i++)
+		m->stack[i] = c8->stack[i];
+	m->sp = c8->sp;
+	m->delay_timer = c8->delay_timer;
+	m->sound_timer = c8->sound_timer;
+	for(int i = 0;i < 16;i++)
+		m->keypad[i] = c8->keypad[i];
+	memcpy(m->display,c8->display,sizeof(m->display)); // bool is a byte,0 or 1
+	for(int p = 0;p < 16;p++)
+		if(!exported_all || c8->generation[p] != exported[p]){
+			memcpy(m->memory + p * 256,c8->memory + p * 256,256);
+			exported[p] = c8->generation[p];
+		}
+	exported_all = true;
+
+	atomic_store_explicit(&shared->seq,seq + 2,memory_order_release);
+}
+
+void shm_export_close(void){
+	if(shared == NULL)
+		return;
+
+	munmap(shared,sizeof(*shared));
+	shm_unlink(shared_name);
+	shared = NULL;
+}
+
+/* A minimal external monitor: attaches to a running emulator's segment read only and prints its 
+ * registers twice a second until the emulator goes away.*/
+int shm_monitor(const char *name){
+	char path[256];
+	shm_name(name,path);
+
+	int fd = shm_open(path,O_RDONLY,0);
+	if(fd < 0){
+		perror(path);
+		return -1;
+	}
+
+	const struct SharedState *s = mmap(NULL,sizeof(*s),PROT_READ,MAP_SHARED,fd,0);
+	close(fd);
+	if(s == MAP_FAILED){
+		perror(path);
+		return -1;
+	}
+
+	if(s->magic != SHM_MAGIC || s->version != SHM_VERSION){
+		fprintf(stderr,"%s isn't a CHIP-8 state export\n",path);
+		return -1;
+	}
+
+	struct SharedMachine m;
+	uint64_t last = UINT64_MAX;
+
+	for(;;){
+		shm_read(s,&m);
+
+		if(m.frame == last){
+			// Not a single frame in half a second,see if the emulator is still there
+			int probe = shm_open(path,O_RDONLY,0);
+			if(probe < 0)
+				break;
+			close(probe);
+		}
+		last = m.frame;
+
+		printf("frame %llu PC %03X I %03X sp %u DT %3u ST %3u V",(unsigned long long) m.frame,
+		       m.PC,m.I,m.sp,m.delay_timer,m.sound_timer);
+		for(int i = 0;i < 16;i++)
+			printf(" %02X",m.V[i]);
+		printf("\n");
+		fflush(stdout);
+
+		nanosleep(&(struct timespec){.tv_nsec = 500000000},NULL);
+	}
+
+	munmap((void *) s,sizeof(*s));
+	return 0;
+}
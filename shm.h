@@ -0,0 +1,58 @@
+#ifndef SHM_H
+#define SHM_H
+
+#include<stdatomic.h>
+#include<stdbool.h>
+#include<stdint.h>
+#include<string.h>
+
+/* The machine state as exported to shared memory (see shm.c). Fixed size fields only so other
+ * programs can use this header on its own to read it. */
+
+#define SHM_MAGIC 0x4D533843 // "C8SM"
+#define SHM_VERSION 1
+
+struct SharedMachine{
+	uint64_t frame; // emulated frames so far
+	uint8_t V[16];
+	uint16_t I;
+	uint16_t PC;
+	uint16_t stack[16];
+	uint8_t sp;
+	uint8_t delay_timer;
+	uint8_t sound_timer;
+	uint8_t keypad[16];
+	uint8_t display[32][64]; // 1 for a lit pixel
+	uint8_t memory[0x1000];
+};
+
+struct SharedState{
+	uint32_t magic;
+	uint32_t version;
+	_Atomic uint32_t seq; // odd while the emulator is writing `machine`
+	struct SharedMachine machine;
+};
+
+struct Chip8;
+
+bool shm_export_open(const char *name);
+void shm_export(const struct Chip8 *c8);
+void shm_export_close(void);
+int shm_monitor(const char *name);
+
+/* Seqlock read: copies a consistent snapshot into `out`, retrying while the emulator is in the 
+ * middle of a write. Never blocks the emulator.*/
+static inline void shm_read(const struct SharedState *s,struct SharedMachine *out){
+	uint32_t before,after;
+
+	do{
+		before = atomic_load_explicit(&s->seq,memory_order_acquire);
+		if(before & 1)
+			continue;
+		memcpy(out,&s->machine,sizeof(*out));
+		atomic_thread_fence(memory_order_acquire);
+		after = atomic_load_explicit(&s->seq,memory_order_relaxed);
+	}while((before & 1) || before != after);
+}
+
+#endif
@@ -0,0 +1,260 @@
+#include<SDL3/SDL.h>
+#include<stdbool.h>
+#include<stdint.h>
+#include<stdio.h>
+#include<string.h>
+#include<termios.h>
+#include<unistd.h>
+
+#include"chip_8.h"
+#include"display.h"
+#include"metrics.h"
+#include"terminal.h"
+
+/* Terminal frontend,for watching a machine over SSH. The display is drawn with half blocks or
+ * braille and every frame only the cells that changed since the last one are sent: a cursor move 
+ * (skipped when the cell is right after the last one written) and the character. The whole frame
+ * goes out in one write(). A full redraw is ~3KB of half blocks,~180KB/s at 60Hz,a moving sprite 
+ * is a few dozen bytes.
+ *
+ * Terminals only send key presses,no releases. A key counts as held for TERMINAL_HOLD_FRAMES after
+ * its last press,with the terminal's key repeat that keeps it held while it's held down.*/
+
+#define TERMINAL_HOLD_FRAMES 8
+#define CELLS_MAX (DISPLAY_WIDTH * DISPLAY_HEIGHT / 2)
+#define OUT_MAX (CELLS_MAX * 16 + 256)
+
+bool terminal_turbo;
+
+bool terminal_open(int mode);
+void terminal_close(void);
+bool terminal_events(bool keypad[16]);
+size_t terminal_render(const struct Chip8 *c8,const char *status);
+void terminal_report(FILE *out);
+
+static struct{
+	bool open;
+	int mode;
+	unsigned columns,rows; // in cells
+	struct termios saved;
+	uint8_t cells[CELLS_MAX]; // what the terminal is showing,0xFF if unknown
+	char status[160];
+	char rate[32]; // bytes per frame over the last second,shown in the status line
+	uint64_t rate_frames,rate_bytes;
+	uint8_t hold[16]; // frames each key stays held
+	char out[OUT_MAX];
+
+	uint64_t frames;
+	uint64_t bytes;
+	size_t full_redraw; // bytes of the first (full) frame,for comparison
+	struct Histogram frame_bytes;
+} term;
+
+// The hex keypad layout of game_events()
+static const SDL_Scancode hex_keys[16] = {
+	SDL_SCANCODE_X,SDL_SCANCODE_1,SDL_SCANCODE_2,SDL_SCANCODE_3,SDL_SCANCODE_Q,SDL_SCANCODE_W,
+	SDL_SCANCODE_E,SDL_SCANCODE_A,SDL_SCANCODE_S,SDL_SCANCODE_D,SDL_SCANCODE_Z,SDL_SCANCODE_C,
+	SDL_SCANCODE_4,SDL_SCANCODE_R,SDL_SCANCODE_F,SDL_SCANCODE_V
+};
+
+static void terminal_write(const char *buf,size_t len){
+	while(len){
+		ssize_t n = write(STDOUT_FILENO,buf,len);
+		if(n <= 0)
+			return;
+		buf += n;
+		len -= n;
+	}
+}
+
+bool terminal_open(int mode){
+	if(!isatty(STDIN_FILENO) || !isatty(STDOUT_FILENO)){
+		if(debug_flag)
+			fprintf(stderr,"--terminal needs stdin and stdout to be a terminal\n");
+		return false;
+	}
+	if(tcgetattr(STDIN_FILENO,&term.saved) != 0){
+		if(debug_flag)
+			perror("tcgetattr");
+		return false;
+	}
+
+	// Raw,non blocking reads: terminal_events() picks up whatever arrived since the last frame
+	struct termios raw = term.saved;
+	raw.c_iflag &= ~(IXON | ICRNL | INLCR | ISTRIP);
+	raw.c_lflag &= ~(ICANON | ECHO | ISIG | IEXTEN);
+	raw.c_cc[VMIN] = 0;
+	raw.c_cc[VTIME] = 0;
+	if(tcsetattr(STDIN_FILENO,TCSAFLUSH,&raw) != 0){
+		if(debug_flag)
+			perror("tcsetattr");
+		return false;
+	}
+
+	term.open = true;
+	term.mode = mode;
+	term.columns = mode == TERMINAL_BRAILLE ? DISPLAY_WIDTH / 2 : DISPLAY_WIDTH;
+	term.rows = mode == TERMINAL_BRAILLE ? DISPLAY_HEIGHT / 4 : DISPLAY_HEIGHT / 2;
+	memset(term.cells,0xFF,sizeof(term.cells));
+
+	// Alternate screen,hidden cursor,cleared
+	static const char start[] = "\x1b[?1049h\x1b[?25l\x1b[2J";
+	terminal_write(start,sizeof(start) - 1);
+	return true;
+}
+
+void terminal_close(void){
+	if(!term.open)
+		return;
+	static const char end[] = "\x1b[0m\x1b[?25h\x1b[?1049l";
+	terminal_write(end,sizeof(end) - 1);
+	tcsetattr(STDIN_FILENO,TCSAFLUSH,&term.saved);
+	term.open = false;
+}
+
+static void press(SDL_Scancode key,bool keypad[16]){
+	for(int i = 0;i < 16;i++)
+		if(hex_keys[i] == key || (keymaps[keymap].keys[i] != SDL_SCANCODE_UNKNOWN &&
+					  keymaps[keymap].keys[i] == key)){
+			term.hold[i] = TERMINAL_HOLD_FRAMES;
+			keypad[i] = true;
+		}
+}
+
+/* Reads the keys pressed since the last call and updates the keypad,once per frame. Returns false
+ * on Escape or Ctrl-C.*/
+bool terminal_events(bool keypad[16]){
+	unsigned char buf[64];
+	ssize_t n;
+
+	for(int i = 0;i < 16;i++)
+		if(term.hold[i] && --term.hold[i] == 0)
+			keypad[i] = false;
+
+	while((n = read(STDIN_FILENO,buf,sizeof(buf))) > 0){
+		for(ssize_t i = 0;i < n;i++){
+			unsigned char c = buf[i];
+			if(c == 0x1b){
+				// Arrows are ESC [ A-D (or ESC O A-D),a lone Escape quits
+				if(i + 2 < n && (buf[i + 1] == '[' || buf[i + 1] == 'O')){
+					static const SDL_Scancode arrows[4] = {
+						SDL_SCANCODE_UP,SDL_SCANCODE_DOWN,SDL_SCANCODE_RIGHT,SDL_SCANCODE_LEFT
+					};
+					if(buf[i + 2] >= 'A' && buf[i + 2] <= 'D')
+						press(arrows[buf[i + 2] - 'A'],keypad);
+					i += 2;
+					continue;
+				}
+				return false;
+			}
+			if(c == 3) // Ctrl-C,ISIG is off
+				return false;
+			if(c == '\t')
+				terminal_turbo = !terminal_turbo;
+			else if(c == ' ')
+				press(SDL_SCANCODE_SPACE,keypad);
+			else if(c >= 'A' && c <= 'Z')
+				press(SDL_SCANCODE_A + (c - 'A'),keypad);
+			else if(c >= 'a' && c <= 'z')
+				press(SDL_SCANCODE_A + (c - 'a'),keypad);
+			else if(c >= '1' && c <= '9')
+				press(SDL_SCANCODE_1 + (c - '1'),keypad);
+			else if(c == '0')
+				press(SDL_SCANCODE_0,keypad);
+		}
+	}
+
+	return true;
+}
+
+// The cell at column `x` and row `y`: 2 bits of half blocks or 8 bits of braille dots
+static inline uint8_t cell(const struct Chip8 *c8,unsigned x,unsigned y){
+	if(term.mode == TERMINAL_HALF_BLOCKS)
+		return c8->display[2 * y][x] | c8->display[2 * y + 1][x] << 1;
+
+	// Braille dot numbering: 1 2 3 7 down the left column,4 5 6 8 down the right
+	const bool (*d)[DISPLAY_WIDTH] = &c8->display[4 * y];
+	unsigned l = 2 * x,r = l + 1;
+	return d[0][l] | d[1][l] << 1 | d[2][l] << 2 | d[0][r] << 3 | d[1][r] << 4 | d[2][r] << 5 |
+	       d[3][l] << 6 | d[3][r] << 7;
+}
+
+static inline char *put_cell(char *p,uint8_t v){
+	if(term.mode == TERMINAL_HALF_BLOCKS){
+		static const char *const blocks[4] = {" ","▀","▄","█"};
+		const char *s = blocks[v];
+		while(*s)
+			*p++ = *s++;
+		return p;
+	}
+	if(v == 0){ // a blank braille cell,but a space is a third of the bytes
+		*p++ = ' ';
+		return p;
+	}
+	unsigned u = 0x2800 + v; // UTF-8,always 3 bytes here
+	*p++ = 0xE0 | u >> 12;
+	*p++ = 0x80 | (u >> 6 & 0x3F);
+	*p++ = 0x80 | (u & 0x3F);
+	return p;
+}
+
+/* Draws the display with one write(),below it the byte rate and `status` (may be NULL) when they
+ * changed. Returns the bytes written.*/
+size_t terminal_render(const struct Chip8 *c8,const char *status){
+	char *p = term.out;
+	unsigned cursor_x = ~0u,cursor_y = ~0u; // where the terminal's cursor is,if known
+
+	for(unsigned y = 0;y < term.rows;y++){
+		for(unsigned x = 0;x < term.columns;x++){
+			uint8_t v = cell(c8,x,y);
+			uint8_t *shown = &term.cells[y * term.columns + x];
+			if(*shown == v)
+				continue;
+			*shown = v;
+			if(cursor_y == y && cursor_x < x)
+				p += sprintf(p,"\x1b[%uC",x - cursor_x); // shorter than an absolute move
+			else if(cursor_x != x || cursor_y != y)
+				p += sprintf(p,"\x1b[%u;%uH",y + 1,x + 1);
+			p = put_cell(p,v);
+			cursor_x = x + 1;
+			cursor_y = y;
+		}
+	}
+
+	char line[sizeof(term.status)];
+	snprintf(line,sizeof(line),"%s %s",term.rate,status ? status : "");
+	if(strcmp(line,term.status) != 0){
+		memcpy(term.status,line,sizeof(line));
+		p += sprintf(p,"\x1b[%u;1H\x1b[2K%.*s",term.rows + 1,DISPLAY_WIDTH,term.status);
+	}
+
+	size_t len = p - term.out;
+	if(len)
+		terminal_write(term.out,len);
+
+	if(term.frames++ == 0)
+		term.full_redraw = len;
+	term.bytes += len;
+	histogram_add(&term.frame_bytes,len);
+	term.rate_bytes += len;
+	if(++term.rate_frames == 60){
+		snprintf(term.rate,sizeof(term.rate),"%lluB/frame",(unsigned long long) term.rate_bytes / 60);
+		term.rate_frames = term.rate_bytes = 0;
+	}
+	return len;
+}
+
+// Bytes per frame sent to the terminal
+void terminal_report(FILE *out){
+	if(!term.frames)
+		return;
+	fprintf(out,"terminal_frames %llu\n",(unsigned long long) term.frames);
+	fprintf(out,"terminal_bytes %llu\n",(unsigned long long) term.bytes);
+	fprintf(out,"terminal_bytes_per_frame mean %.1f p50 %llu p99 %llu max %llu\n",
+		(double) term.bytes / term.frames,
+		(unsigned long long) histogram_percentile(&term.frame_bytes,50),
+		(unsigned long long) histogram_percentile(&term.frame_bytes,99),
+		(unsigned long long) term.frame_bytes.max);
+	fprintf(out,"terminal_bytes_per_second %.0f (a full redraw every frame: %zu)\n",
+		(double) term.bytes / term.frames * 60,term.full_redraw * 60);
+}
@@ -0,0 +1,21 @@
+#ifndef TERMINAL_H
+#define TERMINAL_H
+
+#include<stdio.h>
+
+#include"chip_8.h"
+
+enum{
+	TERMINAL_HALF_BLOCKS, // ▀▄█,a cell is 1x2 pixels: 64x16 cells
+	TERMINAL_BRAILLE,     // a cell is 2x4 pixels: 32x8 cells
+};
+
+extern bool terminal_turbo;
+
+bool terminal_open(int mode);
+void terminal_close(void);
+bool terminal_events(bool keypad[16]);
+size_t terminal_render(const struct Chip8 *c8,const char *status);
+void terminal_report(FILE *out);
+
+#endif
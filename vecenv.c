@@ -0,0 +1,426 @@
+#include<stdbool.h>
+#include<stdint.h>
+#include<stdlib.h>
+#include<string.h>
+
+#include"chip_8.h"
+#include"vecenv.h"
+
+/* Many machines stepped in lockstep for reinforcement learning:
+ *
+ *   env = vecenv_new(N,&machine,&config);   // machine has the ROM loaded
+ *   vecenv_reset(env,seeds);
+ *   for(;;){
+ *       vecenv_step(env,actions);           // actions[i]: 0 nothing,1-16 hold key 0-F
+ *       ... env->frames[i],env->rewards[i],env->dones[i]
+ *   }
+ *
+ * The reward is how much the score (a byte or two of memory the caller points at) went up during
+ * the step. A machine that's done is reset on the next step with its seed moved on,so the batch
+ * never has to wait for one machine.
+ *
+ * The registers are a structure of arrays (env->V[x][i],env->I[i],env->PC[i]) and the machines
+ * run in lockstep,an instruction at a time for all of them: consecutive machines at the same 
+ * instruction run it together,16 at a time through GCC's vector extensions,when it only touches
+ * registers. The rest (draws,the stack,memory,keys,timers,CXNN) goes through the profile's 
+ * interpreter one machine at a time. Machines that were
+ * reset together stay together until their keys or random numbers send them different ways,once
+ * the machines are mostly on their own the rest of the frame is run a machine at a time.
+ *
+ * With config.paged the machines are struct PagedChip8s instead,sharing the start machine's memory
+ * and each keeping only the pages it wrote to,for batches too big to fit in the caches otherwise.
+ * Those are run a machine at a time by the paged interpreters.*/
+
+typedef uint8_t u8x16 __attribute__((vector_size(16)));
+typedef int8_t i8x16 __attribute__((vector_size(16)));
+typedef uint16_t u16x16 __attribute__((vector_size(32)));
+typedef int16_t i16x16 __attribute__((vector_size(32)));
+
+struct VecEnv *vecenv_new(unsigned n,const struct Chip8 *start,const struct VecEnvConfig *config);
+void vecenv_free(struct VecEnv *env);
+void vecenv_reset(struct VecEnv *env,const uint32_t *seeds);
+void vecenv_step(struct VecEnv *env,const uint8_t *actions);
+
+struct VecEnv *vecenv_new(unsigned n,const struct Chip8 *start,const struct VecEnvConfig *config){
+	struct VecEnv *env = calloc(1,sizeof(*env));
+	if(env == NULL)
+		return NULL;
+
+	env->n = n;
+	env->stride = (n + 15) & ~15u;
+	env->config = *config;
+	env->start = *start;
+	if(config->paged){
+		env->paged = calloc(n,sizeof(*env->paged));
+	}else{
+		env->machines = malloc(n * sizeof(*env->machines));
+		// Padded so a whole vector can be read and written back at the end of every array
+		if((env->V[0] = calloc(16,env->stride)) != NULL)
+			for(int x = 1;x < 16;x++)
+				env->V[x] = env->V[0] + x * env->stride;
+		env->I = calloc(env->stride,sizeof(*env->I));
+		env->PC = calloc(env->stride,sizeof(*env->PC));
+		env->ops = calloc(n,sizeof(*env->ops));
+		env->active = calloc(n,sizeof(*env->active));
+		if(!env->V[0] || !env->I || !env->PC || !env->ops || !env->active){
+			vecenv_free(env);
+			return NULL;
+		}
+	}
+	env->frames = calloc(n,sizeof(*env->frames));
+	env->rewards = calloc(n,sizeof(*env->rewards));
+	env->dones = calloc(n,sizeof(*env->dones));
+	env->seeds = calloc(n,sizeof(*env->seeds));
+	env->episode_frames = calloc(n,sizeof(*env->episode_frames));
+	env->scores = calloc(n,sizeof(*env->scores));
+
+	if((!env->machines && !env->paged) || !env->frames || !env->rewards || !env->dones || !env->seeds ||
+	   !env->episode_frames || !env->scores){
+		vecenv_free(env);
+		return NULL;
+	}
+
+	return env;
+}
+
+void vecenv_free(struct VecEnv *env){
+	if(env == NULL)
+		return;
+
+	free(env->machines);
+	free(env->V[0]);
+	free(env->I);
+	free(env->PC);
+	free(env->ops);
+	free(env->active);
+	free(env->paged);
+	paged_pool_free(&env->pool);
+	free(env->frames);
+	free(env->rewards);
+	free(env->dones);
+	free(env->seeds);
+	free(env->episode_frames);
+	free(env->scores);
+	free(env);
+}
+
+static inline uint8_t peek(const struct VecEnv *env,unsigned i,unsigned addr){
+	if(env->paged)
+		return paged_load(&env->paged[i],addr);
+	return env->machines[i].memory[addr & 0xFFF];
+}
+
+static int32_t score(const struct VecEnv *env,unsigned i){
+	const struct VecEnvConfig *cfg = &env->config;
+
+	if(cfg->reward_bytes == 1)
+		return peek(env,i,cfg->reward_addr);
+	if(cfg->reward_bytes == 2)
+		return peek(env,i,cfg->reward_addr) << 8 | peek(env,i,cfg->reward_addr + 1);
+	return 0;
+}
+
+// 64 bools per row into one word
+static void pack_frame(const struct Chip8 *c8,uint64_t rows[DISPLAY_HEIGHT]){
+	for(int y = 0;y < DISPLAY_HEIGHT;y++){
+		uint64_t row = 0;
+		for(int x = 0;x < DISPLAY_WIDTH;x++)
+			row = row << 1 | c8->display[y][x];
+		rows[y] = row;
+	}
+}
+
+// Machine i's registers between the register file and its struct Chip8
+static inline void gather(const struct VecEnv *env,unsigned i,struct Chip8 *c8){
+	for(int x = 0;x < 16;x++)
+		c8->registers.V[x] = env->V[x][i];
+	c8->registers.I = env->I[i];
+	c8->registers.PC = env->PC[i];
+}
+
+static inline void scatter(struct VecEnv *env,unsigned i,const struct Chip8 *c8){
+	for(int x = 0;x < 16;x++)
+		env->V[x][i] = c8->registers.V[x];
+	env->I[i] = c8->registers.I;
+	env->PC[i] = c8->registers.PC;
+}
+
+static void reset_one(struct VecEnv *env,unsigned i,uint32_t seed){
+	if(env->paged){
+		struct PagedChip8 *m = &env->paged[i];
+		if(m->own) // an earlier episode
+			paged_release(m,&env->pool,env->start.memory);
+		paged_init(m,&env->start,env->start.memory);
+		m->rng = seed ? seed : 1;
+		memcpy(env->frames[i],m->display,sizeof(m->display));
+	}else{
+		struct Chip8 *c8 = &env->machines[i];
+		*c8 = env->start;
+		c8->rng = seed ? seed : 1;
+		scatter(env,i,c8);
+		pack_frame(c8,env->frames[i]);
+	}
+	env->seeds[i] = seed;
+	env->episode_frames[i] = 0;
+	env->scores[i] = score(env,i);
+}
+
+// `seeds` seed CXNN of each machine,NULL for 1..N
+void vecenv_reset(struct VecEnv *env,const uint32_t *seeds){
+	for(unsigned i = 0;i < env->n;i++){
+		reset_one(env,i,seeds ? seeds[i] : i + 1);
+		env->rewards[i] = 0;
+		env->dones[i] = 0;
+	}
+}
+
+// The instructions run on the register file alone,see lockstep()
+static bool lockstep_op(unsigned op){
+	switch(op >> 12){
+		case 0x0: return op != 0x00E0 && op != 0x00EE; // 0NNN does nothing
+		case 0x1: case 0x3: case 0x4: case 0x5: case 0x6: case 0x7: case 0x8: case 0x9: case 0xA:
+		case 0xB:
+			return true;
+		case 0xF: return (op & 0xFF) == 0x1E || (op & 0xFF) == 0x29;
+		default: return false;
+	}
+}
+
+static inline u8x16 load8(const uint8_t *p){
+	u8x16 v;
+	memcpy(&v,p,sizeof(v));
+	return v;
+}
+
+// 32 byte vectors go through pointers,passing them by value needs AVX to stay in registers
+static inline void load16(u16x16 *v,const uint16_t *p){
+	memcpy(v,p,sizeof(*v));
+}
+
+// Writes the lanes of `v` that are set in `mask`,leaves the others as they were
+static inline void store8(uint8_t *p,u8x16 v,u8x16 mask){
+	u8x16 old = load8(p);
+	old = (old & ~mask) | (v & mask);
+	memcpy(p,&old,sizeof(old));
+}
+
+static inline void store16(uint16_t *p,const u16x16 *v,const u16x16 *mask){
+	u16x16 old;
+	load16(&old,p);
+	old = (old & ~*mask) | (*v & *mask);
+	memcpy(p,&old,sizeof(old));
+}
+
+// A comparison's 0/0xFF lanes as 0/0xFFFF,to select PC or I lanes
+#define WIDEN_MASK(m) ((u16x16) __builtin_convertvector((i8x16) (m),i16x16))
+#define WIDEN(v) __builtin_convertvector((v),u16x16)
+
+/* Instruction `op` (a lockstep_op()) for machines a to b-1,whose PC points at it: the same thing 
+ * interpreter.h does,with the quirks looked up once for all of them. A vector is 16 machines,the
+ * ones at the ends outside [a,b) are masked out.*/
+static void lockstep(struct VecEnv *env,unsigned op,unsigned a,unsigned b){
+	static const u8x16 lane = {0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15};
+	const struct Quirks *q = env->config.quirks;
+	unsigned x = (op >> 8) & 0xF,y = (op >> 4) & 0xF;
+	uint8_t nn = op & 0xFF;
+	uint16_t nnn = op & 0xFFF;
+
+	for(unsigned base = a & ~15u;base < b;base += 16){
+		u8x16 mask = (u8x16) (lane >= (uint8_t) (a > base ? a - base : 0)) &
+			     (u8x16) (lane < (uint8_t) (b - base < 16 ? b - base : 16));
+		u16x16 mask16 = WIDEN_MASK(mask),pc,i;
+		u8x16 vx = load8(env->V[x] + base),vy = load8(env->V[y] + base);
+		u8x16 vf,res;
+
+		load16(&pc,env->PC + base);
+		pc += 2; // the fetch
+
+		switch(op >> 12){
+			case 0x1:
+				pc = (u16x16){0} + nnn;
+				break;
+			case 0x3:
+				pc += WIDEN_MASK(vx == nn) & 2;
+				break;
+			case 0x4:
+				pc += WIDEN_MASK(vx != nn) & 2;
+				break;
+			case 0x5:
+				pc += WIDEN_MASK(vx == vy) & 2;
+				break;
+			case 0x9:
+				pc += WIDEN_MASK(vx != vy) & 2;
+				break;
+			case 0x6:
+				store8(env->V[x] + base,(u8x16){0} + nn,mask);
+				break;
+			case 0x7:
+				store8(env->V[x] + base,vx + nn,mask);
+				break;
+			case 0x8:
+				// VF is written after Vx,so 8FYN leaves the flag in VF
+				switch(op & 0xF){
+					case 0x0: store8(env->V[x] + base,vy,mask); break;
+					case 0x1: case 0x2: case 0x3:
+						res = (op & 0xF) == 1 ? vx | vy : (op & 0xF) == 2 ? vx & vy : vx ^ vy;
+						store8(env->V[x] + base,res,mask);
+						if(q->vf_reset)
+							store8(env->V[0xF] + base,(u8x16){0},mask);
+						break;
+					case 0x4:
+						res = vx + vy;
+						vf = (u8x16) (res < vx) & 1;
+						store8(env->V[x] + base,res,mask);
+						store8(env->V[0xF] + base,vf,mask);
+						break;
+					case 0x5:
+						vf = (u8x16) (vx >= vy) & 1;
+						store8(env->V[x] + base,vx - vy,mask);
+						store8(env->V[0xF] + base,vf,mask);
+						break;
+					case 0x6:
+						res = q->shift ? vx : vy;
+						store8(env->V[x] + base,res >> 1,mask);
+						store8(env->V[0xF] + base,res & 1,mask);
+						break;
+					case 0x7:
+						vf = (u8x16) (vy >= vx) & 1;
+						store8(env->V[x] + base,vy - vx,mask);
+						store8(env->V[0xF] + base,vf,mask);
+						break;
+					case 0xE:
+						res = q->shift ? vx : vy;
+						store8(env->V[x] + base,res << 1,mask);
+						store8(env->V[0xF] + base,res >> 7,mask);
+						break;
+				}
+				break;
+			case 0xA:
+				i = (u16x16){0} + nnn;
+				store16(env->I + base,&i,&mask16);
+				break;
+			case 0xB:
+				pc = nnn + WIDEN(q->jump ? vx : load8(env->V[0] + base));
+				break;
+			case 0xF:
+				load16(&i,env->I + base);
+				i = nn == 0x1E ? (i + WIDEN(vx)) & 0xFFF : 0x50 + WIDEN(vx) * 5; // FX1E,FX29
+				store16(env->I + base,&i,&mask16);
+				break;
+		}
+
+		pc &= 0xFFF;
+		store16(env->PC + base,&pc,&mask16);
+	}
+}
+
+/* One frame of every machine that's still in its step (dones[i] == 0),`speed` instructions or 
+ * until a draw ends the frame under the display wait quirk.*/
+static void lockstep_frame(struct VecEnv *env){
+	const struct VecEnvConfig *cfg = &env->config;
+	unsigned n = env->n;
+
+	for(unsigned i = 0;i < n;i++)
+		env->active[i] = !env->dones[i];
+
+	for(unsigned k = 0;k < cfg->speed;k++){
+		unsigned running = 0,runs = 0;
+
+		for(unsigned i = 0;i < n;i++){
+			if(!env->active[i])
+				continue;
+			const uint8_t *memory = env->machines[i].memory;
+			unsigned pc = env->PC[i];
+			env->ops[i] = memory[pc] << 8 | memory[(pc + 1) & 0xFFF];
+			running++;
+			runs += i == 0 || !env->active[i - 1] || env->ops[i - 1] != env->ops[i];
+		}
+		if(running == 0)
+			return;
+
+		// Mostly on their own,runs of one or two aren't worth it
+		if(runs * 4 > running){
+			for(unsigned i = 0;i < n;i++)
+				if(env->active[i]){
+					struct Chip8 *c8 = &env->machines[i];
+					gather(env,i,c8);
+					cfg->quirks->run(c8,cfg->speed - k);
+					scatter(env,i,c8);
+				}
+			return;
+		}
+
+		for(unsigned a = 0,b;a < n;a = b){
+			if(!env->active[a]){
+				b = a + 1;
+				continue;
+			}
+			for(b = a + 1;b < n && env->active[b] && env->ops[b] == env->ops[a];b++)
+				;
+			if(lockstep_op(env->ops[a])){
+				lockstep(env,env->ops[a],a,b);
+				continue;
+			}
+			for(unsigned i = a;i < b;i++){
+				struct Chip8 *c8 = &env->machines[i];
+				gather(env,i,c8);
+				c8->registers.PC += 2;
+				if(cfg->quirks->execute(env->ops[i],c8))
+					env->active[i] = false; // the frame ends at the draw
+				scatter(env,i,c8);
+			}
+		}
+	}
+}
+
+/* Every frame: the keys,the instructions,the timers and whether the episode is over,for all the
+ * machines at once. A machine that's done sits out the rest of the step.*/
+void vecenv_step(struct VecEnv *env,const uint8_t *actions){
+	const struct VecEnvConfig *cfg = &env->config;
+	unsigned frames = cfg->frame_skip ? cfg->frame_skip : 1;
+
+	for(unsigned i = 0;i < env->n;i++)
+		if(env->dones[i]){
+			reset_one(env,i,chip8_mix(env->seeds[i] + 1));
+			env->dones[i] = 0;
+		}
+
+	for(unsigned f = 0;f < frames;f++){
+		for(unsigned i = 0;i < env->n;i++){
+			if(env->dones[i])
+				continue;
+			// Every frame,EX9E/FX0A release the key they saw
+			bool *keypad = env->paged ? env->paged[i].keypad : env->machines[i].keypad;
+			memset(keypad,0,16 * sizeof(*keypad));
+			if(actions && actions[i] > 0 && actions[i] <= 16)
+				keypad[actions[i] - 1] = true;
+			if(env->paged)
+				paged_run(&env->paged[i],&env->pool,cfg->quirks,cfg->speed);
+		}
+
+		if(env->machines)
+			lockstep_frame(env);
+
+		for(unsigned i = 0;i < env->n;i++){
+			if(env->dones[i])
+				continue;
+			if(env->machines)
+				chip8_tick_timers(&env->machines[i]);
+			env->episode_frames[i]++;
+			env->dones[i] = (cfg->done_check && peek(env,i,cfg->done_addr) == cfg->done_value) ||
+					(cfg->max_frames && env->episode_frames[i] >= cfg->max_frames);
+		}
+	}
+
+	for(unsigned i = 0;i < env->n;i++){
+		int32_t s = score(env,i);
+		env->rewards[i] = s - env->scores[i];
+		env->scores[i] = s;
+		if(env->paged){
+			memcpy(env->frames[i],env->paged[i].display,sizeof(env->frames[i]));
+		}else{
+			gather(env,i,&env->machines[i]);
+			pack_frame(&env->machines[i],env->frames[i]);
+		}
+	}
+}
@@ -0,0 +1,55 @@
+#ifndef VECENV_H
+#define VECENV_H
+
+#include"chip_8.h"
+#include"paged.h"
+
+// What an environment is and how it's scored
+struct VecEnvConfig{
+	const struct Quirks *quirks;
+	unsigned speed; // instructions per frame
+	unsigned frame_skip; // frames per step,the action is held for all of them
+	uint16_t reward_addr; // the score lives in memory here
+	uint8_t reward_bytes; // 0 for no reward,1 or 2 (big endian)
+	uint16_t done_addr;
+	uint8_t done_value; // an episode is over when memory[done_addr] == done_value
+	bool done_check; // ...if set
+	unsigned max_frames; // or after this many frames,0 for no limit
+	bool paged; // share the ROM's memory between the machines (see paged.h)
+};
+
+/* N machines. Everything the agent sees is stored as contiguous arrays (structure of arrays) 
+ * that can be handed out as is,e.g. as numpy arrays over the same memory.*/
+struct VecEnv{
+	unsigned n;
+	unsigned stride; // n rounded up to whole vectors,the length of the register arrays
+	struct VecEnvConfig config;
+	struct Chip8 start; // the machine every episode starts from
+	struct Chip8 *machines; // NULL when paged
+	struct PagedChip8 *paged; // ...or these,reading start.memory until they write
+	struct PagePool pool;
+
+	/* The registers of `machines` as a structure of arrays: V[x][i] is machine i's Vx. They're
+	 * what the machines run on,machines[i].registers is only brought up to date after each step.*/
+	uint8_t *V[16];
+	uint16_t *I;
+	uint16_t *PC;
+	uint16_t *ops; // the instruction each machine is at
+	uint8_t *active; // still running this frame
+
+	// Observations,one entry per machine
+	uint64_t (*frames)[DISPLAY_HEIGHT]; // 1 bit per pixel,x = 0 is the top bit
+	float *rewards;
+	uint8_t *dones;
+
+	uint32_t *seeds;
+	uint32_t *episode_frames;
+	int32_t *scores;
+};
+
+struct VecEnv *vecenv_new(unsigned n,const struct Chip8 *start,const struct VecEnvConfig *config);
+void vecenv_free(struct VecEnv *env);
+void vecenv_reset(struct VecEnv *env,const uint32_t *seeds);
+void vecenv_step(struct VecEnv *env,const uint8_t *actions);
+
+#endif
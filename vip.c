@@ -0,0 +1,126 @@
+#include<stdbool.h>
+#include<stdint.h>
+
+#include"chip_8.h"
+#include"vip.h"
+
+/* COSMAC VIP timing model. Instead of a fixed number of instructions a frame gets the machine cycles
+ * the VIP had left for the interpreter after the display (VIP_CYCLES_PER_FRAME - VIP_DISPLAY_CYCLES)
+ * and every instruction is charged roughly what it took the original interpreter: the fetch/decode
+ * overhead plus a cost from the tables below,plus the data dependent parts (taken skips,DXYN's
+ * height and how far the sprite has to be shifted,FX33's digits,FX55/FX65's register count).
+ * Overrunning the frame is carried into the next one.
+ *
+ * With the display wait quirk a DXYN waits for the next vertical blank,i.e. the rest of the frame
+ * is lost. The interpreters already end the frame there,the unused cycles just aren't carried.
+ *
+ * The costs are approximations from the VIP interpreter's listing, not measurements. They live in
+ * their own engine so the normal interpreters don't pay for any of it.*/
+
+bool vip_timing;
+
+unsigned vip_cost(unsigned opcode,const struct Chip8 *before,const struct Chip8 *after);
+bool vip_step(struct Chip8 *c8,const struct Quirks *q);
+void vip_frame_start(struct Chip8 *c8);
+unsigned vip_finish(struct Chip8 *c8,const struct Quirks *q);
+unsigned vip_run(struct Chip8 *c8,const struct Quirks *q);
+
+#define VIP_FETCH 40
+
+// By the top nibble,0 where it depends on more of the opcode
+static const uint16_t group_cycles[16] = {
+	[0x1] = 12,[0x2] = 26,[0x3] = 10,[0x4] = 10,[0x5] = 14,[0x6] = 6,[0x7] = 10,[0x8] = 20,
+	[0x9] = 14,[0xA] = 12,[0xB] = 22,[0xC] = 36,[0xD] = 26
+};
+
+// 0NNN,EXNN and FXNN by the low byte
+static const uint16_t zero_cycles[256] = {[0xE0] = 24 + 4 * 256,[0xEE] = 10};
+static const uint16_t e_cycles[256] = {[0x9E] = 14,[0xA1] = 14};
+static const uint16_t f_cycles[256] = {
+	[0x07] = 10,[0x0A] = 19,[0x15] = 10,[0x18] = 10,[0x1E] = 16,[0x29] = 16,[0x33] = 80,[0x55] = 14,
+	[0x65] = 14
+};
+
+// What executing `opcode` took,`before` and `after` are the machine on either side of it
+unsigned vip_cost(unsigned opcode,const struct Chip8 *before,const struct Chip8 *after){
+	unsigned group = opcode >> 12,NN = opcode & 0xFF,X = (opcode >> 8) & 0xF;
+	unsigned cycles = VIP_FETCH + group_cycles[group];
+
+	switch(group){
+		case 0x0: cycles += zero_cycles[NN]; break;
+		case 0xE: cycles += e_cycles[NN]; break;
+		case 0xF: cycles += f_cycles[NN]; break;
+	}
+
+	switch(group){
+		case 0x3:
+		case 0x4:
+		case 0x5:
+		case 0x9:
+		case 0xE:
+			// A taken skip costs a little more
+			if(((after->registers.PC - before->registers.PC) & 0xFFF) == 4)
+				cycles += 4;
+			break;
+		case 0xD:{
+			// Every row is shifted into place bit by bit and takes two bytes when not aligned
+			unsigned shift = before->registers.V[X] & 7;
+			unsigned rows = opcode & 0xF;
+			cycles += rows * (12 + 4 * shift + (shift ? 8 : 0));
+			break;
+		}
+		case 0xF:
+			if(NN == 0x33){
+				unsigned v = before->registers.V[X];
+				cycles += 16 * (v / 100 + v / 10 % 10 + v % 10); // by repeated subtraction
+			}else if(NN == 0x55 || NN == 0x65){
+				cycles += 14 * (X + 1);
+			}
+			break;
+	}
+
+	return cycles;
+}
+
+/* One instruction,charged to the frame's cycles. Returns true if it ended the frame,whatever was
+ * left of the frame is gone then.*/
+bool vip_step(struct Chip8 *c8,const struct Quirks *q){
+	struct Chip8 before;
+	unsigned pc = c8->registers.PC;
+	unsigned opcode = c8->memory[pc] << 8 | c8->memory[(pc + 1) & 0xFFF];
+
+	// Only what vip_cost() looks at
+	before.registers = c8->registers;
+
+	bool end_frame = q->execute(fetch(c8),c8);
+	c8->cycles -= vip_cost(opcode,&before,c8);
+
+	// Waiting for the vertical blank
+	if(end_frame && c8->cycles > 0)
+		c8->cycles = 0;
+	return end_frame;
+}
+
+// The frame's cycles,on top of what the last one overran by
+void vip_frame_start(struct Chip8 *c8){
+	c8->cycles += VIP_CYCLES_PER_FRAME - VIP_DISPLAY_CYCLES;
+}
+
+// The rest of the frame,returns the instructions run
+unsigned vip_finish(struct Chip8 *c8,const struct Quirks *q){
+	unsigned n = 0;
+
+	while(c8->cycles > 0){
+		n++;
+		if(vip_step(c8,q))
+			break;
+	}
+
+	return n;
+}
+
+/* A frame of the VIP's cycle budget. Returns the instructions run.*/
+unsigned vip_run(struct Chip8 *c8,const struct Quirks *q){
+	vip_frame_start(c8);
+	return vip_finish(c8,q);
+}
@@ -0,0 +1,19 @@
+#ifndef VIP_H
+#define VIP_H
+
+#include"chip_8.h"
+
+// 1.7609 MHz,8 clocks per machine cycle,60 frames a second
+#define VIP_CYCLES_PER_FRAME 3668
+// Taken every frame by the display DMA (128 lines of 8 bytes) and the interrupt routine
+#define VIP_DISPLAY_CYCLES 1070
+
+extern bool vip_timing;
+
+unsigned vip_cost(unsigned opcode,const struct Chip8 *before,const struct Chip8 *after);
+bool vip_step(struct Chip8 *c8,const struct Quirks *q);
+void vip_frame_start(struct Chip8 *c8);
+unsigned vip_finish(struct Chip8 *c8,const struct Quirks *q);
+unsigned vip_run(struct Chip8 *c8,const struct Quirks *q);
+
+#endif
@@ -0,0 +1,245 @@
+#include<SDL3/SDL.h>
+#include<stdbool.h>
+#include<stdint.h>
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+
+#include"chip_8.h"
+#include"display.h"
+#include"metrics.h"
+#include"wall.h"
+
+/* The wall: many machines at once in a grid,e.g. every ROM in ROMs/ or one game with 64 seeds. All
+ * the displays are packed into one streaming texture (the atlas,a pixel of gap between tiles) that's
+ * written once per frame and drawn with one SDL_RenderTexture(),so hundreds of tiles cost about as
+ * much to present as one. The keyboard goes to the tile that was clicked last (outlined),the others
+ * get the scripted input of --input if there is one.*/
+
+extern unsigned instructions_per_frame;
+
+#define TILE_W (DISPLAY_WIDTH + 1)
+#define TILE_H (DISPLAY_HEIGHT + 1)
+#define WALL_GAP 0x303030
+#define WALL_FOCUS 0xFFB000
+
+struct Tile{
+	struct Chip8 c8;
+	const struct Quirks *quirks;
+	unsigned speed;
+	int keymap;
+	char name[64];
+};
+
+static struct{
+	struct Tile *tiles;
+	unsigned count;
+	unsigned focus;
+	unsigned columns,rows;
+	SDL_Texture *atlas;
+	SDL_FRect dst; // where the atlas goes in the window
+
+	// What load_ROM() falls back to for ROMs the database doesn't know
+	bool defaults_saved;
+	const struct Quirks *default_quirks;
+	unsigned default_speed;
+	int default_keymap;
+} wall;
+
+bool wall_add(const char *rom,uint32_t seed,const struct Quirks *quirks_override,unsigned speed_override);
+void wall_run(struct Game *g,uint32_t input_seed);
+void wall_free(void);
+
+/* Adds a machine running `rom`,configured by the ROM database like a single one would be.*/
+bool wall_add(const char *rom,uint32_t seed,const struct Quirks *quirks_override,unsigned speed_override){
+	if(wall.count == WALL_MAX){
+		if(debug_flag)
+			fprintf(stderr,"The wall is full (%d machines)\n",WALL_MAX);
+		return false;
+	}
+	if(wall.tiles == NULL && (wall.tiles = calloc(WALL_MAX,sizeof(*wall.tiles))) == NULL){
+		if(debug_flag)
+			fprintf(stderr,"Error while allocating memory\n");
+		return false;
+	}
+	if(!wall.defaults_saved){
+		wall.default_quirks = quirks;
+		wall.default_speed = instructions_per_frame;
+		wall.default_keymap = keymap;
+		wall.defaults_saved = true;
+	}
+	quirks = wall.default_quirks;
+	instructions_per_frame = wall.default_speed;
+	keymap = wall.default_keymap;
+
+	struct Tile *t = &wall.tiles[wall.count];
+	chip8_init(&t->c8,seed);
+	if(!load_ROM(&t->c8,rom))
+		return false;
+	t->quirks = quirks_override ? quirks_override : quirks;
+	t->speed = speed_override ? speed_override : instructions_per_frame;
+	t->keymap = keymap;
+	const char *base = strrchr(rom,'/');
+	snprintf(t->name,sizeof(t->name),"%s",base ? base + 1 : rom);
+	wall.count++;
+	return true;
+}
+
+void wall_free(void){
+	if(wall.atlas)
+		SDL_DestroyTexture(wall.atlas);
+	free(wall.tiles);
+	memset(&wall,0,sizeof(wall));
+}
+
+// Letterboxes the atlas into the window
+static void place(struct Game *g){
+	int w,h;
+	float aw = wall.columns * TILE_W + 1,ah = wall.rows * TILE_H + 1;
+
+	if(!SDL_GetCurrentRenderOutputSize(g->renderer,&w,&h))
+		w = aw,h = ah;
+	float scale = w / aw < h / ah ? w / aw : h / ah;
+	wall.dst = (SDL_FRect){(w - aw * scale) / 2,(h - ah * scale) / 2,aw * scale,ah * scale};
+}
+
+// The tile under a point in window coordinates,or -1
+static int tile_at(struct Game *g,float x,float y){
+	float rx,ry;
+
+	if(!SDL_RenderCoordinatesFromWindow(g->renderer,x,y,&rx,&ry))
+		return -1;
+	float ax = (rx - wall.dst.x) * (wall.columns * TILE_W + 1) / wall.dst.w;
+	float ay = (ry - wall.dst.y) * (wall.rows * TILE_H + 1) / wall.dst.h;
+	if(ax < 0 || ay < 0)
+		return -1;
+	unsigned column = ax / TILE_W,row = ay / TILE_H;
+	if(column >= wall.columns || row >= wall.rows || row * wall.columns + column >= wall.count)
+		return -1;
+	return row * wall.columns + column;
+}
+
+// Writes every tile into the atlas,one lock for the lot
+static void render_wall(struct Game *g){
+	const int aw = wall.columns * TILE_W + 1,ah = wall.rows * TILE_H + 1;
+	void *pixels;
+	int pitch;
+
+	if(!SDL_LockTexture(wall.atlas,NULL,&pixels,&pitch))
+		return;
+
+	for(int y = 0;y < ah;y++){
+		uint32_t *row = (uint32_t *) ((uint8_t *) pixels + (size_t) y * pitch);
+		if(y % TILE_H == 0){
+			for(int x = 0;x < aw;x++)
+				row[x] = WALL_GAP;
+			continue;
+		}
+
+		unsigned ty = y / TILE_H,py = y % TILE_H - 1;
+		for(unsigned tx = 0;tx < wall.columns;tx++){
+			uint32_t *out = row + tx * TILE_W;
+			unsigned t = ty * wall.columns + tx;
+			out[0] = WALL_GAP;
+			if(t < wall.count){
+				const bool *lit = wall.tiles[t].c8.display[py];
+				for(int x = 0;x < DISPLAY_WIDTH;x++)
+					out[1 + x] = -(uint32_t) lit[x] & 0xFFFFFF;
+			}else{
+				memset(out + 1,0,DISPLAY_WIDTH * sizeof(*out));
+			}
+		}
+		row[aw - 1] = WALL_GAP;
+	}
+
+	// Outline the tile that has the keyboard
+	unsigned fx = wall.focus % wall.columns * TILE_W,fy = wall.focus / wall.columns * TILE_H;
+	for(int x = 0;x <= TILE_W;x++){
+		((uint32_t *) ((uint8_t *) pixels + (size_t) fy * pitch))[fx + x] = WALL_FOCUS;
+		((uint32_t *) ((uint8_t *) pixels + (size_t) (fy + TILE_H) * pitch))[fx + x] = WALL_FOCUS;
+	}
+	for(int y = 0;y <= TILE_H;y++){
+		uint32_t *row = (uint32_t *) ((uint8_t *) pixels + (size_t) (fy + y) * pitch);
+		row[fx] = row[fx + TILE_W] = WALL_FOCUS;
+	}
+
+	SDL_UnlockTexture(wall.atlas);
+
+	SDL_SetRenderDrawColor(g->renderer,0,0,0,255);
+	SDL_RenderClear(g->renderer);
+	SDL_RenderTexture(g->renderer,wall.atlas,NULL,&wall.dst);
+	SDL_RenderPresent(g->renderer);
+}
+
+static void set_title(struct Game *g,const char *extra){
+	char title[256];
+	snprintf(title,sizeof(title),"%u machines - %s%s%s",wall.count,wall.tiles[wall.focus].name,
+		 extra ? " - " : "",extra ? extra : "");
+	SDL_SetWindowTitle(g->window,title);
+}
+
+/* Like game_run() for every machine on the wall.*/
+void wall_run(struct Game *g,uint32_t input_seed){
+	const Uint64 frame_ns = SDL_NS_PER_SECOND / 60;
+	Uint64 next = SDL_GetTicksNS();
+	char summary[128];
+
+	if(wall.count == 0)
+		return;
+	for(wall.columns = 1;wall.columns * wall.columns < wall.count;wall.columns++)
+		;
+	wall.rows = (wall.count + wall.columns - 1) / wall.columns;
+	wall.atlas = SDL_CreateTexture(g->renderer,SDL_PIXELFORMAT_XRGB8888,SDL_TEXTUREACCESS_STREAMING,
+				       wall.columns * TILE_W + 1,wall.rows * TILE_H + 1);
+	if(wall.atlas == NULL){
+		if(debug_flag)
+			fprintf(stderr,"Error creating the wall texture: %s\n",SDL_GetError());
+		return;
+	}
+	SDL_SetTextureScaleMode(wall.atlas,SDL_SCALEMODE_NEAREST);
+	keymap = wall.tiles[0].keymap;
+	set_title(g,NULL);
+
+	for(uint64_t frame = 0;g->is_running;frame++){
+		uint64_t start = metrics_now();
+		place(g);
+		game_events(g,wall.tiles[wall.focus].c8.keypad);
+		if(g->clicked){
+			g->clicked = false;
+			int t = tile_at(g,g->click_x,g->click_y);
+			if(t >= 0 && (unsigned) t != wall.focus){
+				memset(wall.tiles[wall.focus].c8.keypad,0,sizeof(wall.tiles[wall.focus].c8.keypad));
+				wall.focus = t;
+				keymap = wall.tiles[t].keymap;
+				set_title(g,NULL);
+			}
+		}
+		memset(g->key_pressed_at,0,sizeof(g->key_pressed_at));
+		uint64_t polled = metrics_now();
+
+		unsigned n = 0;
+		for(unsigned i = 0;i < wall.count;i++){
+			struct Tile *t = &wall.tiles[i];
+			if(input_seed && i != wall.focus)
+				chip8_scripted_input(input_seed + i,frame,t->c8.keypad);
+			n += t->quirks->run(&t->c8,t->speed);
+			chip8_tick_timers(&t->c8);
+		}
+		uint64_t emulated = metrics_now();
+
+		render_wall(g);
+		uint64_t presented = metrics_now();
+		metrics_frame(n,start,polled - start,emulated - polled,presented - emulated);
+		if(metrics.enabled && metrics_summary(summary,sizeof(summary)))
+			set_title(g,summary);
+
+		next += frame_ns;
+		Uint64 now = SDL_GetTicksNS();
+		if(now < next){
+			SDL_DelayNS(next - now);
+		}else{
+			next = now;
+			metrics.late_frames++;
+		}
+	}
+}
@@ -0,0 +1,13 @@
+#ifndef WALL_H
+#define WALL_H
+
+#include"chip_8.h"
+#include"display.h"
+
+#define WALL_MAX 1024
+
+bool wall_add(const char *rom,uint32_t seed,const struct Quirks *quirks_override,unsigned speed_override);
+void wall_run(struct Game *g,uint32_t input_seed);
+void wall_free(void);
+
+#endif
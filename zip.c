@@ -0,0 +1,205 @@
+#include<fcntl.h>
+#include<stdbool.h>
+#include<stdint.h>
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<unistd.h>
+#include<zlib.h>
+
+#include"zip.h"
+
+/* Just enough of the zip format to load ROMs straight out of an archive: the archive is mapped,
+ * its central directory is read once into an index (hashed by name) and an entry is read by 
+ * jumping to its local header and copying (stored) or inflating (deflate) it. No ZIP64,no 
+ * encryption.*/
+
+extern bool debug_flag;
+
+struct Zip *zip_open(const char *path);
+void zip_close(struct Zip *zip);
+const struct ZipEntry *zip_find(const struct Zip *zip,const char *name);
+bool zip_read(const struct Zip *zip,const struct ZipEntry *entry,uint8_t *out,size_t max,size_t *len);
+
+#define EOCD_SIGNATURE 0x06054b50
+#define CENTRAL_SIGNATURE 0x02014b50
+#define LOCAL_SIGNATURE 0x04034b50
+
+static inline uint16_t le16(const uint8_t *p){
+	return p[0] | p[1] << 8;
+}
+
+static inline uint32_t le32(const uint8_t *p){
+	return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+static uint32_t name_hash(const char *name,size_t len){
+	uint32_t h = 2166136261u;
+	for(size_t i = 0;i < len;i++){
+		h ^= (uint8_t) name[i];
+		h *= 16777619u;
+	}
+	return h;
+}
+
+static bool build_index(struct Zip *zip){
+	const uint8_t *eocd = NULL;
+
+	// The end of central directory record is last,followed by a comment of up to 64K
+	if(zip->len < 22)
+		return false;
+	size_t lowest = zip->len > 22 + 0xFFFF ? zip->len - 22 - 0xFFFF : 0;
+	for(size_t i = zip->len - 22;;i--){
+		if(le32(zip->data + i) == EOCD_SIGNATURE){
+			eocd = zip->data + i;
+			break;
+		}
+		if(i == lowest)
+			break;
+	}
+	if(eocd == NULL)
+		return false;
+
+	unsigned count = le16(eocd + 10);
+	uint32_t size = le32(eocd + 12),offset = le32(eocd + 16);
+	if((size_t) offset + size > zip->len)
+		return false;
+
+	zip->entries = calloc(count ? count : 1,sizeof(*zip->entries));
+	for(zip->index_size = 16;zip->index_size < count * 2;zip->index_size *= 2)
+		;
+	zip->index = malloc(zip->index_size * sizeof(*zip->index));
+	if(zip->entries == NULL || zip->index == NULL)
+		return false;
+	memset(zip->index,-1,zip->index_size * sizeof(*zip->index));
+
+	const uint8_t *p = zip->data + offset,*end = p + size;
+	for(unsigned i = 0;i < count;i++){
+		if(p + 46 > end || le32(p) != CENTRAL_SIGNATURE)
+			return false;
+
+		struct ZipEntry *e = &zip->entries[zip->count];
+		e->method = le16(p + 10);
+		e->crc = le32(p + 16);
+		e->compressed = le32(p + 20);
+		e->size = le32(p + 24);
+		e->name_len = le16(p + 28);
+		e->offset = le32(p + 42);
+		e->name = (const char *) p + 46;
+
+		if((const uint8_t *) e->name + e->name_len > end)
+			return false;
+
+		unsigned slot = name_hash(e->name,e->name_len) & (zip->index_size - 1);
+		while(zip->index[slot] >= 0)
+			slot = (slot + 1) & (zip->index_size - 1);
+		zip->index[slot] = zip->count++;
+
+		p += 46 + e->name_len + le16(p + 30) + le16(p + 32);
+	}
+
+	return true;
+}
+
+struct Zip *zip_open(const char *path){
+	int fd = open(path,O_RDONLY);
+	struct stat st;
+
+	if(fd < 0 || fstat(fd,&st) < 0){
+		if(debug_flag)
+			fprintf(stderr,"Couldn't open %s\n",path);
+		if(fd >= 0)
+			close(fd);
+		return NULL;
+	}
+
+	struct Zip *zip = calloc(1,sizeof(*zip));
+	zip->len = st.st_size;
+	zip->data = zip->len ? mmap(NULL,zip->len,PROT_READ,MAP_PRIVATE,fd,0) : MAP_FAILED;
+	close(fd);
+
+	if(zip->data == MAP_FAILED || !build_index(zip)){
+		fprintf(stderr,"%s isn't a zip archive (or is one this can't read)\n",path);
+		if(zip->data == MAP_FAILED)
+			zip->data = NULL;
+		zip_close(zip);
+		return NULL;
+	}
+
+	return zip;
+}
+
+void zip_close(struct Zip *zip){
+	if(zip == NULL)
+		return;
+
+	if(zip->data)
+		munmap((void *) zip->data,zip->len);
+	free(zip->entries);
+	free(zip->index);
+	free(zip);
+}
+
+const struct ZipEntry *zip_find(const struct Zip *zip,const char *name){
+	size_t len = strlen(name);
+	unsigned slot = name_hash(name,len) & (zip->index_size - 1);
+
+	for(;zip->index[slot] >= 0;slot = (slot + 1) & (zip->index_size - 1)){
+		const struct ZipEntry *e = &zip->entries[zip->index[slot]];
+		if(e->name_len == len && memcmp(e->name,name,len) == 0)
+			return e;
+	}
+
+	return NULL;
+}
+
+// Reads the entry into `out`,failing if it's bigger than `max` bytes
+bool zip_read(const struct Zip *zip,const struct ZipEntry *entry,uint8_t *out,size_t max,size_t *len){
+	const uint8_t *local = zip->data + entry->offset;
+
+	if((size_t) entry->offset + 30 > zip->len || le32(local) != LOCAL_SIGNATURE)
+		return false;
+
+	size_t start = (size_t) entry->offset + 30 + le16(local + 26) + le16(local + 28);
+	if(start + entry->compressed > zip->len)
+		return false;
+
+	if(entry->size > max){
+		fprintf(stderr,"%.*s is %u bytes,at most %zu fit\n",entry->name_len,entry->name,entry->size,max);
+		return false;
+	}
+
+	const uint8_t *data = zip->data + start;
+
+	if(entry->method == 0){
+		if(entry->compressed != entry->size)
+			return false;
+		memcpy(out,data,entry->size);
+	}else if(entry->method == 8){
+		z_stream s = {0};
+		if(inflateInit2(&s,-MAX_WBITS) != Z_OK)
+			return false;
+		s.next_in = (Bytef *) data;
+		s.avail_in = entry->compressed;
+		s.next_out = out;
+		s.avail_out = entry->size;
+		int ret = inflate(&s,Z_FINISH);
+		inflateEnd(&s);
+		if(ret != Z_STREAM_END || s.total_out != entry->size)
+			return false;
+	}else{
+		fprintf(stderr,"%.*s uses compression method %u,only stored and deflate are supported\n",
+			entry->name_len,entry->name,entry->method);
+		return false;
+	}
+
+	if(crc32(0,out,entry->size) != entry->crc){
+		fprintf(stderr,"%.*s is corrupt (CRC mismatch)\n",entry->name_len,entry->name);
+		return false;
+	}
+
+	*len = entry->size;
+	return true;
+}
@@ -0,0 +1,33 @@
+#ifndef ZIP_H
+#define ZIP_H
+
+#include<stdbool.h>
+#include<stddef.h>
+#include<stdint.h>
+
+struct ZipEntry{
+	const char *name; // not NUL terminated,points into the archive
+	uint16_t name_len;
+	uint16_t method; // 0 stored,8 deflate
+	uint32_t crc;
+	uint32_t compressed;
+	uint32_t size;
+	uint32_t offset; // of the local header
+};
+
+// A mapped archive and the index of its central directory
+struct Zip{
+	const uint8_t *data;
+	size_t len;
+	struct ZipEntry *entries;
+	unsigned count;
+	int32_t *index; // open addressed hash table of entry numbers,-1 for empty
+	unsigned index_size;
+};
+
+struct Zip *zip_open(const char *path);
+void zip_close(struct Zip *zip);
+const struct ZipEntry *zip_find(const struct Zip *zip,const char *name);
+bool zip_read(const struct Zip *zip,const struct ZipEntry *entry,uint8_t *out,size_t max,size_t *len);
+
+#endif